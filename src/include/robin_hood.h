@@ -39,15 +39,21 @@
 #define ROBIN_HOOD_VERSION_PATCH 5  // for backwards-compatible bug fixes
 
 #include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstddef>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
+#include <iosfwd>
+#include <iterator>
 #include <limits>
 #include <memory> // only to support hash of smart pointers
 #include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 #if __cplusplus >= 201703L
 #    include <string_view>
 #endif
@@ -70,28 +76,6 @@
 #    define ROBIN_HOOD_TRACE(x)
 #endif
 
-// #define ROBIN_HOOD_COUNT_ENABLED
-#ifdef ROBIN_HOOD_COUNT_ENABLED
-#    include <iostream>
-#    define ROBIN_HOOD_COUNT(x) ++counts().x;
-namespace robin_hood {
-struct Counts {
-    uint64_t shiftUp{};
-    uint64_t shiftDown{};
-};
-inline std::ostream& operator<<(std::ostream& os, Counts const& c) {
-    return os << c.shiftUp << " shiftUp" << std::endl << c.shiftDown << " shiftDown" << std::endl;
-}
-
-static Counts& counts() {
-    static Counts counts{};
-    return counts;
-}
-} // namespace robin_hood
-#else
-#    define ROBIN_HOOD_COUNT(x)
-#endif
-
 // all non-argument macros should use this facility. See
 // https://www.fluentcpp.com/2019/05/28/better-macros-better-flags/
 #define ROBIN_HOOD(x) ROBIN_HOOD_PRIVATE_DEFINITION_##x()
@@ -161,6 +145,28 @@ static Counts& counts() {
 #    endif
 #endif
 
+// SSE2 is used to compare a whole group of 16 info bytes at once, see Table::matchGroup.
+#if !defined(ROBIN_HOOD_DISABLE_INTRINSICS) && \
+    (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#    define ROBIN_HOOD_PRIVATE_DEFINITION_HAS_SSE2() 1
+#    include <emmintrin.h>
+#else
+#    define ROBIN_HOOD_PRIVATE_DEFINITION_HAS_SSE2() 0
+#endif
+
+// CRC32C and AES-NI are used by hash_bytes_hw and hash_int_hw. The functions are compiled for these
+// instructions with a target attribute, and only called when the CPU supports them, see
+// has_hw_hash().
+#if !defined(ROBIN_HOOD_DISABLE_INTRINSICS) && defined(__x86_64__) && defined(__linux__) && \
+    (defined(__GNUC__) || defined(__clang__))
+#    define ROBIN_HOOD_PRIVATE_DEFINITION_HAS_HW_HASH() 1
+#    define ROBIN_HOOD_PRIVATE_DEFINITION_TARGET_HW_HASH() __attribute__((target("sse4.2,aes")))
+#    include <nmmintrin.h>
+#    include <wmmintrin.h>
+#else
+#    define ROBIN_HOOD_PRIVATE_DEFINITION_HAS_HW_HASH() 0
+#endif
+
 // fallthrough
 #ifndef __has_cpp_attribute // For backwards compatibility
 #    define __has_cpp_attribute(x) 0
@@ -182,6 +188,16 @@ static Counts& counts() {
 #    define ROBIN_HOOD_UNLIKELY(condition) __builtin_expect(condition, 0)
 #endif
 
+// prefetch
+#if defined(__GNUC__) || defined(__clang__)
+#    define ROBIN_HOOD_PREFETCH(ptr) __builtin_prefetch(ptr)
+#elif ROBIN_HOOD(HAS_SSE2)
+#    define ROBIN_HOOD_PREFETCH(ptr) \
+        _mm_prefetch(reinterpret_cast<char const*>(ptr), _MM_HINT_T0)
+#else
+#    define ROBIN_HOOD_PREFETCH(ptr)
+#endif
+
 // detect if native wchar_t type is availiable in MSVC
 #ifdef _MSC_VER
 #    ifdef _NATIVE_WCHAR_T_DEFINED
@@ -315,6 +331,25 @@ T rotr(T x, unsigned k) {
     return (x >> k) | (x << (8U * sizeof(T) - k));
 }
 
+// Upper 64 bits of the 128 bit product a * b. For a well mixed a, this maps a into [0, b) without
+// a division, see https://lemire.me/blog/2016/06/27/a-fast-alternative-to-the-modulo-reduction/
+inline uint64_t mulhi(uint64_t a, uint64_t b) noexcept {
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 uint128;
+    return static_cast<uint64_t>((static_cast<uint128>(a) * b) >> 64U);
+#elif defined(_MSC_VER) && defined(_M_X64) && !defined(ROBIN_HOOD_DISABLE_INTRINSICS)
+    return __umulh(a, b);
+#else
+    auto const aLo = a & UINT64_C(0xffffffff);
+    auto const aHi = a >> 32U;
+    auto const bLo = b & UINT64_C(0xffffffff);
+    auto const bHi = b >> 32U;
+    auto const hiLo = aHi * bLo;
+    auto const cross = ((aLo * bLo) >> 32U) + (hiLo & UINT64_C(0xffffffff)) + aLo * bHi;
+    return aHi * bHi + (hiLo >> 32U) + (cross >> 32U);
+#endif
+}
+
 // This cast gets rid of warnings like "cast from 'uint8_t*' {aka 'unsigned char*'} to
 // 'uint64_t*' {aka 'long unsigned int*'} increases required alignment of target type". Use with
 // care!
@@ -360,28 +395,189 @@ inline T unaligned_load(void const* ptr) noexcept {
     return t;
 }
 
+// Size of file in bytes, and moves the file position to offset. Uses 64 bit file positions, so
+// files larger than 2 GB work where long has only 32 bits. Returns false on error.
+inline bool fileSizeAndSeek(std::FILE* file, uint64_t offset, uint64_t* size) noexcept {
+#if defined(_WIN32)
+    if (0 != _fseeki64(file, 0, SEEK_END)) {
+        return false;
+    }
+    auto const pos = _ftelli64(file);
+    if (pos < 0 || 0 != _fseeki64(file, static_cast<__int64>(offset), SEEK_SET)) {
+        return false;
+    }
+#elif defined(__unix__) || defined(__APPLE__)
+    if (0 != fseeko(file, 0, SEEK_END)) {
+        return false;
+    }
+    auto const pos = ftello(file);
+    if (pos < 0 || 0 != fseeko(file, static_cast<off_t>(offset), SEEK_SET)) {
+        return false;
+    }
+#else
+    if (0 != std::fseek(file, 0, SEEK_END)) {
+        return false;
+    }
+    auto const pos = std::ftell(file);
+    if (pos < 0 || 0 != std::fseek(file, static_cast<long>(offset), SEEK_SET)) {
+        return false;
+    }
+#endif
+    *size = static_cast<uint64_t>(pos);
+    return true;
+}
+
+} // namespace detail
+
+// The default allocator of all maps: plain std::malloc and std::free.
+template <typename T>
+struct malloc_allocator {
+    using value_type = T;
+
+    malloc_allocator() noexcept = default;
+
+    template <typename U>
+    malloc_allocator(malloc_allocator<U> const& ROBIN_HOOD_UNUSED(o) /*unused*/) noexcept {}
+
+    T* allocate(size_t n) {
+        ROBIN_HOOD_LOG("std::malloc " << n * sizeof(T))
+        return static_cast<T*>(detail::assertNotNull<std::bad_alloc>(std::malloc(n * sizeof(T))));
+    }
+
+    void deallocate(T* ptr, size_t ROBIN_HOOD_UNUSED(n) /*unused*/) noexcept {
+        ROBIN_HOOD_LOG("std::free")
+        std::free(ptr);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(malloc_allocator<T> const& ROBIN_HOOD_UNUSED(a) /*unused*/,
+                malloc_allocator<U> const& ROBIN_HOOD_UNUSED(b) /*unused*/) noexcept {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(malloc_allocator<T> const& ROBIN_HOOD_UNUSED(a) /*unused*/,
+                malloc_allocator<U> const& ROBIN_HOOD_UNUSED(b) /*unused*/) noexcept {
+    return false;
+}
+
+namespace detail {
+
+// std::allocator_traits<A>::is_always_equal, which is only there since C++17.
+template <typename A, typename = void>
+struct AllocatorIsAlwaysEqual : public std::is_empty<A> {};
+
+template <typename A>
+struct AllocatorIsAlwaysEqual<
+    A, typename std::conditional<true, void, typename A::is_always_equal>::type>
+    : public A::is_always_equal {};
+
+// Allocates raw bytes with a user supplied Allocator. The allocator is rebound to
+// std::max_align_t, so the memory is suitably aligned for all nodes, and stored as empty base.
+// Copies get the allocator from select_on_container_copy_construction, and assignments only take
+// over the other allocator when it propagates on move assignment.
+template <typename Allocator>
+class ByteAllocator
+    : public std::allocator_traits<Allocator>::template rebind_alloc<std::max_align_t> {
+    using Base = typename std::allocator_traits<Allocator>::template rebind_alloc<std::max_align_t>;
+    using Traits = std::allocator_traits<Base>;
+    static_assert(std::is_same<typename Traits::pointer, std::max_align_t*>::value,
+                  "only allocators with raw pointers are supported");
+
+public:
+    ByteAllocator() noexcept(noexcept(Base()))
+        : Base() {}
+
+    explicit ByteAllocator(Allocator const& alloc) noexcept
+        : Base(alloc) {}
+
+    ByteAllocator(ByteAllocator const& o) noexcept
+        : Base(Traits::select_on_container_copy_construction(o)) {}
+
+    ByteAllocator(ByteAllocator&& o) noexcept
+        : Base(std::move(static_cast<Base&>(o))) {}
+
+    ByteAllocator& operator=(ByteAllocator&& o) noexcept {
+        propagate(o, typename Traits::propagate_on_container_move_assignment{});
+        return *this;
+    }
+
+    // NOLINTNEXTLINE(bugprone-unhandled-self-assignment,cert-oop54-cpp)
+    ByteAllocator& operator=(ByteAllocator const& ROBIN_HOOD_UNUSED(o) /*unused*/) noexcept {
+        // keeps the current allocator
+        return *this;
+    }
+
+    ~ByteAllocator() = default;
+
+    void* allocateBytes(size_t numBytes) {
+        return Traits::allocate(*this, numUnits(numBytes));
+    }
+
+    void deallocateBytes(void* ptr, size_t numBytes) noexcept {
+        Traits::deallocate(*this, static_cast<std::max_align_t*>(ptr), numUnits(numBytes));
+    }
+
+    // True when memory allocated by o can be deallocated by us after a move assignment.
+    ROBIN_HOOD(NODISCARD) bool canAdoptMemoryOf(ByteAllocator const& o) const noexcept {
+        return Traits::propagate_on_container_move_assignment::value ||
+               static_cast<Base const&>(*this) == static_cast<Base const&>(o);
+    }
+
+    ROBIN_HOOD(NODISCARD) Allocator get_allocator() const noexcept {
+        return Allocator(static_cast<Base const&>(*this));
+    }
+
+private:
+    static size_t numUnits(size_t numBytes) noexcept {
+        return (numBytes + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+    }
+
+    void propagate(ByteAllocator& o, std::true_type /*unused*/) noexcept {
+        Base::operator=(std::move(static_cast<Base&>(o)));
+    }
+
+    void propagate(ByteAllocator& ROBIN_HOOD_UNUSED(o) /*unused*/,
+                   std::false_type /*unused*/) noexcept {}
+};
+
 // Allocates bulks of memory for objects of type T. This deallocates the memory in the destructor,
-// and keeps a linked list of the allocated memory around. Overhead per allocation is the size of a
-// pointer.
-template <typename T, size_t MinNumAllocs = 4, size_t MaxNumAllocs = 256>
-class BulkPoolAllocator {
+// and keeps a linked list of the allocated memory around. Overhead per allocation is the size of
+// two pointers: the list link, and the size of the block for deallocation.
+template <typename T, size_t MinNumAllocs = 4, size_t MaxNumAllocs = 256,
+          typename Allocator = malloc_allocator<T>>
+class BulkPoolAllocator : public ByteAllocator<Allocator> {
+    using Bytes = ByteAllocator<Allocator>;
+
 public:
     BulkPoolAllocator() noexcept = default;
 
+    explicit BulkPoolAllocator(Allocator const& alloc) noexcept
+        : Bytes(alloc) {}
+
     // does not copy anything, just creates a new allocator.
-    BulkPoolAllocator(const BulkPoolAllocator& ROBIN_HOOD_UNUSED(o) /*unused*/) noexcept
-        : mHead(nullptr)
+    BulkPoolAllocator(const BulkPoolAllocator& o) noexcept
+        : Bytes(static_cast<Bytes const&>(o))
+        , mHead(nullptr)
         , mListForFree(nullptr) {}
 
     BulkPoolAllocator(BulkPoolAllocator&& o) noexcept
-        : mHead(o.mHead)
+        : Bytes(std::move(static_cast<Bytes&>(o)))
+        , mHead(o.mHead)
         , mListForFree(o.mListForFree) {
         o.mListForFree = nullptr;
         o.mHead = nullptr;
     }
 
+    // Only takes over o's memory when our allocator can deallocate it, see
+    // ByteAllocator::canAdoptMemoryOf(). Otherwise o keeps it.
     BulkPoolAllocator& operator=(BulkPoolAllocator&& o) noexcept {
+        if (!this->canAdoptMemoryOf(o)) {
+            return *this;
+        }
         reset();
+        Bytes::operator=(std::move(static_cast<Bytes&>(o)));
         mHead = o.mHead;
         mListForFree = o.mListForFree;
         o.mListForFree = nullptr;
@@ -402,12 +598,8 @@ public:
 
     // Deallocates all allocated memory.
     void reset() noexcept {
-        while (mListForFree) {
-            T* tmp = *mListForFree;
-            ROBIN_HOOD_LOG("std::free")
-            std::free(mListForFree);
-            mListForFree = reinterpret_cast_no_cast_align_warning<T**>(tmp);
-        }
+        freeBlocks(mListForFree);
+        mListForFree = nullptr;
         mHead = nullptr;
     }
 
@@ -434,27 +626,216 @@ public:
     }
 
     // Adds an already allocated block of memory to the allocator. This allocator is from now on
-    // responsible for freeing the data (with free()). If the provided data is not large enough to
-    // make use of, it is immediately freed. Otherwise it is reused and freed in the destructor.
+    // responsible for freeing the data (with its Allocator). If the provided data is not large
+    // enough to make use of, it is immediately freed. Otherwise it is reused and freed in the
+    // destructor.
     void addOrFree(void* ptr, const size_t numBytes) noexcept {
         // calculate number of available elements in ptr
-        if (numBytes < ALIGNMENT + ALIGNED_SIZE) {
+        if (numBytes < HEADER_SIZE + ALIGNED_SIZE) {
             // not enough data for at least one element. Free and return.
-            ROBIN_HOOD_LOG("std::free")
-            std::free(ptr);
+            this->deallocateBytes(ptr, numBytes);
         } else {
             ROBIN_HOOD_LOG("add to buffer")
             add(ptr, numBytes);
         }
     }
 
-    void swap(BulkPoolAllocator<T, MinNumAllocs, MaxNumAllocs>& other) noexcept {
+    void swap(BulkPoolAllocator& other) noexcept {
         using std::swap;
         swap(mHead, other.mHead);
         swap(mListForFree, other.mListForFree);
     }
 
+    // Sum of the sizes of all blocks, including the ones added with addOrFree.
+    ROBIN_HOOD(NODISCARD) size_t numBytesAllocated() const noexcept {
+        size_t numBytes = 0;
+        for (auto* b = mListForFree; b; b = reinterpret_cast_no_cast_align_warning<T**>(*b)) {
+            numBytes += *reinterpret_cast_no_cast_align_warning<size_t*>(b + 1);
+        }
+        return numBytes;
+    }
+
+    // Gives blocks back to the Allocator that are not needed for the live objects. nodes holds the
+    // address of each pointer to a live object. The densest blocks are kept, and the objects in
+    // all other blocks are moved into free slots of the kept ones, updating the pointers. Objects
+    // that can't be moved without throwing stay where they are, then only empty blocks are freed.
+    // Returns the number of bytes freed.
+    size_t shrink(std::vector<T**> const& nodes) {
+        static constexpr bool CanMove = std::is_nothrow_move_constructible<T>::value;
+
+        // all blocks sorted by address, so the block of an object can be found quickly
+        std::vector<Block> blocks;
+        for (auto* b = mListForFree; b; b = reinterpret_cast_no_cast_align_warning<T**>(*b)) {
+            auto const numBytes = *reinterpret_cast_no_cast_align_warning<size_t*>(b + 1);
+            blocks.push_back(Block{reinterpret_cast<char*>(b), numBytes, 0, true, 0});
+        }
+        std::sort(blocks.begin(), blocks.end(),
+                  [](Block const& a, Block const& b) { return a.data < b.data; });
+        for (auto* node : nodes) {
+            ++findBlock(blocks, *node).numLive;
+        }
+
+        // keep the densest blocks until all objects fit, or all used ones when we can't move
+        std::vector<Block*> byLive;
+        for (auto& block : blocks) {
+            byLive.push_back(&block);
+        }
+        std::stable_sort(byLive.begin(), byLive.end(),
+                         [](Block const* a, Block const* b) { return a->numLive > b->numLive; });
+        size_t capacity = 0;
+        for (auto* block : byLive) {
+            block->keep = CanMove ? capacity < nodes.size() : block->numLive != 0;
+            if (block->keep) {
+                capacity += block->capacity();
+            }
+        }
+        // the last blocks might not be needed when the denser ones have enough free slots
+        size_t numDropped = 0;
+        for (auto it = byLive.rbegin(); it != byLive.rend(); ++it) {
+            auto* block = *it;
+            if (CanMove && block->keep && capacity - block->capacity() >= nodes.size()) {
+                block->keep = false;
+                capacity -= block->capacity();
+            }
+            if (!block->keep) {
+                ++numDropped;
+            }
+        }
+        if (0 == numDropped) {
+            return 0;
+        }
+
+        // mark the slots used in kept blocks. Nothing is allocated after this.
+        std::vector<bool> used(capacity);
+        size_t offset = 0;
+        for (auto& block : blocks) {
+            if (block.keep) {
+                block.firstSlot = offset;
+                offset += block.capacity();
+            }
+        }
+        for (auto* node : nodes) {
+            auto const& block = findBlock(blocks, *node);
+            if (block.keep) {
+                used[block.firstSlot + block.slotOf(*node)] = true;
+            }
+        }
+
+        // the free list only contains the free slots of the kept blocks, lowest address first
+        mHead = nullptr;
+        for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+            if (!it->keep) {
+                continue;
+            }
+            for (size_t slot = it->capacity(); slot != 0; --slot) {
+                if (!used[it->firstSlot + slot - 1]) {
+                    deallocate(it->slot(slot - 1));
+                }
+            }
+        }
+
+        // move the objects out of the dropped blocks
+        for (auto* node : nodes) {
+            if (!findBlock(blocks, *node).keep) {
+                move(*node, std::integral_constant<bool, CanMove>{});
+            }
+        }
+
+        // free the dropped blocks, and link up the kept ones
+        size_t numBytesFreed = 0;
+        mListForFree = nullptr;
+        for (auto& block : blocks) {
+            if (block.keep) {
+                *reinterpret_cast_no_cast_align_warning<T***>(block.data) = mListForFree;
+                mListForFree = reinterpret_cast_no_cast_align_warning<T**>(block.data);
+            } else {
+                numBytesFreed += block.numBytes;
+                this->deallocateBytes(block.data, block.numBytes);
+            }
+        }
+        return numBytesFreed;
+    }
+
+    // Moves all objects into a single new block, in the order of nodes, and frees all other
+    // blocks. Visiting the objects in that order then walks memory sequentially. Objects that
+    // can't be moved without throwing stay where they are.
+    void relayout(std::vector<T**> const& nodes) {
+        using CanMove = std::integral_constant<bool, std::is_nothrow_move_constructible<T>::value>;
+        relayout(nodes, CanMove{});
+    }
+
 private:
+    void relayout(std::vector<T**> const& nodes, std::true_type canMove) {
+        size_t const bytes = HEADER_SIZE + ALIGNED_SIZE * nodes.size();
+        void* data = nodes.empty() ? nullptr : this->allocateBytes(bytes);
+
+        // the old blocks are only freed after all objects are moved out
+        auto* oldBlocks = mListForFree;
+        mListForFree = nullptr;
+        mHead = nullptr;
+        if (data) {
+            add(data, bytes);
+        }
+        for (auto* node : nodes) {
+            move(*node, canMove);
+        }
+        freeBlocks(oldBlocks);
+    }
+
+    void relayout(std::vector<T**> const& ROBIN_HOOD_UNUSED(nodes) /*unused*/,
+                  std::false_type /*unused*/) noexcept {}
+
+    void freeBlocks(T** list) noexcept {
+        while (list) {
+            T* tmp = *list;
+            auto const numBytes = *reinterpret_cast_no_cast_align_warning<size_t*>(list + 1);
+            this->deallocateBytes(list, numBytes);
+            list = reinterpret_cast_no_cast_align_warning<T**>(tmp);
+        }
+    }
+
+    // a block of memory while shrinking
+    struct Block {
+        char* data;
+        size_t numBytes;
+        size_t numLive;
+        bool keep;
+        size_t firstSlot;
+
+        ROBIN_HOOD(NODISCARD) size_t capacity() const noexcept {
+            return (numBytes - HEADER_SIZE) / ALIGNED_SIZE;
+        }
+
+        ROBIN_HOOD(NODISCARD) T* slot(size_t idx) const noexcept {
+            return reinterpret_cast_no_cast_align_warning<T*>(data + HEADER_SIZE +
+                                                              idx * ALIGNED_SIZE);
+        }
+
+        ROBIN_HOOD(NODISCARD) size_t slotOf(T const* obj) const noexcept {
+            auto const offset = static_cast<size_t>(reinterpret_cast<char const*>(obj) - data);
+            return (offset - HEADER_SIZE) / ALIGNED_SIZE;
+        }
+    };
+
+    // moves obj into a free slot
+    void move(T*& obj, std::true_type /*unused*/) noexcept {
+        T* to = allocate();
+        ::new (static_cast<void*>(to)) T(std::move(*obj));
+        obj->~T();
+        obj = to;
+    }
+
+    // never called: objects that can't be moved are only in kept blocks
+    void move(T*& ROBIN_HOOD_UNUSED(obj) /*unused*/, std::false_type /*unused*/) noexcept {}
+
+    // the block that contains obj. blocks is sorted by address.
+    static Block& findBlock(std::vector<Block>& blocks, T const* obj) noexcept {
+        auto const* p = reinterpret_cast<char const*>(obj);
+        auto it = std::upper_bound(blocks.begin(), blocks.end(), p,
+                                   [](char const* ptr, Block const& b) { return ptr < b.data; });
+        return *(it - 1);
+    }
+
     // iterates the list of allocated memory to calculate how many to alloc next.
     // Recalculating this each time saves us a size_t member.
     // This ignores the fact that memory blocks might have been added manually with addOrFree. In
@@ -472,20 +853,21 @@ private:
         return numAllocs;
     }
 
-    // WARNING: Underflow if numBytes < ALIGNMENT! This is guarded in addOrFree().
+    // WARNING: Underflow if numBytes < HEADER_SIZE! This is guarded in addOrFree().
     void add(void* ptr, const size_t numBytes) noexcept {
-        const size_t numElements = (numBytes - ALIGNMENT) / ALIGNED_SIZE;
+        const size_t numElements = (numBytes - HEADER_SIZE) / ALIGNED_SIZE;
 
         auto data = reinterpret_cast<T**>(ptr);
 
-        // link free list
+        // link free list, and remember the size for deallocation
         auto x = reinterpret_cast<T***>(data);
         *x = mListForFree;
+        *reinterpret_cast_no_cast_align_warning<size_t*>(data + 1) = numBytes;
         mListForFree = data;
 
         // create linked list for newly allocated data
         auto* const headT =
-            reinterpret_cast_no_cast_align_warning<T*>(reinterpret_cast<char*>(ptr) + ALIGNMENT);
+            reinterpret_cast_no_cast_align_warning<T*>(reinterpret_cast<char*>(ptr) + HEADER_SIZE);
 
         auto* const head = reinterpret_cast<char*>(headT);
 
@@ -506,11 +888,11 @@ private:
     ROBIN_HOOD(NOINLINE) T* performAllocation() {
         size_t const numElementsToAlloc = calcNumElementsToAlloc();
 
-        // alloc new memory: [prev |T, T, ... T]
-        size_t const bytes = ALIGNMENT + ALIGNED_SIZE * numElementsToAlloc;
-        ROBIN_HOOD_LOG("std::malloc " << bytes << " = " << ALIGNMENT << " + " << ALIGNED_SIZE
-                                      << " * " << numElementsToAlloc)
-        add(assertNotNull<std::bad_alloc>(std::malloc(bytes)), bytes);
+        // alloc new memory: [prev, size |T, T, ... T]
+        size_t const bytes = HEADER_SIZE + ALIGNED_SIZE * numElementsToAlloc;
+        ROBIN_HOOD_LOG("allocate " << bytes << " = " << HEADER_SIZE << " + " << ALIGNED_SIZE
+                                   << " * " << numElementsToAlloc)
+        add(this->allocateBytes(bytes), bytes);
         return mHead;
     }
 
@@ -527,6 +909,9 @@ private:
 
     static constexpr size_t ALIGNED_SIZE = ((sizeof(T) - 1) / ALIGNMENT + 1) * ALIGNMENT;
 
+    // each block starts with the link to the next block and its size
+    static constexpr size_t HEADER_SIZE = ((2 * sizeof(T*) - 1) / ALIGNMENT + 1) * ALIGNMENT;
+
     static_assert(MinNumAllocs >= 1, "MinNumAllocs");
     static_assert(MaxNumAllocs >= MinNumAllocs, "MaxNumAllocs");
     static_assert(ALIGNED_SIZE >= sizeof(T*), "ALIGNED_SIZE");
@@ -537,22 +922,134 @@ private:
     T** mListForFree{nullptr};
 };
 
-template <typename T, size_t MinSize, size_t MaxSize, bool IsFlat>
+} // namespace detail
+
+// Pool for the nodes of node maps with value_type T, see shared_node_allocator.
+template <typename T>
+using node_pool = detail::BulkPoolAllocator<T, 4, 16384>;
+
+// Allocator for node maps that don't keep their own node pool. Nodes come from a pool that is
+// shared with all other maps of the same value_type, and freed nodes go back to it. Many small
+// maps then don't each allocate their own blocks, and nodes freed by one map are reused by others.
+//
+// A default constructed shared_node_allocator uses a thread_local pool of the calling thread.
+// Such maps must only be used on one thread, and destroyed before that thread exits. Otherwise
+// pass a node_pool<value_type> explicitly: it must outlive all its maps, and is not thread safe.
+// The map's table itself is allocated with std::malloc.
+template <typename T>
+class shared_node_allocator {
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    template <typename U>
+    struct rebind {
+        using other = shared_node_allocator<U>;
+    };
+
+    // uses the thread_local pool
+    shared_node_allocator() noexcept = default;
+
+    template <typename V>
+    explicit shared_node_allocator(node_pool<V>& pool) noexcept
+        : mPool(&pool) {}
+
+    template <typename U>
+    shared_node_allocator(shared_node_allocator<U> const& o) noexcept
+        : mPool(o.pool()) {}
+
+    // the explicitly passed node_pool, or nullptr for the thread_local one.
+    ROBIN_HOOD(NODISCARD) void* pool() const noexcept {
+        return mPool;
+    }
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(detail::assertNotNull<std::bad_alloc>(std::malloc(n * sizeof(T))));
+    }
+
+    void deallocate(T* ptr, size_t ROBIN_HOOD_UNUSED(n) /*unused*/) noexcept {
+        std::free(ptr);
+    }
+
+private:
+    void* mPool = nullptr;
+};
+
+template <typename T, typename U>
+bool operator==(shared_node_allocator<T> const& a, shared_node_allocator<U> const& b) noexcept {
+    return a.pool() == b.pool();
+}
+
+template <typename T, typename U>
+bool operator!=(shared_node_allocator<T> const& a, shared_node_allocator<U> const& b) noexcept {
+    return !(a == b);
+}
+
+namespace detail {
+
+// OwnsNodes is false when the nodes are not freed together with the allocator, so the map has to
+// give each node back when it is destroyed.
+template <typename T, size_t MinSize, size_t MaxSize, bool IsFlat, typename Allocator>
 struct NodeAllocator;
 
-// dummy allocator that does nothing
-template <typename T, size_t MinSize, size_t MaxSize>
-struct NodeAllocator<T, MinSize, MaxSize, true> {
+// no nodes to allocate, only the table's memory
+template <typename T, size_t MinSize, size_t MaxSize, typename Allocator>
+struct NodeAllocator<T, MinSize, MaxSize, true, Allocator> : public ByteAllocator<Allocator> {
+    using ByteAllocator<Allocator>::ByteAllocator;
+    static constexpr bool OwnsNodes = true;
 
     // we are not using the data, so just free it.
-    void addOrFree(void* ptr, size_t ROBIN_HOOD_UNUSED(numBytes) /*unused*/) noexcept {
-        ROBIN_HOOD_LOG("std::free")
-        std::free(ptr);
+    void addOrFree(void* ptr, size_t numBytes) noexcept {
+        this->deallocateBytes(ptr, numBytes);
+    }
+
+    ROBIN_HOOD(NODISCARD) size_t numBytesAllocated() const noexcept {
+        return 0;
     }
 };
 
-template <typename T, size_t MinSize, size_t MaxSize>
-struct NodeAllocator<T, MinSize, MaxSize, false> : public BulkPoolAllocator<T, MinSize, MaxSize> {};
+template <typename T, size_t MinSize, size_t MaxSize, typename Allocator>
+struct NodeAllocator<T, MinSize, MaxSize, false, Allocator>
+    : public BulkPoolAllocator<T, MinSize, MaxSize, Allocator> {
+    using BulkPoolAllocator<T, MinSize, MaxSize, Allocator>::BulkPoolAllocator;
+    static constexpr bool OwnsNodes = true;
+};
+
+// all nodes come from the shared pool, and old tables are given to it as well.
+template <typename T, size_t MinSize, size_t MaxSize, typename U>
+struct NodeAllocator<T, MinSize, MaxSize, false, shared_node_allocator<U>>
+    : public ByteAllocator<shared_node_allocator<U>> {
+    using ByteAllocator<shared_node_allocator<U>>::ByteAllocator;
+    static constexpr bool OwnsNodes = false;
+
+    T* allocate() {
+        return sharedPool().allocate();
+    }
+
+    void deallocate(T* obj) noexcept {
+        sharedPool().deallocate(obj);
+    }
+
+    void addOrFree(void* ptr, size_t numBytes) noexcept {
+        sharedPool().addOrFree(ptr, numBytes);
+    }
+
+    // the shared pool does not belong to this map
+    ROBIN_HOOD(NODISCARD) size_t numBytesAllocated() const noexcept {
+        return 0;
+    }
+
+private:
+    node_pool<T>& sharedPool() const noexcept {
+        auto* pool = this->pool();
+        if (pool) {
+            return *static_cast<node_pool<T>*>(pool);
+        }
+        static thread_local node_pool<T> threadPool;
+        return threadPool;
+    }
+};
 
 // c++14 doesn't have is_nothrow_swappable, and clang++ 6.0.1 doesn't like it either, so I'm making
 // my own here.
@@ -739,7 +1236,7 @@ inline size_t hash_bytes(void const* ptr, size_t len) noexcept {
 
     h ^= h >> r;
 
-    // not doing the final step here, because this will be done by keyToIdx anyways
+    // not doing the final step here, because this will be done by hashToIdx anyways
     // h *= m;
     // h ^= h >> r;
     return static_cast<size_t>(h);
@@ -752,12 +1249,140 @@ inline size_t hash_int(uint64_t x) noexcept {
     x *= UINT64_C(0xff51afd7ed558ccd);
     x ^= x >> 33U;
 
-    // not doing the final step here, because this will be done by keyToIdx anyways
+    // not doing the final step here, because this will be done by hashToIdx anyways
     // x *= UINT64_C(0xc4ceb9fe1a85ec53);
     // x ^= x >> 33U;
     return static_cast<size_t>(x);
 }
 
+// True when the CPU supports the CRC32C and AES-NI instructions used by hash_bytes_hw and
+// hash_int_hw. Otherwise, and when compiled without ROBIN_HOOD(HAS_HW_HASH), this is false and
+// they fall back to hash_bytes and hash_int.
+//
+// The answer is computed once. __builtin_cpu_init() has to come first because this can run
+// before the runtime initialized the CPU model, e.g. from the constructor of a static map.
+inline bool has_hw_hash() noexcept {
+#if ROBIN_HOOD(HAS_HW_HASH)
+    static bool const supported = [] {
+        __builtin_cpu_init();
+        return 0 != __builtin_cpu_supports("sse4.2") && 0 != __builtin_cpu_supports("aes");
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+#if ROBIN_HOOD(HAS_HW_HASH)
+namespace detail {
+
+// CRC alone is linear, so some inputs that differ in a few bits would always collide. The
+// multiplication is bijective and not linear, and with the upper half of x fixed the CRC is
+// bijective in the lower half. So different x give different results.
+ROBIN_HOOD(TARGET_HW_HASH) inline uint64_t crc32cMix(uint64_t x, uint64_t seed) noexcept {
+    x *= UINT64_C(0xff51afd7ed558ccd);
+    return (x & UINT64_C(0xffffffff00000000)) | _mm_crc32_u64(seed, x);
+}
+
+// Up to 8 bytes are packed into one word, so data of the same length never collides. Up to 16
+// bytes are the first and the last 8 bytes, which overlap for less than 16 bytes.
+ROBIN_HOOD(TARGET_HW_HASH) inline size_t crc32cHashShort(uint8_t const* data, size_t len) noexcept {
+    if (len > 8) {
+        auto const a = crc32cMix(unaligned_load<uint64_t>(data), len);
+        return static_cast<size_t>(crc32cMix(a ^ unaligned_load<uint64_t>(data + len - 8), len));
+    }
+    uint64_t x = 0;
+    if (len >= 4) {
+        x = static_cast<uint64_t>(unaligned_load<uint32_t>(data)) << 32U |
+            unaligned_load<uint32_t>(data + len - 4);
+    } else if (len > 0) {
+        x = static_cast<uint64_t>(data[0]) << 16U | static_cast<uint64_t>(data[len / 2]) << 8U |
+            data[len - 1];
+    }
+    return static_cast<size_t>(crc32cMix(x, len));
+}
+
+// Four independent states that each take 16 bytes per AES round, so the rounds can be pipelined.
+// The last 1 to 64 bytes are loaded so that they end at the end of the data, then all states are
+// combined with a few more rounds.
+ROBIN_HOOD(TARGET_HW_HASH) inline size_t aesHashLong(uint8_t const* data, size_t len) noexcept {
+    auto const load = [data](size_t offset) {
+        return _mm_loadu_si128(
+            reinterpret_cast_no_cast_align_warning<__m128i const*>(data + offset));
+    };
+    // digits of pi
+    auto const k0 = _mm_set_epi64x(INT64_C(0x243f6a8885a308d3),
+                                   static_cast<int64_t>(UINT64_C(0x13198a2e03707344) ^ len));
+    auto const k1 = _mm_set_epi64x(static_cast<int64_t>(UINT64_C(0xa4093822299f31d0)),
+                                   INT64_C(0x082efa98ec4e6c89));
+    auto const k2 = _mm_set_epi64x(INT64_C(0x452821e638d01377),
+                                   static_cast<int64_t>(UINT64_C(0xbe5466cf34e90c6c)));
+    auto const k3 = _mm_set_epi64x(static_cast<int64_t>(UINT64_C(0xc0ac29b7c97c50dd)),
+                                   INT64_C(0x3f84d5b5b5470917));
+    auto s0 = k0;
+    auto s1 = k1;
+    auto s2 = k2;
+    auto s3 = k3;
+
+    size_t i = 0;
+    for (; i + 64 < len; i += 64) {
+        s0 = _mm_aesenc_si128(_mm_xor_si128(s0, load(i)), k0);
+        s1 = _mm_aesenc_si128(_mm_xor_si128(s1, load(i + 16)), k1);
+        s2 = _mm_aesenc_si128(_mm_xor_si128(s2, load(i + 32)), k2);
+        s3 = _mm_aesenc_si128(_mm_xor_si128(s3, load(i + 48)), k3);
+    }
+    auto const rest = len - i;
+    s0 = _mm_aesenc_si128(_mm_xor_si128(s0, load(len - 16)), k0);
+    if (rest > 16) {
+        s1 = _mm_aesenc_si128(_mm_xor_si128(s1, load(i)), k1);
+    }
+    if (rest > 32) {
+        s2 = _mm_aesenc_si128(_mm_xor_si128(s2, load(i + 16)), k2);
+    }
+    if (rest > 48) {
+        s3 = _mm_aesenc_si128(_mm_xor_si128(s3, load(i + 32)), k3);
+    }
+
+    s0 = _mm_aesenc_si128(s0, s1);
+    s2 = _mm_aesenc_si128(s2, s3);
+    s0 = _mm_aesenc_si128(s0, s2);
+    s0 = _mm_aesenc_si128(s0, k1);
+    s0 = _mm_aesenc_si128(s0, k0);
+    return static_cast<size_t>(_mm_cvtsi128_si64(s0) ^
+                               _mm_cvtsi128_si64(_mm_unpackhi_epi64(s0, s0)));
+}
+
+ROBIN_HOOD(TARGET_HW_HASH) inline size_t crc32cHashInt(uint64_t x) noexcept {
+    return static_cast<size_t>(crc32cMix(x, 0));
+}
+
+} // namespace detail
+#endif
+
+// Like hash_bytes, but uses CRC32C for up to 16 bytes and AES-NI for longer data when the CPU
+// supports it, otherwise it falls back to hash_bytes. The hash differs between these two cases, so
+// don't persist it. save() records which case a hash_hw map used, and load() rejects the image
+// on a machine with the other one.
+inline size_t hash_bytes_hw(void const* ptr, size_t len) noexcept {
+#if ROBIN_HOOD(HAS_HW_HASH)
+    if (ROBIN_HOOD_LIKELY(has_hw_hash())) {
+        auto const* const data = static_cast<uint8_t const*>(ptr);
+        return len <= 16 ? detail::crc32cHashShort(data, len) : detail::aesHashLong(data, len);
+    }
+#endif
+    return hash_bytes(ptr, len);
+}
+
+// Like hash_int, but uses CRC32C when the CPU supports it.
+inline size_t hash_int_hw(uint64_t x) noexcept {
+#if ROBIN_HOOD(HAS_HW_HASH)
+    if (ROBIN_HOOD_LIKELY(has_hw_hash())) {
+        return detail::crc32cHashInt(x);
+    }
+#endif
+    return hash_int(x);
+}
+
 // A thin wrapper around std::hash, performing an additional simple mixing step of the result.
 template <typename T, typename Enable = void>
 struct hash : public std::hash<T> {
@@ -848,15 +1473,148 @@ ROBIN_HOOD_HASH_INT(unsigned long long);
 #if defined(__GNUC__) && !defined(__clang__)
 #    pragma GCC diagnostic pop
 #endif
-namespace detail {
 
-template <typename T>
-struct void_type {
-    using type = void;
+// Opt-in hash that uses hash_bytes_hw for strings and hash_int_hw for integers, and hash for
+// everything else. E.g. unordered_flat_map<std::string, int, robin_hood::hash_hw<std::string>>.
+template <typename T, typename Enable = void>
+struct hash_hw : public hash<T> {};
+
+template <typename CharT>
+struct hash_hw<std::basic_string<CharT>> {
+    size_t operator()(std::basic_string<CharT> const& str) const noexcept {
+        return hash_bytes_hw(str.data(), sizeof(CharT) * str.size());
+    }
 };
 
-template <typename T, typename = void>
-struct has_is_transparent : public std::false_type {};
+#if ROBIN_HOOD(CXX) >= ROBIN_HOOD(CXX17)
+template <typename CharT>
+struct hash_hw<std::basic_string_view<CharT>> {
+    size_t operator()(std::basic_string_view<CharT> const& sv) const noexcept {
+        return hash_bytes_hw(sv.data(), sizeof(CharT) * sv.size());
+    }
+};
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+#    pragma GCC diagnostic push
+#    pragma GCC diagnostic ignored "-Wuseless-cast"
+#endif
+template <typename T>
+struct hash_hw<T, typename std::enable_if<std::is_integral<T>::value>::type> {
+    size_t operator()(T const& obj) const noexcept {
+        return hash_int_hw(static_cast<uint64_t>(obj));
+    }
+};
+#if defined(__GNUC__) && !defined(__clang__)
+#    pragma GCC diagnostic pop
+#endif
+
+// Writes and reads keys and values for Table::serialize() and Table::deserialize(). out is called
+// as out(void const* data, size_t size), in as in(void* data, size_t size) and throws when there's
+// not enough data. Specialize it to serialize your own types. A specialization can declare the
+// fewest bytes read() consumes as static constexpr size_t min_size, so that deserialize() can
+// reject element counts that the input is too small for. Otherwise 1 is assumed.
+template <typename T, typename Enable = void>
+struct serializer;
+
+// raw bytes, so only readable on machines with the same endianness and type sizes
+template <typename T>
+struct serializer<T, typename std::enable_if<ROBIN_HOOD_IS_TRIVIALLY_COPYABLE(T)>::type> {
+    static constexpr size_t min_size = sizeof(T);
+
+    template <typename Out>
+    static void write(Out& out, T const& obj) {
+        out(&obj, sizeof(T));
+    }
+
+    template <typename In>
+    static T read(In& in) {
+        T obj;
+        in(&obj, sizeof(T));
+        return obj;
+    }
+};
+
+template <typename CharT, typename Traits, typename Allocator>
+struct serializer<std::basic_string<CharT, Traits, Allocator>> {
+    using String = std::basic_string<CharT, Traits, Allocator>;
+
+    // the length
+    static constexpr size_t min_size = sizeof(uint64_t);
+
+    template <typename Out>
+    static void write(Out& out, String const& str) {
+        serializer<uint64_t>::write(out, static_cast<uint64_t>(str.size()));
+        out(str.data(), str.size() * sizeof(CharT));
+    }
+
+    template <typename In>
+    static String read(In& in) {
+        String str(static_cast<size_t>(serializer<uint64_t>::read(in)), CharT());
+        if (!str.empty()) {
+            in(&str[0], str.size() * sizeof(CharT));
+        }
+        return str;
+    }
+};
+
+// Layout of a map's table, see stats(). The distance of an element is the number of buckets it is
+// away from the bucket its hash points to, so finding it takes distance + 1 probes.
+struct table_stats {
+    // number of elements for each distance
+    std::vector<size_t> distance_histogram{};
+    size_t max_probe_length = 0;
+    double mean_probe_length = 0.0;
+    // most consecutive occupied buckets
+    size_t longest_cluster = 0;
+    size_t info_inc = 0;
+    size_t info_hash_shift = 0;
+    // info bytes and nodes, or node pointers for node maps
+    size_t table_bytes = 0;
+    // blocks of the node pool. 0 for flat maps and maps that use a shared_node_allocator.
+    size_t node_pool_bytes = 0;
+    float load_factor = 0.0F;
+};
+
+namespace detail {
+
+template <typename Map>
+class MappedTable;
+
+// build_parallel(), see robin_hood_concurrent.h
+struct ParallelBuild;
+
+// Tells apart hashes that differ between machines, so that an image written by save() is only used
+// where the keys hash the same way. hash_hw depends on the CPU, unless it is plain hash.
+template <typename Hash>
+struct ImageHashVariant {
+    static uint64_t get() noexcept {
+        return 0;
+    }
+};
+
+template <typename T>
+struct ImageHashVariant<hash_hw<T>> {
+    static uint64_t get() noexcept {
+        return std::is_base_of<hash<T>, hash_hw<T>>::value ? 0 : has_hw_hash() ? 2 : 1;
+    }
+};
+
+template <typename T>
+struct void_type {
+    using type = void;
+};
+
+// serializer<T>::min_size, or 1 when the serializer doesn't declare it.
+template <typename T, typename = void>
+struct SerializedMinSize : public std::integral_constant<size_t, 1> {};
+
+template <typename T>
+struct SerializedMinSize<T, typename void_type<decltype(serializer<T>::min_size)>::type>
+    : public std::integral_constant<size_t, serializer<T>::min_size> {};
+
+template <typename T, typename = void>
+struct has_is_transparent : public std::false_type {};
 
 template <typename T>
 struct has_is_transparent<T, typename void_type<typename T::is_transparent>::type>
@@ -878,6 +1636,39 @@ struct WrapKeyEqual : public T {
         : T(o) {}
 };
 
+// for classes that keep an allocator without a NodeAllocator, e.g. small_flat_map.
+template <typename T>
+struct WrapAllocator : public T {
+    WrapAllocator() = default;
+    explicit WrapAllocator(T const& o) noexcept
+        : T(o) {}
+};
+
+// State of a pending incremental rehash, see Table::set_incremental_rehash(). Defined after Table.
+template <typename Table>
+struct IncrementalRehashState;
+
+// Base of Table that owns the incremental rehash state. Only maps with Incremental = true have
+// it, the others get an empty base and incremental() is always nullptr.
+template <typename Table, bool Incremental>
+struct IncrementalRehashHolder {
+    IncrementalRehashState<Table>* incremental() noexcept {
+        return mIncremental.get();
+    }
+    IncrementalRehashState<Table> const* incremental() const noexcept {
+        return mIncremental.get();
+    }
+
+    std::unique_ptr<IncrementalRehashState<Table>> mIncremental{};
+};
+
+template <typename Table>
+struct IncrementalRehashHolder<Table, false> {
+    static IncrementalRehashState<Table>* incremental() noexcept {
+        return nullptr;
+    }
+};
+
 // A highly optimized hashmap implementation, using the Robin Hood algorithm.
 //
 // In most cases, this map should be usable as a drop-in replacement for std::unordered_map, but
@@ -890,9 +1681,10 @@ struct WrapKeyEqual : public T {
 // * Node: either a DataNode that directly has the std::pair<key, val> as member,
 //   or a DataNode with a pointer to std::pair<key,val>. Which DataNode representation to use
 //   depends on how fast the swap() operation is. Heuristically, this is automatically choosen
-//   based on sizeof(). there are always 2^n Nodes.
+//   based on sizeof(). By default there are always 2^n Nodes, see GrowthFactor100 below.
 //
-// * info: Each Node in the map has a corresponding info byte, so there are 2^n info bytes.
+// * info: Each Node in the map has a corresponding info byte, so there are as many info bytes as
+//   Nodes.
 //   Each byte is initialized to 0, meaning the corresponding Node is empty. Set to 1 means the
 //   corresponding node contains data. Set to 2 means the corresponding Node is filled, but it
 //   actually belongs to the previous position and was pushed out because that place is already
@@ -901,11 +1693,27 @@ struct WrapKeyEqual : public T {
 // * infoSentinel: Sentinel byte set to 1, so that iterator's ++ can stop at end() without the
 //   need for a idx variable.
 //
+// GrowthFactor100 is the growth factor in percent. With the default of 200 the number of buckets
+// is always a power of two, and the bucket is selected with a mask. Any other value allows any
+// number of buckets: growing multiplies it by GrowthFactor100 / 100, reserve() and compact()
+// allocate just as many buckets as necessary, and the bucket is selected with a multiply-high
+// range reduction. This saves lots of memory for big maps, at the cost of a multiplication per
+// lookup and more frequent rehashing.
+//
+// WideInfo uses 16 bit info entries instead of bytes. They hold 8 bits of the hash instead of 5,
+// and distances of up to 1022 buckets instead of 127, so a weak hash that maps many keys to the
+// same value neither makes the map grow early nor overflow. Costs one more byte per bucket.
+//
+// Incremental enables set_incremental_rehash(), see there. Iterators get two more pointers, the
+// other maps don't pay anything for it.
+//
 // According to STL, order of templates has effect on throughput. That's why I've moved the
 // boolean to the front.
 // https://www.reddit.com/r/cpp/comments/ahp6iu/compile_time_binary_size_reductions_and_cs_future/eeguck4/
 template <bool IsFlat, size_t MaxLoadFactor100, typename Key, typename T, typename Hash,
-          typename KeyEqual>
+          typename KeyEqual, bool StoreHash = false, size_t GrowthFactor100 = 200,
+          typename Allocator = malloc_allocator<char>, bool WideInfo = false,
+          bool Incremental = false>
 class Table
     : public WrapHash<Hash>,
       public WrapKeyEqual<KeyEqual>,
@@ -913,7 +1721,11 @@ class Table
           typename std::conditional<
               std::is_void<T>::value, Key,
               robin_hood::pair<typename std::conditional<IsFlat, Key, Key const>::type, T>>::type,
-          4, 16384, IsFlat> {
+          4, 16384, IsFlat, Allocator>,
+      detail::IncrementalRehashHolder<Table<IsFlat, MaxLoadFactor100, Key, T, Hash, KeyEqual,
+                                            StoreHash, GrowthFactor100, Allocator, WideInfo,
+                                            Incremental>,
+                                      Incremental> {
 public:
     static constexpr bool is_flat = IsFlat;
     static constexpr bool is_map = !std::is_void<T>::value;
@@ -929,11 +1741,16 @@ public:
     using size_type = size_t;
     using hasher = Hash;
     using key_equal = KeyEqual;
-    using Self = Table<IsFlat, MaxLoadFactor100, key_type, mapped_type, hasher, key_equal>;
+    using allocator_type = Allocator;
+    using Self = Table<IsFlat, MaxLoadFactor100, key_type, mapped_type, hasher, key_equal,
+                       StoreHash, GrowthFactor100, Allocator, WideInfo, Incremental>;
 
 private:
     static_assert(MaxLoadFactor100 > 10 && MaxLoadFactor100 < 100,
                   "MaxLoadFactor100 needs to be >10 && < 100");
+    static_assert(!IsFlat || !StoreHash, "StoreHash is only supported for node based tables");
+    static_assert(GrowthFactor100 > 100 && GrowthFactor100 <= 400,
+                  "GrowthFactor100 needs to be >100 && <= 400");
 
     using WHash = WrapHash<Hash>;
     using WKeyEqual = WrapKeyEqual<KeyEqual>;
@@ -942,21 +1759,33 @@ private:
 
     // make sure we have 8 elements, needed to quickly rehash mInfo
     static constexpr size_t InitialNumElements = sizeof(uint64_t);
-    static constexpr uint32_t InitialInfoNumBits = 5;
-    static constexpr uint8_t InitialInfoInc = 1U << InitialInfoNumBits;
+    static constexpr uint32_t InitialInfoNumBits = WideInfo ? 8 : 5;
+    static constexpr uint32_t InitialInfoInc = 1U << InitialInfoNumBits;
     static constexpr size_t InfoMask = InitialInfoInc - 1U;
     static constexpr uint8_t InitialInfoHashShift = 0;
-    using DataPool = detail::NodeAllocator<value_type, 4, 16384, IsFlat>;
+    static constexpr bool PowerOfTwoSizes = GrowthFactor100 == 200;
+    using DataPool = detail::NodeAllocator<value_type, 4, 16384, IsFlat, Allocator>;
+    using IncrementalHolder = detail::IncrementalRehashHolder<Self, Incremental>;
+    using IncrementalRehash = detail::IncrementalRehashState<Self>;
 
     // type needs to be wider than uint8_t.
     using InfoType = uint32_t;
 
+    // One entry of the info array. Stored infos never exceed MaxInfo, and try_increase_info()
+    // stops at MinInfoInc, so the distance of an entry to its bucket stays below MaxNumBuffer.
+    // MaxInfo is one less than the largest InfoEntry, so the saturating add in matchGroup() never
+    // produces an expected info that is equal to a stored one.
+    using InfoEntry = typename std::conditional<WideInfo, uint16_t, uint8_t>::type;
+    static constexpr InfoType MaxInfo = WideInfo ? 0xFFFE : 0xFE;
+    static constexpr InfoType MinInfoInc = WideInfo ? 64 : 2;
+    static constexpr size_t MaxNumBuffer = WideInfo ? 0x3FF : 0xFF;
+
     // DataNode ////////////////////////////////////////////////////////
 
     // Primary template for the data node. We have special implementations for small and big
     // objects. For large objects it is assumed that swap() is fairly slow, so we allocate these
     // on the heap so swap merely swaps a pointer.
-    template <typename M, bool>
+    template <typename M, bool, bool = false>
     class DataNode {};
 
     // Small: just allocate on the stack.
@@ -1058,6 +1887,11 @@ private:
             mData->~value_type();
         }
 
+        // where the data pointer is stored, so the pool can move the data.
+        value_type** dataAddress() noexcept {
+            return &mData;
+        }
+
         value_type const* operator->() const noexcept {
             return mData;
         }
@@ -1118,7 +1952,90 @@ private:
         value_type* mData;
     };
 
-    using Node = DataNode<Self, IsFlat>;
+    // big object that additionally stores the hash of its key. Rehashing can then use the stored
+    // hash, and most unequal keys are already rejected by comparing the hash.
+    template <typename M>
+    class DataNode<M, false, true> : public DataNode<M, false> {
+        using Base = DataNode<M, false>;
+
+    public:
+        template <typename... Args>
+        explicit DataNode(M& map, Args&&... args)
+            : Base(map, std::forward<Args>(args)...) {}
+
+        DataNode(M& map, DataNode<M, false, true>&& n) noexcept
+            : Base(map, static_cast<Base&&>(n))
+            , mHash(n.mHash) {}
+
+        ROBIN_HOOD(NODISCARD) size_t getHash() const noexcept {
+            return mHash;
+        }
+
+        void setHash(size_t h) noexcept {
+            mHash = h;
+        }
+
+        void swap(DataNode<M, false, true>& o) noexcept {
+            using std::swap;
+            Base::swap(o);
+            swap(mHash, o.mHash);
+        }
+
+    private:
+        size_t mHash{};
+    };
+
+    using Node = DataNode<Self, IsFlat, StoreHash>;
+    using StoresHash = std::integral_constant<bool, StoreHash>;
+    static_assert(!WideInfo || alignof(Node) >= alignof(uint16_t),
+                  "WideInfo needs nodes that are at least 2 byte aligned");
+
+    // Hash of the key in node n. Uses the stored hash if there is one.
+    ROBIN_HOOD(NODISCARD) size_t nodeHash(Node const& n) const {
+        return nodeHash(n, StoresHash{});
+    }
+
+    ROBIN_HOOD(NODISCARD) size_t nodeHash(Node const& n, std::true_type /*unused*/) const noexcept {
+        return n.getHash();
+    }
+
+    ROBIN_HOOD(NODISCARD) size_t nodeHash(Node const& n, std::false_type /*unused*/) const {
+        return static_cast<size_t>(WHash::operator()(n.getFirst()));
+    }
+
+    // Remembers hash h in the node at idx, if hashes are stored.
+    void setNodeHash(size_t idx, size_t h) noexcept {
+        setNodeHash(idx, h, StoresHash{});
+    }
+
+    void setNodeHash(size_t idx, size_t h, std::true_type /*unused*/) noexcept {
+        mKeyVals[idx].setHash(h);
+    }
+
+    void setNodeHash(size_t ROBIN_HOOD_UNUSED(idx) /*unused*/,
+                     size_t ROBIN_HOOD_UNUSED(h) /*unused*/,
+                     std::false_type /*unused*/) noexcept {}
+
+    // Compares key, which has the hash h, with the key in node n. When hashes are stored, most
+    // unequal keys are rejected without calling KeyEqual.
+    template <typename Other>
+    ROBIN_HOOD(NODISCARD)
+    bool nodeKeyEquals(Other const& key, size_t h, Node const& n) const {
+        return nodeKeyEquals(key, h, n, StoresHash{});
+    }
+
+    template <typename Other>
+    ROBIN_HOOD(NODISCARD)
+    bool nodeKeyEquals(Other const& key, size_t h, Node const& n, std::true_type /*unused*/) const {
+        return n.getHash() == h && WKeyEqual::operator()(key, n.getFirst());
+    }
+
+    template <typename Other>
+    ROBIN_HOOD(NODISCARD)
+    bool nodeKeyEquals(Other const& key, size_t ROBIN_HOOD_UNUSED(h) /*unused*/, Node const& n,
+                       std::false_type /*unused*/) const {
+        return WKeyEqual::operator()(key, n.getFirst());
+    }
 
     // helpers for insertKeyPrepareEmptySpot: extract first entry (only const required)
     ROBIN_HOOD(NODISCARD) key_type const& getFirstConst(Node const& n) const noexcept {
@@ -1139,6 +2056,16 @@ private:
         return vt.first;
     }
 
+    // build_parallel() can also be called with ranges of other pairs, e.g. std::pair<Key, T>
+    template <typename P>
+    ROBIN_HOOD(NODISCARD)
+    typename std::enable_if<
+        !std::is_same<P, value_type>::value &&
+            std::is_same<typename std::remove_const<typename P::first_type>::type, key_type>::value,
+        key_type const&>::type getFirstConst(P const& p) const noexcept {
+        return p.first;
+    }
+
     // Cloner //////////////////////////////////////////////////////////
 
     template <typename M, bool UseMemcpy>
@@ -1159,11 +2086,12 @@ private:
     struct Cloner<M, false> {
         void operator()(M const& s, M& t) const {
             auto const numElementsWithBuffer = t.calcNumElementsWithBuffer(t.mMask + 1);
-            std::copy(s.mInfo, s.mInfo + t.calcNumBytesInfo(numElementsWithBuffer), t.mInfo);
+            std::copy(s.mInfo, s.mInfo + t.calcNumInfos(numElementsWithBuffer), t.mInfo);
 
             for (size_t i = 0; i < numElementsWithBuffer; ++i) {
                 if (t.mInfo[i]) {
                     ::new (static_cast<void*>(t.mKeyVals + i)) Node(t, *s.mKeyVals[i]);
+                    t.setNodeHash(i, s.nodeHash(s.mKeyVals[i]));
                 }
             }
         }
@@ -1219,10 +2147,51 @@ private:
 
     struct fast_forward_tag {};
 
+    // Where an iterator continues after the sentinel of the new arrays: the old arrays of a
+    // pending incremental rehash, or nullptr. Empty unless Incremental.
+    template <typename NodePtr, bool HasNext = Incremental>
+    struct IterNext {
+        template <typename OtherNodePtr>
+        void assignNext(IterNext<OtherNodePtr> const& o) noexcept {
+            mNextKeyVals = o.mNextKeyVals;
+            mNextInfo = o.mNextInfo;
+        }
+
+        void setNext(NodePtr keyVals, InfoEntry const* info) noexcept {
+            mNextKeyVals = keyVals;
+            mNextInfo = info;
+        }
+
+        // Moves keyVals and info over to the old arrays, if there are any.
+        bool takeNext(NodePtr* keyVals, InfoEntry const** info) noexcept {
+            if (nullptr == mNextKeyVals) {
+                return false;
+            }
+            *keyVals = mNextKeyVals;
+            *info = mNextInfo;
+            mNextKeyVals = nullptr;
+            mNextInfo = nullptr;
+            return true;
+        }
+
+        NodePtr mNextKeyVals{nullptr};
+        InfoEntry const* mNextInfo{nullptr};
+    };
+
+    template <typename NodePtr>
+    struct IterNext<NodePtr, false> {
+        template <typename OtherNodePtr>
+        void assignNext(IterNext<OtherNodePtr> const& /*unused*/) noexcept {}
+        void setNext(NodePtr /*unused*/, InfoEntry const* /*unused*/) noexcept {}
+        static bool takeNext(NodePtr* /*unused*/, InfoEntry const** /*unused*/) noexcept {
+            return false;
+        }
+    };
+
     // generic iterator for both const_iterator and iterator.
     template <bool IsConst>
     // NOLINTNEXTLINE(hicpp-special-member-functions,cppcoreguidelines-special-member-functions)
-    class Iter {
+    class Iter : IterNext<typename std::conditional<IsConst, Node const*, Node*>::type> {
     private:
         using NodePtr = typename std::conditional<IsConst, Node const*, Node*>::type;
 
@@ -1246,13 +2215,15 @@ private:
         // NOLINTNEXTLINE(hicpp-explicit-conversions)
         Iter(Iter<OtherIsConst> const& other) noexcept
             : mKeyVals(other.mKeyVals)
-            , mInfo(other.mInfo) {}
+            , mInfo(other.mInfo) {
+            this->assignNext(other);
+        }
 
-        Iter(NodePtr valPtr, uint8_t const* infoPtr) noexcept
+        Iter(NodePtr valPtr, InfoEntry const* infoPtr) noexcept
             : mKeyVals(valPtr)
             , mInfo(infoPtr) {}
 
-        Iter(NodePtr valPtr, uint8_t const* infoPtr,
+        Iter(NodePtr valPtr, InfoEntry const* infoPtr,
              fast_forward_tag ROBIN_HOOD_UNUSED(tag) /*unused*/) noexcept
             : mKeyVals(valPtr)
             , mInfo(infoPtr) {
@@ -1264,6 +2235,7 @@ private:
         Iter& operator=(Iter<OtherIsConst> const& other) noexcept {
             mKeyVals = other.mKeyVals;
             mInfo = other.mInfo;
+            this->assignNext(other);
             return *this;
         }
 
@@ -1271,7 +2243,7 @@ private:
         Iter& operator++() noexcept {
             mInfo++;
             mKeyVals++;
-            fastForward();
+            forward();
             return *this;
         }
 
@@ -1300,24 +2272,41 @@ private:
         }
 
     private:
+        // Table sets up the next arrays before forwarding.
+        Iter(NodePtr valPtr, InfoEntry const* infoPtr, NodePtr nextKeyVals,
+             InfoEntry const* nextInfo) noexcept
+            : mKeyVals(valPtr)
+            , mInfo(infoPtr) {
+            this->setNext(nextKeyVals, nextInfo);
+        }
+
+        // fast forward to the next occupied slot, or end(). The sentinel is the only info entry
+        // that is 1, that's where the old arrays of a pending rehash follow.
+        void forward() noexcept {
+            fastForward();
+            if (Incremental && 1U == *mInfo && this->takeNext(&mKeyVals, &mInfo)) {
+                fastForward();
+            }
+        }
+
         // fast forward to the next non-free info byte
         // I've tried a few variants that don't depend on intrinsics, but unfortunately they are
         // quite a bit slower than this one. So I've reverted that change again. See map_benchmark.
         void fastForward() noexcept {
             size_t n = 0;
             while (0U == (n = detail::unaligned_load<size_t>(mInfo))) {
-                mInfo += sizeof(size_t);
-                mKeyVals += sizeof(size_t);
+                mInfo += sizeof(size_t) / sizeof(InfoEntry);
+                mKeyVals += sizeof(size_t) / sizeof(InfoEntry);
             }
 #if defined(ROBIN_HOOD_DISABLE_INTRINSICS)
             // we know for certain that within the next 8 bytes we'll find a non-zero one.
             if (ROBIN_HOOD_UNLIKELY(0U == detail::unaligned_load<uint32_t>(mInfo))) {
-                mInfo += 4;
-                mKeyVals += 4;
+                mInfo += 4 / sizeof(InfoEntry);
+                mKeyVals += 4 / sizeof(InfoEntry);
             }
             if (ROBIN_HOOD_UNLIKELY(0U == detail::unaligned_load<uint16_t>(mInfo))) {
-                mInfo += 2;
-                mKeyVals += 2;
+                mInfo += 2 / sizeof(InfoEntry);
+                mKeyVals += 2 / sizeof(InfoEntry);
             }
             if (ROBIN_HOOD_UNLIKELY(0U == *mInfo)) {
                 mInfo += 1;
@@ -1325,18 +2314,21 @@ private:
             }
 #else
 #    if ROBIN_HOOD(LITTLE_ENDIAN)
-            auto inc = ROBIN_HOOD_COUNT_TRAILING_ZEROES(n) / 8;
+            auto inc =
+                static_cast<size_t>(ROBIN_HOOD_COUNT_TRAILING_ZEROES(n)) / (8 * sizeof(InfoEntry));
 #    else
-            auto inc = ROBIN_HOOD_COUNT_LEADING_ZEROES(n) / 8;
+            auto inc =
+                static_cast<size_t>(ROBIN_HOOD_COUNT_LEADING_ZEROES(n)) / (8 * sizeof(InfoEntry));
 #    endif
             mInfo += inc;
             mKeyVals += inc;
 #endif
         }
 
-        friend class Table<IsFlat, MaxLoadFactor100, key_type, mapped_type, hasher, key_equal>;
+        friend class Table<IsFlat, MaxLoadFactor100, key_type, mapped_type, hasher, key_equal,
+                           StoreHash, GrowthFactor100, Allocator, WideInfo, Incremental>;
         NodePtr mKeyVals{nullptr};
-        uint8_t const* mInfo{nullptr};
+        InfoEntry const* mInfo{nullptr};
     };
 
     ////////////////////////////////////////////////////////////////////
@@ -1344,19 +2336,24 @@ private:
     // highly performance relevant code.
     // Lower bits are used for indexing into the array (2^n size)
     // The upper 1-5 bits need to be a reasonable good hash, to save comparisons.
-    template <typename HashKey>
-    void keyToIdx(HashKey&& key, size_t* idx, InfoType* info) const {
+    // hashValue is the hash of the key as calculated by hash_for().
+    void hashToIdx(size_t hashValue, size_t* idx, InfoType* info) const {
         // In addition to whatever hash is used, add another mul & shift so we get better hashing.
         // This serves as a bad hash prevention, if the given data is
         // badly mixed.
-        auto h = static_cast<uint64_t>(WHash::operator()(key));
+        auto h = static_cast<uint64_t>(hashValue);
 
         h *= mHashMultiplier;
         h ^= h >> 33U;
 
         // the lower InitialInfoNumBits are reserved for info.
         *info = mInfoInc + static_cast<InfoType>((h & InfoMask) >> mInfoHashShift);
-        *idx = (static_cast<size_t>(h) >> InitialInfoNumBits) & mMask;
+        if (PowerOfTwoSizes) {
+            *idx = (static_cast<size_t>(h) >> InitialInfoNumBits) & mMask;
+        } else {
+            // multiply-high uses mostly the upper bits, the info bits are the lowest.
+            *idx = static_cast<size_t>(mulhi(h, static_cast<uint64_t>(mMask) + 1U));
+        }
     }
 
     // forwards the index by one, wrapping around at the end
@@ -1372,6 +2369,55 @@ private:
         }
     }
 
+#if ROBIN_HOOD(HAS_SSE2)
+    // Number of infos compared at once, one 16 byte load. A group never starts after the sentinel,
+    // and mInfo has 16 bytes of padding starting at the sentinel, so the load stays inside.
+    static constexpr size_t GroupSize = 16 / sizeof(InfoEntry);
+
+    // Compares the GroupSize infos starting at idx against the expected sequence info,
+    // info + mInfoInc, info + 2 * mInfoInc, ... . The low GroupSize bits of the result mark lanes
+    // with matching info, the next GroupSize bits lanes where the probe sequence has ended because
+    // the stored info is smaller.
+    ROBIN_HOOD(NODISCARD) uint32_t matchGroup(size_t idx, InfoType info) const noexcept {
+        // mInfoInc is always InitialInfoInc >> mInfoHashShift
+        auto const incShift = InitialInfoNumBits - mInfoHashShift;
+        auto const shiftCount = _mm_cvtsi32_si128(static_cast<int>(incShift));
+        auto const infos =
+            _mm_loadu_si128(reinterpret_cast_no_cast_align_warning<__m128i const*>(mInfo + idx));
+        if (WideInfo) {
+            // the expected values saturate at 0xFFFF, which is more than MaxInfo, and both sides
+            // are biased for the signed comparison.
+            auto const steps = _mm_sll_epi16(_mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7), shiftCount);
+            auto const expected = _mm_adds_epu16(
+                _mm_set1_epi16(static_cast<short>((std::min)(info, InfoType(0xFFFF)))), steps);
+            auto const bias = _mm_set1_epi16(static_cast<short>(0x8000));
+            auto const matchAndEnd = _mm_packs_epi16(
+                _mm_cmpeq_epi16(infos, expected),
+                _mm_cmplt_epi16(_mm_xor_si128(infos, bias), _mm_xor_si128(expected, bias)));
+            return static_cast<uint32_t>(_mm_movemask_epi8(matchAndEnd));
+        }
+
+        // the expected values saturate at 0xFF, which is more than MaxInfo.
+        auto const steps = _mm_packus_epi16(
+            _mm_sll_epi16(_mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7), shiftCount),
+            _mm_sll_epi16(_mm_setr_epi16(8, 9, 10, 11, 12, 13, 14, 15), shiftCount));
+        auto const expected = _mm_adds_epu8(
+            _mm_set1_epi8(static_cast<char>((std::min)(info, InfoType(0xFF)))), steps);
+        auto const match = _mm_cmpeq_epi8(infos, expected);
+        // expected - infos saturates to 0 where infos >= expected
+        auto const notLess = _mm_cmpeq_epi8(_mm_subs_epu8(expected, infos), _mm_setzero_si128());
+        return static_cast<uint32_t>(_mm_movemask_epi8(match)) |
+               ((~static_cast<uint32_t>(_mm_movemask_epi8(notLess)) & 0xFFFFU) << GroupSize);
+    }
+
+    // Lanes of a matchGroup() result that match and still belong to the probe sequence.
+    static uint32_t groupMatches(uint32_t bits) noexcept {
+        auto const endBits = bits >> GroupSize;
+        // endBits == 0 gives all ones
+        return bits & ((endBits & (0U - endBits)) - 1U) & ((1U << GroupSize) - 1U);
+    }
+#endif
+
     // Shift everything up by one element. Tries to move stuff around.
     void
     shiftUp(size_t startIdx,
@@ -1384,9 +2430,8 @@ private:
 
         idx = startIdx;
         while (idx != insertion_idx) {
-            ROBIN_HOOD_COUNT(shiftUp)
-            mInfo[idx] = static_cast<uint8_t>(mInfo[idx - 1] + mInfoInc);
-            if (ROBIN_HOOD_UNLIKELY(mInfo[idx] + mInfoInc > 0xFF)) {
+            mInfo[idx] = static_cast<InfoEntry>(mInfo[idx - 1] + mInfoInc);
+            if (ROBIN_HOOD_UNLIKELY(mInfo[idx] + mInfoInc > MaxInfo)) {
                 mMaxNumElementsAllowed = 0;
             }
             --idx;
@@ -1398,11 +2443,14 @@ private:
         // TODO(martinus) we don't need to move everything, just the last one for the same
         // bucket.
         mKeyVals[idx].destroy(*this);
+        closeGap(idx);
+    }
 
-        // until we find one that is either empty or has zero offset.
+    // Fills the gap of the already destroyed or moved-from node at idx by shifting the following
+    // nodes back, until we find one that is either empty or has zero offset.
+    void closeGap(size_t idx) noexcept(std::is_nothrow_move_assignable<Node>::value) {
         while (mInfo[idx + 1] >= 2 * mInfoInc) {
-            ROBIN_HOOD_COUNT(shiftDown)
-            mInfo[idx] = static_cast<uint8_t>(mInfo[idx + 1] - mInfoInc);
+            mInfo[idx] = static_cast<InfoEntry>(mInfo[idx + 1] - mInfoInc);
             mKeyVals[idx] = std::move(mKeyVals[idx + 1]);
             ++idx;
         }
@@ -1413,27 +2461,161 @@ private:
         mKeyVals[idx].~Node();
     }
 
-    // copy of find(), except that it returns iterator instead of const_iterator.
+    // State of a retain() sweep: the slots before idx are done, dst is the first free slot that
+    // the element at idx can be moved to. The arrays are copied into members so that the compiler
+    // can keep them in registers, stores to mInfo could alias anything in the map.
+    struct RetainGuard {
+        Self& map;
+        Node* const keyVals;
+        InfoEntry* const info;
+        InfoType const infoInc;
+        size_t const end;
+        size_t idx;
+        size_t dst;
+        size_t numErased;
+
+        RetainGuard(Self& m, size_t endIdx) noexcept
+            : map(m)
+            , keyVals(m.mKeyVals)
+            , info(m.mInfo)
+            , infoInc(m.mInfoInc)
+            , end(endIdx)
+            , idx(0)
+            , dst(0)
+            , numErased(0) {}
+        RetainGuard(RetainGuard const&) = delete;
+        RetainGuard& operator=(RetainGuard const&) = delete;
+
+        // when the predicate throws, everything that's left is kept and moved back.
+        ~RetainGuard() {
+            for (; idx < end; ++idx) {
+                if (0 != info[idx]) {
+                    moveBack();
+                }
+            }
+            map.mNumElements -= numErased;
+        }
+
+        // moves the element at idx back, but never before its own bucket
+        void moveBack() noexcept(std::is_nothrow_move_constructible<Node>::value) {
+            auto const distance = static_cast<size_t>(info[idx] / infoInc) - 1;
+            auto const newIdx = (std::max)(dst, idx - distance);
+            if (newIdx != idx) {
+                ::new (static_cast<void*>(keyVals + newIdx)) Node(std::move(keyVals[idx]));
+                keyVals[idx].~Node();
+                info[newIdx] = static_cast<InfoEntry>(info[idx] - (idx - newIdx) * infoInc);
+                info[idx] = 0;
+            }
+            dst = newIdx + 1;
+        }
+
+        void erase() noexcept {
+            keyVals[idx].destroy(map);
+            keyVals[idx].~Node();
+            info[idx] = 0;
+            ++numErased;
+        }
+    };
+
+    // Finds key and returns an iterator of type It to it, or end() when it isn't there.
+    template <typename It, typename Other>
+    ROBIN_HOOD(NODISCARD)
+    It findIter(Other const& key) const {
+        return findIter<It>(key, static_cast<size_t>(WHash::operator()(key)));
+    }
+
+    template <typename It, typename Other>
+    ROBIN_HOOD(NODISCARD)
+    It findIter(Other const& key, size_t h) const {
+        return makeFindIter<It>(key, h, findIdxWithHash(key, h));
+    }
+
+    // Iterator for the result idx of findIdx(). When key wasn't found it might still be in the old
+    // arrays of a pending incremental rehash, then the iterator points there.
+    template <typename It, typename Other>
+    ROBIN_HOOD(NODISCARD)
+    It makeFindIter(Other const& key, size_t h, size_t idx) const {
+        if (Incremental && ROBIN_HOOD_UNLIKELY(rehash_pending())) {
+            if (mKeyVals + idx != reinterpret_cast_no_cast_align_warning<Node*>(mInfo)) {
+                return iterAt<It>(idx);
+            }
+            auto const& old = this->incremental()->old;
+            auto const oldIdx = old.findIdxWithHash(key, h);
+            return It{old.mKeyVals + oldIdx, old.mInfo + oldIdx};
+        }
+        return It{mKeyVals + idx, mInfo + idx};
+    }
+
+    // Iterator to slot idx of the new arrays. While a rehash is pending, incrementing it continues
+    // in the old arrays after the end of the new ones.
+    template <typename It>
+    ROBIN_HOOD(NODISCARD)
+    It iterAt(size_t idx) const noexcept {
+        if (Incremental && ROBIN_HOOD_UNLIKELY(rehash_pending())) {
+            auto const& old = this->incremental()->old;
+            return It{mKeyVals + idx, mInfo + idx, old.mKeyVals, old.mInfo};
+        }
+        return It{mKeyVals + idx, mInfo + idx};
+    }
+
+    // What end() points to: the sentinel of the old arrays while a rehash is pending, because
+    // iteration ends there.
+    ROBIN_HOOD(NODISCARD) Node* endNode() const noexcept {
+        if (Incremental && ROBIN_HOOD_UNLIKELY(rehash_pending())) {
+            return reinterpret_cast_no_cast_align_warning<Node*>(this->incremental()->old.mInfo);
+        }
+        return reinterpret_cast_no_cast_align_warning<Node*>(mInfo);
+    }
+
     template <typename Other>
     ROBIN_HOOD(NODISCARD)
-    size_t findIdx(Other const& key) const {
+    size_t findIdxWithHash(Other const& key, size_t h) const {
         size_t idx{};
         InfoType info{};
-        keyToIdx(key, &idx, &info);
+        hashToIdx(h, &idx, &info);
+        return findIdx(key, h, idx, info);
+    }
 
+    // probes for key with hash h, starting at idx and info as calculated by hashToIdx.
+    template <typename Other>
+    ROBIN_HOOD(NODISCARD)
+    size_t findIdx(Other const& key, size_t h, size_t idx, InfoType info) const {
+#if ROBIN_HOOD(HAS_SSE2)
+        // Most keys are found in the first slot. Checking it with a branch lets the CPU load the
+        // node before matchGroup() is done.
+        if (info == mInfo[idx] && ROBIN_HOOD_LIKELY(nodeKeyEquals(key, h, mKeyVals[idx]))) {
+            return idx;
+        }
+        for (;;) {
+            auto const bits = matchGroup(idx, info);
+            auto matches = groupMatches(bits);
+            while (matches) {
+                auto const matchIdx =
+                    idx + static_cast<size_t>(ROBIN_HOOD_COUNT_TRAILING_ZEROES(matches));
+                if (ROBIN_HOOD_LIKELY(nodeKeyEquals(key, h, mKeyVals[matchIdx]))) {
+                    return matchIdx;
+                }
+                matches &= matches - 1U;
+            }
+            if (bits >> GroupSize) {
+                break;
+            }
+            idx += GroupSize;
+            info += static_cast<InfoType>(GroupSize) * mInfoInc;
+        }
+#else
         do {
             // unrolling this twice gives a bit of a speedup. More unrolling did not help.
-            if (info == mInfo[idx] &&
-                ROBIN_HOOD_LIKELY(WKeyEqual::operator()(key, mKeyVals[idx].getFirst()))) {
+            if (info == mInfo[idx] && ROBIN_HOOD_LIKELY(nodeKeyEquals(key, h, mKeyVals[idx]))) {
                 return idx;
             }
             next(&info, &idx);
-            if (info == mInfo[idx] &&
-                ROBIN_HOOD_LIKELY(WKeyEqual::operator()(key, mKeyVals[idx].getFirst()))) {
+            if (info == mInfo[idx] && ROBIN_HOOD_LIKELY(nodeKeyEquals(key, h, mKeyVals[idx]))) {
                 return idx;
             }
             next(&info, &idx);
         } while (info <= mInfo[idx]);
+#endif
 
         // nothing found!
         return mMask == 0 ? 0
@@ -1441,6 +2623,33 @@ private:
                                 mKeyVals, reinterpret_cast_no_cast_align_warning<Node*>(mInfo)));
     }
 
+    // Number of keys that are hashed and prefetched together by the batch lookups.
+    static constexpr size_t BatchSize = 16;
+
+    // Batch version of findIdx. First hashes up to BatchSize keys and prefetches the info and node
+    // memory for each of them, and only then resolves the probes. That way the cache misses of the
+    // lookups overlap instead of adding up. Calls op(it) for each key, in order, with an iterator
+    // of type It.
+    template <typename It, typename KeyIter, typename Op>
+    void findMany(KeyIter first, KeyIter last, Op&& op) const {
+        std::array<size_t, BatchSize> hashes{};
+        std::array<size_t, BatchSize> idxs{};
+        std::array<InfoType, BatchSize> infos{};
+        while (first != last) {
+            size_t num = 0;
+            for (auto it = first; num < BatchSize && it != last; ++it, ++num) {
+                hashes[num] = static_cast<size_t>(WHash::operator()(*it));
+                hashToIdx(hashes[num], &idxs[num], &infos[num]);
+                ROBIN_HOOD_PREFETCH(mInfo + idxs[num]);
+                ROBIN_HOOD_PREFETCH(mKeyVals + idxs[num]);
+            }
+            for (size_t i = 0; i < num; ++i, ++first) {
+                op(makeFindIter<It>(*first, hashes[i],
+                                    findIdx(*first, hashes[i], idxs[i], infos[i])));
+            }
+        }
+    }
+
     void cloneData(const Table& o) {
         Cloner<Table, IsFlat && ROBIN_HOOD_IS_TRIVIALLY_COPYABLE(Node)>()(o, *this);
     }
@@ -1456,7 +2665,7 @@ private:
 
         size_t idx{};
         InfoType info{};
-        keyToIdx(keyval.getFirst(), &idx, &info);
+        hashToIdx(nodeHash(keyval), &idx, &info);
 
         // skip forward. Use <= because we are certain that the element is not there.
         while (info <= mInfo[idx]) {
@@ -1466,8 +2675,8 @@ private:
 
         // key not found, so we are now exactly where we want to insert it.
         auto const insertion_idx = idx;
-        auto const insertion_info = static_cast<uint8_t>(info);
-        if (ROBIN_HOOD_UNLIKELY(insertion_info + mInfoInc > 0xFF)) {
+        auto const insertion_info = static_cast<InfoEntry>(info);
+        if (ROBIN_HOOD_UNLIKELY(insertion_info + mInfoInc > MaxInfo)) {
             mMaxNumElementsAllowed = 0;
         }
 
@@ -1490,6 +2699,84 @@ private:
         ++mNumElements;
     }
 
+    friend struct ParallelBuild;
+
+    // Same as insertKeyPrepareEmptySpot() followed by constructing the node, but only touches
+    // slots before regionEnd, so that several threads can fill disjoint regions at once. Gives up
+    // and returns false when the element would have to be placed or shifted past regionEnd, or when
+    // an info byte would come close to overflowing; the element then has to be inserted normally.
+    template <typename Arg>
+    bool insertInRegion(Arg const& value, size_t h, size_t regionEnd, size_t* numInserted) {
+        auto const& key = getFirstConst(value);
+        size_t idx{};
+        InfoType info{};
+        hashToIdx(h, &idx, &info);
+
+        while (info <= mInfo[idx]) {
+            if (info == mInfo[idx] && nodeKeyEquals(key, h, mKeyVals[idx])) {
+                // key already exists, do NOT insert.
+                return true;
+            }
+            next(&info, &idx);
+            if (idx == regionEnd) {
+                return false;
+            }
+        }
+
+        // key not found, so we are now exactly where we want to insert it.
+        auto const insertion_idx = idx;
+        auto const insertion_info = info;
+        if (ROBIN_HOOD_UNLIKELY(insertion_info + mInfoInc > MaxInfo)) {
+            return false;
+        }
+
+        // find an empty spot. shiftUp() increases the info of each entry on the way.
+        while (0 != mInfo[idx]) {
+            if (ROBIN_HOOD_UNLIKELY(mInfo[idx] + 2 * mInfoInc > MaxInfo)) {
+                return false;
+            }
+            ++idx;
+            if (idx == regionEnd) {
+                return false;
+            }
+        }
+
+        auto& l = mKeyVals[insertion_idx];
+        if (idx == insertion_idx) {
+            ::new (static_cast<void*>(&l)) Node(*this, value);
+        } else {
+            shiftUp(idx, insertion_idx);
+            l = Node(*this, value);
+        }
+        mInfo[insertion_idx] = static_cast<InfoEntry>(insertion_info);
+        setNodeHash(insertion_idx, h);
+        ++*numInserted;
+        return true;
+    }
+
+    // Inserts value, h is the already calculated hash of its key.
+    template <typename Arg>
+    void insertWithHash(Arg const& value, size_t h) {
+        auto idxAndState = insertKeyPrepareEmptySpot(getFirstConst(value), h);
+        switch (idxAndState.second) {
+        case InsertionState::key_found:
+            return;
+
+        case InsertionState::new_node:
+            ::new (static_cast<void*>(&mKeyVals[idxAndState.first])) Node(*this, value);
+            break;
+
+        case InsertionState::overwrite_node:
+            mKeyVals[idxAndState.first] = Node(*this, value);
+            break;
+
+        case InsertionState::overflow_error:
+            throwOverflowError();
+            break;
+        }
+        setNodeHash(idxAndState.first, h);
+    }
+
 public:
     using iterator = Iter<false>;
     using const_iterator = Iter<true>;
@@ -1505,28 +2792,42 @@ public:
     // penalty is payed at the first insert, and not before. Lookup of this empty map works
     // because everybody points to DummyInfoByte::b. parameter bucket_count is dictated by the
     // standard, but we can ignore it.
-    explicit Table(
-        size_t ROBIN_HOOD_UNUSED(bucket_count) /*unused*/, const Hash& h = Hash{},
-        const KeyEqual& equal = KeyEqual{}) noexcept(noexcept(Hash(h)) && noexcept(KeyEqual(equal)))
+    explicit Table(size_t ROBIN_HOOD_UNUSED(bucket_count) /*unused*/, const Hash& h = Hash{},
+                   const KeyEqual& equal = KeyEqual{},
+                   const Allocator& alloc = Allocator{}) noexcept(noexcept(Hash(h)) &&
+                                                                  noexcept(KeyEqual(equal)))
         : WHash(h)
-        , WKeyEqual(equal) {
+        , WKeyEqual(equal)
+        , DataPool(alloc) {
+        ROBIN_HOOD_TRACE(this)
+    }
+
+    // All memory of the map, table and nodes, is allocated with alloc. Allocator doesn't need to
+    // be default constructible when it is passed explicitly.
+    explicit Table(const Allocator& alloc) noexcept(noexcept(Hash()) && noexcept(KeyEqual()))
+        : WHash()
+        , WKeyEqual()
+        , DataPool(alloc) {
         ROBIN_HOOD_TRACE(this)
     }
 
     template <typename Iter>
     Table(Iter first, Iter last, size_t ROBIN_HOOD_UNUSED(bucket_count) /*unused*/ = 0,
-          const Hash& h = Hash{}, const KeyEqual& equal = KeyEqual{})
+          const Hash& h = Hash{}, const KeyEqual& equal = KeyEqual{},
+          const Allocator& alloc = Allocator{})
         : WHash(h)
-        , WKeyEqual(equal) {
+        , WKeyEqual(equal)
+        , DataPool(alloc) {
         ROBIN_HOOD_TRACE(this)
         insert(first, last);
     }
 
     Table(std::initializer_list<value_type> initlist,
           size_t ROBIN_HOOD_UNUSED(bucket_count) /*unused*/ = 0, const Hash& h = Hash{},
-          const KeyEqual& equal = KeyEqual{})
+          const KeyEqual& equal = KeyEqual{}, const Allocator& alloc = Allocator{})
         : WHash(h)
-        , WKeyEqual(equal) {
+        , WKeyEqual(equal)
+        , DataPool(alloc) {
         ROBIN_HOOD_TRACE(this)
         insert(initlist.begin(), initlist.end());
     }
@@ -1534,7 +2835,8 @@ public:
     Table(Table&& o) noexcept
         : WHash(std::move(static_cast<WHash&>(o)))
         , WKeyEqual(std::move(static_cast<WKeyEqual&>(o)))
-        , DataPool(std::move(static_cast<DataPool&>(o))) {
+        , DataPool(std::move(static_cast<DataPool&>(o)))
+        , IncrementalHolder(std::move(static_cast<IncrementalHolder&>(o))) {
         ROBIN_HOOD_TRACE(this)
         if (o.mMask) {
             mHashMultiplier = std::move(o.mHashMultiplier);
@@ -1550,10 +2852,15 @@ public:
         }
     }
 
-    Table& operator=(Table&& o) noexcept {
+    Table& operator=(Table&& o) noexcept(
+        std::allocator_traits<Allocator>::propagate_on_container_move_assignment::value ||
+        AllocatorIsAlwaysEqual<Allocator>::value) {
         ROBIN_HOOD_TRACE(this)
         if (&o != this) {
-            if (o.mMask) {
+            if (o.mMask && !DataPool::canAdoptMemoryOf(o)) {
+                // o's memory comes from a different allocator, so move the entries one by one.
+                moveEntriesFrom(o);
+            } else if (o.mMask) {
                 // only move stuff if the other map actually has some data
                 destroy();
                 mHashMultiplier = std::move(o.mHashMultiplier);
@@ -1567,6 +2874,7 @@ public:
                 WHash::operator=(std::move(static_cast<WHash&>(o)));
                 WKeyEqual::operator=(std::move(static_cast<WKeyEqual&>(o)));
                 DataPool::operator=(std::move(static_cast<DataPool&>(o)));
+                IncrementalHolder::operator=(std::move(static_cast<IncrementalHolder&>(o)));
 
                 o.init();
 
@@ -1583,6 +2891,7 @@ public:
         , WKeyEqual(static_cast<const WKeyEqual&>(o))
         , DataPool(static_cast<const DataPool&>(o)) {
         ROBIN_HOOD_TRACE(this)
+        copyIncrementalRehash(o);
         if (!o.empty()) {
             // not empty: create an exact copy. it is also possible to just iterate through all
             // elements and insert them, but copying is probably faster.
@@ -1590,19 +2899,20 @@ public:
             auto const numElementsWithBuffer = calcNumElementsWithBuffer(o.mMask + 1);
             auto const numBytesTotal = calcNumBytesTotal(numElementsWithBuffer);
 
-            ROBIN_HOOD_LOG("std::malloc " << numBytesTotal << " = calcNumBytesTotal("
-                                          << numElementsWithBuffer << ")")
+            ROBIN_HOOD_LOG("allocate " << numBytesTotal << " = calcNumBytesTotal("
+                                       << numElementsWithBuffer << ")")
             mHashMultiplier = o.mHashMultiplier;
-            mKeyVals = static_cast<Node*>(
-                detail::assertNotNull<std::bad_alloc>(std::malloc(numBytesTotal)));
+            mKeyVals = static_cast<Node*>(DataPool::allocateBytes(numBytesTotal));
             // no need for calloc because clonData does memcpy
-            mInfo = reinterpret_cast<uint8_t*>(mKeyVals + numElementsWithBuffer);
+            mInfo = reinterpret_cast_no_cast_align_warning<InfoEntry*>(
+                mKeyVals + numElementsWithBuffer);
             mNumElements = o.mNumElements;
             mMask = o.mMask;
             mMaxNumElementsAllowed = o.mMaxNumElementsAllowed;
             mInfoInc = o.mInfoInc;
             mInfoHashShift = o.mInfoHashShift;
             cloneData(o);
+            clonePendingRehash(o);
         }
     }
 
@@ -1616,6 +2926,8 @@ public:
             return *this;
         }
 
+        discardPendingRehash();
+
         // we keep using the old allocator and not assign the new one, because we want to keep
         // the memory available. when it is the same size.
         if (o.empty()) {
@@ -1631,6 +2943,7 @@ public:
             WHash::operator=(static_cast<const WHash&>(o));
             WKeyEqual::operator=(static_cast<const WKeyEqual&>(o));
             DataPool::operator=(static_cast<DataPool const&>(o));
+            copyIncrementalRehash(o);
 
             return *this;
         }
@@ -1642,24 +2955,27 @@ public:
             // no luck: we don't have the same array size allocated, so we need to realloc.
             if (0 != mMask) {
                 // only deallocate if we actually have data!
-                ROBIN_HOOD_LOG("std::free")
-                std::free(mKeyVals);
+                DataPool::deallocateBytes(mKeyVals,
+                                          calcNumBytesTotal(calcNumElementsWithBuffer(mMask + 1)));
+                // the map is in a valid state if allocating the new table throws
+                init();
             }
 
             auto const numElementsWithBuffer = calcNumElementsWithBuffer(o.mMask + 1);
             auto const numBytesTotal = calcNumBytesTotal(numElementsWithBuffer);
-            ROBIN_HOOD_LOG("std::malloc " << numBytesTotal << " = calcNumBytesTotal("
-                                          << numElementsWithBuffer << ")")
-            mKeyVals = static_cast<Node*>(
-                detail::assertNotNull<std::bad_alloc>(std::malloc(numBytesTotal)));
+            ROBIN_HOOD_LOG("allocate " << numBytesTotal << " = calcNumBytesTotal("
+                                       << numElementsWithBuffer << ")")
+            mKeyVals = static_cast<Node*>(DataPool::allocateBytes(numBytesTotal));
 
             // no need for calloc here because cloneData performs a memcpy.
-            mInfo = reinterpret_cast<uint8_t*>(mKeyVals + numElementsWithBuffer);
+            mInfo = reinterpret_cast_no_cast_align_warning<InfoEntry*>(
+                mKeyVals + numElementsWithBuffer);
             // sentinel is set in cloneData
         }
         WHash::operator=(static_cast<const WHash&>(o));
         WKeyEqual::operator=(static_cast<const WKeyEqual&>(o));
         DataPool::operator=(static_cast<DataPool const&>(o));
+        copyIncrementalRehash(o);
         mHashMultiplier = o.mHashMultiplier;
         mNumElements = o.mNumElements;
         mMask = o.mMask;
@@ -1667,10 +2983,15 @@ public:
         mInfoInc = o.mInfoInc;
         mInfoHashShift = o.mInfoHashShift;
         cloneData(o);
+        clonePendingRehash(o);
 
         return *this;
     }
 
+    allocator_type get_allocator() const noexcept {
+        return DataPool::get_allocator();
+    }
+
     // Swaps everything between the two maps.
     void swap(Table& o) {
         ROBIN_HOOD_TRACE(this)
@@ -1681,6 +3002,7 @@ public:
     // Clears all data, without resizing.
     void clear() {
         ROBIN_HOOD_TRACE(this)
+        discardPendingRehash();
         if (empty()) {
             // don't do anything! also important because we don't want to write to
             // DummyInfoByte::b, even though we would just write 0 to it.
@@ -1691,8 +3013,8 @@ public:
 
         auto const numElementsWithBuffer = calcNumElementsWithBuffer(mMask + 1);
         // clear everything, then set the sentinel again
-        uint8_t const z = 0;
-        std::fill(mInfo, mInfo + calcNumBytesInfo(numElementsWithBuffer), z);
+        InfoEntry const z = 0;
+        std::fill(mInfo, mInfo + calcNumInfos(numElementsWithBuffer), z);
         mInfo[numElementsWithBuffer] = 1;
 
         mInfoInc = InitialInfoInc;
@@ -1728,7 +3050,8 @@ public:
     template <typename Q = mapped_type>
     typename std::enable_if<!std::is_void<Q>::value, Q&>::type operator[](const key_type& key) {
         ROBIN_HOOD_TRACE(this)
-        auto idxAndState = insertKeyPrepareEmptySpot(key);
+        auto const h = hash_for(key);
+        auto idxAndState = insertKeyPrepareEmptySpot(key, h);
         switch (idxAndState.second) {
         case InsertionState::key_found:
             break;
@@ -1748,13 +3071,15 @@ public:
             throwOverflowError();
         }
 
+        setNodeHash(idxAndState.first, h);
         return mKeyVals[idxAndState.first].getSecond();
     }
 
     template <typename Q = mapped_type>
     typename std::enable_if<!std::is_void<Q>::value, Q&>::type operator[](key_type&& key) {
         ROBIN_HOOD_TRACE(this)
-        auto idxAndState = insertKeyPrepareEmptySpot(key);
+        auto const h = hash_for(key);
+        auto idxAndState = insertKeyPrepareEmptySpot(key, h);
         switch (idxAndState.second) {
         case InsertionState::key_found:
             break;
@@ -1775,6 +3100,7 @@ public:
             throwOverflowError();
         }
 
+        setNodeHash(idxAndState.first, h);
         return mKeyVals[idxAndState.first].getSecond();
     }
 
@@ -1796,29 +3122,9 @@ public:
     std::pair<iterator, bool> emplace(Args&&... args) {
         ROBIN_HOOD_TRACE(this)
         Node n{*this, std::forward<Args>(args)...};
-        auto idxAndState = insertKeyPrepareEmptySpot(getFirstConst(n));
-        switch (idxAndState.second) {
-        case InsertionState::key_found:
-            n.destroy(*this);
-            break;
-
-        case InsertionState::new_node:
-            ::new (static_cast<void*>(&mKeyVals[idxAndState.first])) Node(*this, std::move(n));
-            break;
-
-        case InsertionState::overwrite_node:
-            mKeyVals[idxAndState.first] = std::move(n);
-            break;
-
-        case InsertionState::overflow_error:
-            n.destroy(*this);
-            throwOverflowError();
-            break;
-        }
-
-        return std::make_pair(iterator(mKeyVals + idxAndState.first, mInfo + idxAndState.first),
-                              InsertionState::key_found != idxAndState.second);
-    }
+        auto const h = hash_for(getFirstConst(n));
+        return emplaceNode(n, h);
+    }
 
     template <typename... Args>
     iterator emplace_hint(const_iterator position, Args&&... args) {
@@ -1828,24 +3134,39 @@ public:
 
     template <typename... Args>
     std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args) {
-        return try_emplace_impl(key, std::forward<Args>(args)...);
+        return try_emplace_impl(hash_for(key), key, std::forward<Args>(args)...);
     }
 
     template <typename... Args>
     std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args) {
-        return try_emplace_impl(std::move(key), std::forward<Args>(args)...);
+        auto const h = hash_for(key);
+        return try_emplace_impl(h, std::move(key), std::forward<Args>(args)...);
     }
 
     template <typename... Args>
     iterator try_emplace(const_iterator hint, const key_type& key, Args&&... args) {
         (void)hint;
-        return try_emplace_impl(key, std::forward<Args>(args)...).first;
+        return try_emplace_impl(hash_for(key), key, std::forward<Args>(args)...).first;
     }
 
     template <typename... Args>
     iterator try_emplace(const_iterator hint, key_type&& key, Args&&... args) {
         (void)hint;
-        return try_emplace_impl(std::move(key), std::forward<Args>(args)...).first;
+        auto const h = hash_for(key);
+        return try_emplace_impl(h, std::move(key), std::forward<Args>(args)...).first;
+    }
+
+    // Same as try_emplace, but uses the given hash h instead of hashing key. h must be the result
+    // of hash_for(key).
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace_with_hash(const key_type& key, size_t h,
+                                                    Args&&... args) {
+        return try_emplace_impl(h, key, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace_with_hash(key_type&& key, size_t h, Args&&... args) {
+        return try_emplace_impl(h, std::move(key), std::forward<Args>(args)...);
     }
 
     template <typename Mapped>
@@ -1889,11 +3210,25 @@ public:
         return emplace(std::move(keyval)).first;
     }
 
+    // Same as insert, but uses the given hash h instead of hashing the key of keyval. h must be the
+    // result of hash_for(key).
+    std::pair<iterator, bool> insert_with_hash(const value_type& keyval, size_t h) {
+        ROBIN_HOOD_TRACE(this)
+        Node n{*this, keyval};
+        return emplaceNode(n, h);
+    }
+
+    std::pair<iterator, bool> insert_with_hash(value_type&& keyval, size_t h) {
+        ROBIN_HOOD_TRACE(this)
+        Node n{*this, std::move(keyval)};
+        return emplaceNode(n, h);
+    }
+
     // Returns 1 if key is found, 0 otherwise.
     size_t count(const key_type& key) const { // NOLINT(modernize-use-nodiscard)
         ROBIN_HOOD_TRACE(this)
-        auto kv = mKeyVals + findIdx(key);
-        if (kv != reinterpret_cast_no_cast_align_warning<Node*>(mInfo)) {
+        auto kv = findIter<const_iterator>(key).mKeyVals;
+        if (kv != endNode()) {
             return 1;
         }
         return 0;
@@ -1903,8 +3238,8 @@ public:
     // NOLINTNEXTLINE(modernize-use-nodiscard)
     typename std::enable_if<Self_::is_transparent, size_t>::type count(const OtherKey& key) const {
         ROBIN_HOOD_TRACE(this)
-        auto kv = mKeyVals + findIdx(key);
-        if (kv != reinterpret_cast_no_cast_align_warning<Node*>(mInfo)) {
+        auto kv = findIter<const_iterator>(key).mKeyVals;
+        if (kv != endNode()) {
             return 1;
         }
         return 0;
@@ -1926,8 +3261,8 @@ public:
     // NOLINTNEXTLINE(modernize-use-nodiscard)
     typename std::enable_if<!std::is_void<Q>::value, Q&>::type at(key_type const& key) {
         ROBIN_HOOD_TRACE(this)
-        auto kv = mKeyVals + findIdx(key);
-        if (kv == reinterpret_cast_no_cast_align_warning<Node*>(mInfo)) {
+        auto kv = findIter<iterator>(key).mKeyVals;
+        if (kv == endNode()) {
             doThrow<std::out_of_range>("key not found");
         }
         return kv->getSecond();
@@ -1939,8 +3274,8 @@ public:
     // NOLINTNEXTLINE(modernize-use-nodiscard)
     typename std::enable_if<!std::is_void<Q>::value, Q const&>::type at(key_type const& key) const {
         ROBIN_HOOD_TRACE(this)
-        auto kv = mKeyVals + findIdx(key);
-        if (kv == reinterpret_cast_no_cast_align_warning<Node*>(mInfo)) {
+        auto kv = findIter<iterator>(key).mKeyVals;
+        if (kv == endNode()) {
             doThrow<std::out_of_range>("key not found");
         }
         return kv->getSecond();
@@ -1948,15 +3283,13 @@ public:
 
     const_iterator find(const key_type& key) const { // NOLINT(modernize-use-nodiscard)
         ROBIN_HOOD_TRACE(this)
-        const size_t idx = findIdx(key);
-        return const_iterator{mKeyVals + idx, mInfo + idx};
+        return findIter<const_iterator>(key);
     }
 
     template <typename OtherKey>
     const_iterator find(const OtherKey& key, is_transparent_tag /*unused*/) const {
         ROBIN_HOOD_TRACE(this)
-        const size_t idx = findIdx(key);
-        return const_iterator{mKeyVals + idx, mInfo + idx};
+        return findIter<const_iterator>(key);
     }
 
     template <typename OtherKey, typename Self_ = Self>
@@ -1964,36 +3297,121 @@ public:
                             const_iterator>::type  // NOLINT(modernize-use-nodiscard)
     find(const OtherKey& key) const {              // NOLINT(modernize-use-nodiscard)
         ROBIN_HOOD_TRACE(this)
-        const size_t idx = findIdx(key);
-        return const_iterator{mKeyVals + idx, mInfo + idx};
+        return findIter<const_iterator>(key);
     }
 
     iterator find(const key_type& key) {
         ROBIN_HOOD_TRACE(this)
-        const size_t idx = findIdx(key);
-        return iterator{mKeyVals + idx, mInfo + idx};
+        return findIter<iterator>(key);
     }
 
     template <typename OtherKey>
     iterator find(const OtherKey& key, is_transparent_tag /*unused*/) {
         ROBIN_HOOD_TRACE(this)
-        const size_t idx = findIdx(key);
-        return iterator{mKeyVals + idx, mInfo + idx};
+        return findIter<iterator>(key);
     }
 
     template <typename OtherKey, typename Self_ = Self>
     typename std::enable_if<Self_::is_transparent, iterator>::type find(const OtherKey& key) {
         ROBIN_HOOD_TRACE(this)
-        const size_t idx = findIdx(key);
-        return iterator{mKeyVals + idx, mInfo + idx};
+        return findIter<iterator>(key);
+    }
+
+    // Returns the hash of key as used by this map, without the map's own mixing step. It only
+    // depends on the hasher, so the same value can be used with the *_with_hash() methods of all
+    // maps that use an equal hasher. This saves hashing long keys again and again.
+    size_t hash_for(const key_type& key) const { // NOLINT(modernize-use-nodiscard)
+        return static_cast<size_t>(WHash::operator()(key));
+    }
+
+    template <typename OtherKey, typename Self_ = Self>
+    // NOLINTNEXTLINE(modernize-use-nodiscard)
+    typename std::enable_if<Self_::is_transparent, size_t>::type
+    hash_for(const OtherKey& key) const {
+        return static_cast<size_t>(WHash::operator()(key));
+    }
+
+    // Same as find(key), but uses the given hash h instead of hashing key. h must be the result
+    // of hash_for(key).
+    // NOLINTNEXTLINE(modernize-use-nodiscard)
+    const_iterator find_with_hash(const key_type& key, size_t h) const {
+        ROBIN_HOOD_TRACE(this)
+        return findIter<const_iterator>(key, h);
+    }
+
+    template <typename OtherKey, typename Self_ = Self>
+    typename std::enable_if<Self_::is_transparent, // NOLINT(modernize-use-nodiscard)
+                            const_iterator>::type  // NOLINT(modernize-use-nodiscard)
+    find_with_hash(const OtherKey& key, size_t h) const {
+        ROBIN_HOOD_TRACE(this)
+        return findIter<const_iterator>(key, h);
+    }
+
+    iterator find_with_hash(const key_type& key, size_t h) {
+        ROBIN_HOOD_TRACE(this)
+        return findIter<iterator>(key, h);
+    }
+
+    template <typename OtherKey, typename Self_ = Self>
+    typename std::enable_if<Self_::is_transparent, iterator>::type
+    find_with_hash(const OtherKey& key, size_t h) {
+        ROBIN_HOOD_TRACE(this)
+        return findIter<iterator>(key, h);
+    }
+
+    // Looks up all keys in [first, last) and writes the iterator for each of them to out, end() if
+    // the key is not present. Hashing and memory access of many keys are overlapped, so this is
+    // much faster than calling find() for each key when the map doesn't fit into the cache.
+    template <typename KeyIter, typename OutIter>
+    OutIter find_many(KeyIter first, KeyIter last, OutIter out) {
+        ROBIN_HOOD_TRACE(this)
+        findMany<iterator>(first, last, [&out](iterator it) {
+            *out = it;
+            ++out;
+        });
+        return out;
+    }
+
+    template <typename KeyIter, typename OutIter>
+    OutIter find_many(KeyIter first, KeyIter last, OutIter out) const {
+        ROBIN_HOOD_TRACE(this)
+        findMany<const_iterator>(first, last, [&out](const_iterator it) {
+            *out = it;
+            ++out;
+        });
+        return out;
+    }
+
+    // Checks up to 64 keys in [first, last) like find_many. Bit i of the result is set when the
+    // i-th key is present. Throws std::length_error if more than 64 keys are given.
+    template <typename KeyIter>
+    uint64_t contains_many(KeyIter first, KeyIter last) const { // NOLINT(modernize-use-nodiscard)
+        ROBIN_HOOD_TRACE(this)
+        if (ROBIN_HOOD_UNLIKELY(std::distance(first, last) > 64)) {
+            doThrow<std::length_error>("contains_many: more than 64 keys");
+        }
+        uint64_t result = 0;
+        uint64_t bit = 1;
+        auto const endIt = cend();
+        findMany<const_iterator>(first, last, [&result, &bit, &endIt](const_iterator it) {
+            if (it != endIt) {
+                result |= bit;
+            }
+            bit <<= 1U;
+        });
+        return result;
     }
 
+    // While an incremental rehash is pending, iteration first walks the new arrays, then the old
+    // ones.
     iterator begin() {
         ROBIN_HOOD_TRACE(this)
         if (empty()) {
             return end();
         }
-        return iterator(mKeyVals, mInfo, fast_forward_tag{});
+        auto it = iterAt<iterator>(0);
+        it.forward();
+        return it;
     }
     const_iterator begin() const { // NOLINT(modernize-use-nodiscard)
         ROBIN_HOOD_TRACE(this)
@@ -2004,14 +3422,16 @@ public:
         if (empty()) {
             return cend();
         }
-        return const_iterator(mKeyVals, mInfo, fast_forward_tag{});
+        auto it = iterAt<const_iterator>(0);
+        it.forward();
+        return it;
     }
 
     iterator end() {
         ROBIN_HOOD_TRACE(this)
         // no need to supply valid info pointer: end() must not be dereferenced, and only node
         // pointer is compared.
-        return iterator{reinterpret_cast_no_cast_align_warning<Node*>(mInfo), nullptr};
+        return iterator{endNode(), nullptr};
     }
     const_iterator end() const { // NOLINT(modernize-use-nodiscard)
         ROBIN_HOOD_TRACE(this)
@@ -2019,43 +3439,65 @@ public:
     }
     const_iterator cend() const { // NOLINT(modernize-use-nodiscard)
         ROBIN_HOOD_TRACE(this)
-        return const_iterator{reinterpret_cast_no_cast_align_warning<Node*>(mInfo), nullptr};
+        return const_iterator{endNode(), nullptr};
     }
 
     iterator erase(const_iterator pos) {
         ROBIN_HOOD_TRACE(this)
         // its safe to perform const cast here
         // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
-        return erase(iterator{const_cast<Node*>(pos.mKeyVals), const_cast<uint8_t*>(pos.mInfo)});
+        return erase(iterator{const_cast<Node*>(pos.mKeyVals), const_cast<InfoEntry*>(pos.mInfo)});
     }
 
     // Erases element at pos, returns iterator to the next element.
     iterator erase(iterator pos) {
         ROBIN_HOOD_TRACE(this)
         // we assume that pos always points to a valid entry, and not end().
+        if (Incremental && ROBIN_HOOD_UNLIKELY(rehash_pending()) && isPendingNode(pos.mKeyVals)) {
+            auto& old = this->incremental()->old;
+            auto const oldIdx = static_cast<size_t>(pos.mKeyVals - old.mKeyVals);
+            erasePending(oldIdx);
+            // the old arrays are iterated last
+            iterator it{old.mKeyVals + oldIdx, old.mInfo + oldIdx};
+            if (0 == *it.mInfo) {
+                ++it;
+            }
+            return it;
+        }
         auto const idx = static_cast<size_t>(pos.mKeyVals - mKeyVals);
 
         shiftDown(idx);
         --mNumElements;
 
-        if (*pos.mInfo) {
-            // we've backward shifted, return this again
-            return pos;
+        // pos might not know about the old arrays when it came from a const_iterator.
+        auto it = iterAt<iterator>(idx);
+        if (0 == *it.mInfo) {
+            // no backward shift, return next element
+            ++it;
         }
-
-        // no backward shift, return next element
-        return ++pos;
+        return it;
     }
 
     size_t erase(const key_type& key) {
         ROBIN_HOOD_TRACE(this)
+        return erase_with_hash(key, hash_for(key));
+    }
+
+    // Same as erase(key), but uses the given hash h instead of hashing key. h must be the result
+    // of hash_for(key).
+    size_t erase_with_hash(const key_type& key, size_t h) {
+        ROBIN_HOOD_TRACE(this)
+        if (ROBIN_HOOD_UNLIKELY(rehash_pending())) {
+            advanceRehash(key, h);
+        }
+
         size_t idx{};
         InfoType info{};
-        keyToIdx(key, &idx, &info);
+        hashToIdx(h, &idx, &info);
 
         // check while info matches with the source idx
         do {
-            if (info == mInfo[idx] && WKeyEqual::operator()(key, mKeyVals[idx].getFirst())) {
+            if (info == mInfo[idx] && nodeKeyEquals(key, h, mKeyVals[idx])) {
                 shiftDown(idx);
                 --mNumElements;
                 return 1;
@@ -2067,6 +3509,37 @@ public:
         return 0;
     }
 
+    // Keeps only the elements for which pred(value) returns true, and returns the number of erased
+    // elements. Unlike an erase(iterator) loop, which shifts the rest of the cluster back for each
+    // erased element, this scans the table once and moves each remaining element at most once:
+    // straight to the first free slot at or after its bucket.
+    template <typename Pred>
+    size_t retain(Pred pred) {
+        ROBIN_HOOD_TRACE(this)
+        // the old arrays are swept anyway, so there is nothing to gain from keeping them around.
+        finish_rehash();
+        if (empty()) {
+            return 0;
+        }
+
+        RetainGuard guard(*this, calcNumElementsWithBuffer(mMask + 1));
+        while (true) {
+            // skip empty slots 8 at a time, the sentinel stops at end
+            iterator const it(guard.keyVals + guard.idx, guard.info + guard.idx,
+                              fast_forward_tag{});
+            guard.idx = static_cast<size_t>(it.mKeyVals - guard.keyVals);
+            if (guard.idx == guard.end) {
+                return guard.numErased;
+            }
+            if (pred(*guard.keyVals[guard.idx])) {
+                guard.moveBack();
+            } else {
+                guard.erase();
+            }
+            ++guard.idx;
+        }
+    }
+
     // reserves space for the specified number of elements. Makes sure the old data fits.
     // exactly the same as reserve(c).
     void rehash(size_t c) {
@@ -2085,10 +3558,8 @@ public:
     // Does not do anything if load_factor is too large for decreasing the table's size.
     void compact() {
         ROBIN_HOOD_TRACE(this)
-        auto newSize = InitialNumElements;
-        while (calcMaxNumElementsAllowed(newSize) < mNumElements && newSize != 0) {
-            newSize *= 2;
-        }
+        finish_rehash();
+        auto const newSize = calcNumBucketsFor(mNumElements);
         if (ROBIN_HOOD_UNLIKELY(newSize == 0)) {
             throwOverflowError();
         }
@@ -2098,12 +3569,241 @@ public:
         // only actually do anything when the new size is bigger than the old one. This prevents to
         // continuously allocate for each reserve() call.
         if (newSize < mMask + 1) {
-            rehashPowerOfTwo(newSize, true);
+            rehashToBucketCount(newSize, true);
+        }
+        trim();
+    }
+
+    // Gives memory of the node pool back to the allocator that is not needed for the current
+    // nodes: nodes are moved out of sparsely used blocks, and blocks that become empty are freed.
+    // Returns the number of bytes freed. Does nothing for flat maps, and for node maps with a
+    // shared_node_allocator. compact() calls this.
+    size_t trim() {
+        ROBIN_HOOD_TRACE(this)
+        finish_rehash();
+        return trimNodes(std::integral_constant<bool, !IsFlat && DataPool::OwnsNodes>{});
+    }
+
+    // Moves all nodes into one contiguous block in the order of iteration, and frees the old
+    // blocks. After lots of inserts and erases the nodes are scattered over the pool, so iterating
+    // misses the cache on almost every element; afterwards it walks memory sequentially. Needs
+    // memory for all nodes while moving. Does nothing for flat maps, for node maps with a
+    // shared_node_allocator, and when value_type can't be moved without throwing.
+    void relayout() {
+        ROBIN_HOOD_TRACE(this)
+        finish_rehash();
+        relayoutNodes(std::integral_constant<bool, !IsFlat && DataPool::OwnsNodes>{});
+    }
+
+    // Writes the map to the file at path: a small header, followed by the node and info arrays
+    // exactly as they are in memory. load(), and mapped_flat_map and mapped_flat_set of
+    // robin_hood_os.h can read it back without inserting anything. Only for flat maps with
+    // trivially copyable entries. The file is only readable on machines with the same endianness
+    // and type sizes, and with the same Hash. Throws std::runtime_error when the file can't be
+    // written.
+    void save(char const* path) const {
+        ROBIN_HOOD_TRACE(this)
+        static_assert(IsFlat && ROBIN_HOOD_IS_TRIVIALLY_COPYABLE(Node),
+                      "save() needs a flat map with trivially copyable entries");
+        if (Incremental && rehash_pending()) {
+            // the image has to be a single table, so a copy takes over the pending rehash.
+            Table copy(*this);
+            copy.finish_rehash();
+            copy.save(path);
+            return;
+        }
+
+        auto const header = makeImageHeader();
+        std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path, "wb"), &std::fclose);
+        char padding[ImageDataOffset - sizeof(ImageHeader)] = {};
+        if (!file || 1 != std::fwrite(&header, sizeof(header), 1, file.get()) ||
+            1 != std::fwrite(padding, sizeof(padding), 1, file.get()) ||
+            (0 != header.dataSize &&
+             1 != std::fwrite(mKeyVals, static_cast<size_t>(header.dataSize), 1, file.get())) ||
+            0 != std::fclose(file.release())) {
+            doThrow<std::runtime_error>("robin_hood::save: can't write file");
+        }
+    }
+
+    // Replaces the content of the map with a file written by save(). Reads the arrays with a
+    // single read, nothing is rehashed. Throws std::runtime_error when the file can't be read, was
+    // written by an incompatible map or is corrupt, and then the map is unchanged.
+    void load(char const* path) {
+        ROBIN_HOOD_TRACE(this)
+        static_assert(IsFlat && ROBIN_HOOD_IS_TRIVIALLY_COPYABLE(Node),
+                      "load() needs a flat map with trivially copyable entries");
+        std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path, "rb"), &std::fclose);
+        ImageHeader header{};
+        uint64_t fileSize = 0;
+        if (!file || 1 != std::fread(&header, sizeof(header), 1, file.get()) ||
+            !fileSizeAndSeek(file.get(), ImageDataOffset, &fileSize)) {
+            doThrow<std::runtime_error>("robin_hood::load: can't read file");
+        }
+        auto const* error = imageError(header, fileSize);
+        if (error != nullptr) {
+            doThrow<std::runtime_error>(error);
+        }
+
+        // the map stays unchanged until the whole image is read and checked
+        auto const numBytes = static_cast<size_t>(header.dataSize);
+        Node* data = nullptr;
+        if (0 != numBytes) {
+            data = static_cast<Node*>(DataPool::allocateBytes(numBytes));
+            if (1 != std::fread(data, numBytes, 1, file.get())) {
+                error = "robin_hood::load: can't read file";
+            } else {
+                error = imageDataError(header, data);
+            }
+            if (error != nullptr) {
+                DataPool::deallocateBytes(data, numBytes);
+                doThrow<std::runtime_error>(error);
+            }
+        }
+        destroy();
+        init();
+        useImage(header, data);
+    }
+
+    // Writes the map to a stream or through a callback write(void const* data, size_t size): the
+    // number of elements and the hash seed, then all elements in slot order. Keys and values are
+    // written with robin_hood::serializer, which handles trivially copyable types and strings.
+    // Unlike save(), this works for all maps. Throws std::runtime_error when the stream fails.
+    template <typename Traits>
+    void serialize(std::basic_ostream<char, Traits>& out) const {
+        serialize([&out](void const* data, size_t size) {
+            out.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+        });
+        if (!out) {
+            doThrow<std::runtime_error>("robin_hood::serialize: can't write to stream");
+        }
+    }
+
+    template <typename Writer>
+    auto serialize(Writer&& write) const
+        -> decltype(write(static_cast<void const*>(nullptr), size_t()), void()) {
+        ROBIN_HOOD_TRACE(this)
+        serializer<uint64_t>::write(write, static_cast<uint64_t>(size()));
+        serializer<uint64_t>::write(write, mHashMultiplier);
+        // iterates in slot order, the old arrays of a pending rehash come last
+        for (auto const& v : *this) {
+            writeValue(write, v);
+        }
+    }
+
+    // Replaces the content of the map with what serialize() wrote, read from a stream or through
+    // a callback read(void* data, size_t size) that returns false when there's not enough data.
+    // The hash seed is restored and memory for all elements is reserved once, so the elements
+    // arrive in slot order and appending them is sequential. Elements are appended without
+    // checking for duplicates, so the input must come from serialize() of the same map type.
+    //
+    // numBytes is the size of the callback's input, for streams it is taken from the stream when
+    // it can seek. An element count that can't fit in it throws before anything is allocated.
+    // When the size is unknown, a corrupt count can make the reserve allocate a lot of memory or
+    // throw std::bad_alloc. Throws std::runtime_error when the input ends early.
+    template <typename Traits>
+    void deserialize(std::basic_istream<char, Traits>& in) {
+        auto numBytes = UnknownInputSize;
+        auto const pos = in.tellg();
+        if (pos != std::streampos(-1)) {
+            if (in.seekg(0, std::ios_base::end)) {
+                numBytes = static_cast<uint64_t>(in.tellg() - pos);
+            } else {
+                in.clear(in.rdstate() & ~std::ios_base::failbit);
+            }
+            in.seekg(pos);
+        }
+        deserialize(
+            [&in](void* data, size_t size) {
+                in.read(static_cast<char*>(data), static_cast<std::streamsize>(size));
+                return static_cast<size_t>(in.gcount()) == size;
+            },
+            numBytes);
+    }
+
+    template <typename Reader>
+    auto deserialize(Reader&& read, uint64_t numBytes = UnknownInputSize)
+        -> decltype(static_cast<bool>(read(static_cast<void*>(nullptr), size_t())), void()) {
+        ROBIN_HOOD_TRACE(this)
+        auto in = [&read](void* data, size_t size) {
+            if (!read(data, size)) {
+                doThrow<std::runtime_error>("robin_hood::deserialize: unexpected end of input");
+            }
+        };
+        auto const numElements = serializer<uint64_t>::read(in);
+        static constexpr uint64_t HeaderSize = 2 * sizeof(uint64_t);
+        if (numElements > (std::numeric_limits<size_t>::max)() ||
+            (numBytes != UnknownInputSize &&
+             (numBytes < HeaderSize ||
+              numElements > (numBytes - HeaderSize) / serializedElementMinSize()))) {
+            doThrow<std::runtime_error>("robin_hood::deserialize: too many elements");
+        }
+
+        // load into a new map so *this is unchanged when anything throws
+        Table map(0, static_cast<Hash const&>(static_cast<WHash const&>(*this)),
+                  static_cast<KeyEqual const&>(static_cast<WKeyEqual const&>(*this)),
+                  get_allocator());
+        map.mHashMultiplier = serializer<uint64_t>::read(in);
+        map.reserve(static_cast<size_t>(numElements));
+        for (uint64_t i = 0; i < numElements; ++i) {
+            // only when an info overflowed, the reserve made room for all elements
+            if (ROBIN_HOOD_UNLIKELY(map.mNumElements >= map.mMaxNumElementsAllowed)) {
+                map.increase_size();
+            }
+            map.readNode(in);
+        }
+        // the move assignment takes the incremental rehash setting of map
+        map.copyIncrementalRehash(*this);
+        *this = std::move(map);
+    }
+
+    // Opt-in incremental rehash, only for maps with Incremental, e.g.
+    // unordered_flat_map_incremental. By default, growing the map moves all entries at once,
+    // which makes that one insert as slow as the whole map. With slotsPerOperation > 0, growing
+    // only allocates the new arrays and keeps the old ones. Each following insert or erase by key
+    // moves at least slotsPerOperation slots over (more if necessary, so that everything is moved
+    // before the new arrays are full). Lookups check both arrays until everything is moved.
+    //
+    // While a rehash is pending, iteration walks the new arrays first and then the old ones, and
+    // find() can return an iterator into the old arrays. Const member functions never move
+    // anything.
+    //
+    // 0 switches back to the default and finishes a pending rehash.
+    template <bool Enabled = Incremental>
+    void set_incremental_rehash(size_t slotsPerOperation) {
+        ROBIN_HOOD_TRACE(this)
+        static_assert(Enabled, "set_incremental_rehash() needs a map with Incremental = true");
+        if (0 == slotsPerOperation) {
+            finish_rehash();
+            this->mIncremental.reset();
+            return;
+        }
+        if (!this->mIncremental) {
+            this->mIncremental.reset(new IncrementalRehash(
+                size_t(0), static_cast<WHash const&>(*this), static_cast<WKeyEqual const&>(*this),
+                get_allocator()));
+        }
+        this->mIncremental->slotsPerOperation = slotsPerOperation;
+    }
+
+    // True while some entries are still in the old arrays of an incremental rehash.
+    ROBIN_HOOD(NODISCARD) bool rehash_pending() const noexcept {
+        return Incremental && nullptr != this->incremental() &&
+               0 != this->incremental()->old.mMask;
+    }
+
+    // Moves all entries of a pending incremental rehash at once.
+    void finish_rehash() {
+        ROBIN_HOOD_TRACE(this)
+        if (rehash_pending()) {
+            movePendingSlots((std::numeric_limits<size_t>::max)());
         }
     }
 
     size_type size() const noexcept { // NOLINT(modernize-use-nodiscard)
         ROBIN_HOOD_TRACE(this)
+        if (Incremental && ROBIN_HOOD_UNLIKELY(nullptr != this->incremental())) {
+            return mNumElements + this->incremental()->old.mNumElements;
+        }
         return mNumElements;
     }
 
@@ -2114,7 +3814,7 @@ public:
 
     ROBIN_HOOD(NODISCARD) bool empty() const noexcept {
         ROBIN_HOOD_TRACE(this)
-        return 0 == mNumElements;
+        return 0 == size();
     }
 
     float max_load_factor() const noexcept { // NOLINT(modernize-use-nodiscard)
@@ -2128,11 +3828,42 @@ public:
         return static_cast<float>(size()) / static_cast<float>(mMask + 1);
     }
 
+    // bucket_count() - 1. This is only a bit mask when the number of buckets is a power of two,
+    // which is always the case with the default GrowthFactor100 of 200.
     ROBIN_HOOD(NODISCARD) size_t mask() const noexcept {
         ROBIN_HOOD_TRACE(this)
         return mMask;
     }
 
+    // Number of buckets, 0 before anything was allocated. With a GrowthFactor100 other than 200
+    // this can be any number, see reserve().
+    ROBIN_HOOD(NODISCARD) size_t bucket_count() const noexcept {
+        ROBIN_HOOD_TRACE(this)
+        return 0 == mMask ? 0 : mMask + 1;
+    }
+
+    // Walks all buckets to collect the statistics, so this is O(bucket_count()). While a rehash
+    // is pending, the old arrays are walked too.
+    ROBIN_HOOD(NODISCARD) table_stats stats() const {
+        ROBIN_HOOD_TRACE(this)
+        table_stats s;
+        s.info_inc = mInfoInc;
+        s.info_hash_shift = mInfoHashShift;
+        s.node_pool_bytes = DataPool::numBytesAllocated();
+        s.load_factor = load_factor();
+        size_t sumProbeLengths = 0;
+        addStats(&s, &sumProbeLengths);
+        if (rehash_pending()) {
+            this->incremental()->old.addStats(&s, &sumProbeLengths);
+        }
+        s.max_probe_length = s.distance_histogram.size();
+        if (0 != size()) {
+            s.mean_probe_length =
+                static_cast<double>(sumProbeLengths) / static_cast<double>(size());
+        }
+        return s;
+    }
+
     ROBIN_HOOD(NODISCARD) size_t calcMaxNumElementsAllowed(size_t maxElements) const noexcept {
         if (ROBIN_HOOD_LIKELY(maxElements <= (std::numeric_limits<size_t>::max)() / 100)) {
             return maxElements * MaxLoadFactor100 / 100;
@@ -2142,16 +3873,54 @@ public:
         return (maxElements / 100) * MaxLoadFactor100;
     }
 
+    ROBIN_HOOD(NODISCARD) size_t calcNumInfos(size_t numElements) const noexcept {
+        // we add 16 bytes of infos, which house the sentinel (first one) and padding so we can load
+        // 64bit types, or a whole group of infos for matchGroup(). Also without SSE2, so images
+        // are the same.
+        return numElements + 16 / sizeof(InfoEntry);
+    }
+
     ROBIN_HOOD(NODISCARD) size_t calcNumBytesInfo(size_t numElements) const noexcept {
-        // we add a uint64_t, which houses the sentinel (first byte) and padding so we can load
-        // 64bit types.
-        return numElements + sizeof(uint64_t);
+        return calcNumInfos(numElements) * sizeof(InfoEntry);
     }
 
     ROBIN_HOOD(NODISCARD)
     size_t calcNumElementsWithBuffer(size_t numElements) const noexcept {
         auto maxNumElementsAllowed = calcMaxNumElementsAllowed(numElements);
-        return numElements + (std::min)(maxNumElementsAllowed, (static_cast<size_t>(0xFF)));
+        return numElements + (std::min)(maxNumElementsAllowed, static_cast<size_t>(MaxNumBuffer));
+    }
+
+    // Smallest number of buckets that can hold numElements. 0 on overflow.
+    ROBIN_HOOD(NODISCARD) size_t calcNumBucketsFor(size_t numElements) const noexcept {
+        if (PowerOfTwoSizes) {
+            auto newSize = InitialNumElements;
+            while (calcMaxNumElementsAllowed(newSize) < numElements && newSize != 0) {
+                newSize *= 2;
+            }
+            return newSize;
+        }
+        if (numElements <= calcMaxNumElementsAllowed(InitialNumElements)) {
+            return InitialNumElements;
+        }
+        if (ROBIN_HOOD_LIKELY(numElements <= (std::numeric_limits<size_t>::max)() / 100)) {
+            return (numElements * 100 + MaxLoadFactor100 - 1) / MaxLoadFactor100;
+        }
+        // calcMaxNumElementsAllowed is inprecise too for such a large number
+        auto const n = numElements / MaxLoadFactor100 + 1;
+        return n <= (std::numeric_limits<size_t>::max)() / 100 ? n * 100 : 0;
+    }
+
+    // Number of buckets after growing from numBuckets. 0 on overflow.
+    ROBIN_HOOD(NODISCARD) size_t calcGrownNumBuckets(size_t numBuckets) const noexcept {
+        if (PowerOfTwoSizes) {
+            return numBuckets * 2;
+        }
+        if (ROBIN_HOOD_LIKELY(numBuckets <= (std::numeric_limits<size_t>::max)() / 400)) {
+            return (std::max)(numBuckets + 1, numBuckets * GrowthFactor100 / 100);
+        }
+        auto const n = numBuckets / 100 + 1;
+        return n <= (std::numeric_limits<size_t>::max)() / GrowthFactor100 ? n * GrowthFactor100
+                                                                            : 0;
     }
 
     // calculation only allowed for 2^n values
@@ -2192,11 +3961,9 @@ private:
 
     void reserve(size_t c, bool forceRehash) {
         ROBIN_HOOD_TRACE(this)
+        finish_rehash();
         auto const minElementsAllowed = (std::max)(c, mNumElements);
-        auto newSize = InitialNumElements;
-        while (calcMaxNumElementsAllowed(newSize) < minElementsAllowed && newSize != 0) {
-            newSize *= 2;
-        }
+        auto const newSize = calcNumBucketsFor(minElementsAllowed);
         if (ROBIN_HOOD_UNLIKELY(newSize == 0)) {
             throwOverflowError();
         }
@@ -2206,18 +3973,17 @@ private:
         // only actually do anything when the new size is bigger than the old one. This prevents to
         // continuously allocate for each reserve() call.
         if (forceRehash || newSize > mMask + 1) {
-            rehashPowerOfTwo(newSize, false);
+            rehashToBucketCount(newSize, false);
         }
     }
 
-    // reserves space for at least the specified number of elements.
-    // only works if numBuckets if power of two
-    // True on success, false otherwise
-    void rehashPowerOfTwo(size_t numBuckets, bool forceFree) {
+    // Reallocates the arrays with exactly numBuckets buckets and moves all entries over.
+    // numBuckets has to be a power of two, unless PowerOfTwoSizes is false.
+    void rehashToBucketCount(size_t numBuckets, bool forceFree) {
         ROBIN_HOOD_TRACE(this)
 
         Node* const oldKeyVals = mKeyVals;
-        uint8_t const* const oldInfo = mInfo;
+        InfoEntry const* const oldInfo = mInfo;
 
         const size_t oldMaxElementsWithBuffer = calcNumElementsWithBuffer(mMask + 1);
 
@@ -2240,7 +4006,8 @@ private:
             if (oldKeyVals != reinterpret_cast_no_cast_align_warning<Node*>(&mMask)) {
                 // don't destroy old data: put it into the pool instead
                 if (forceFree) {
-                    std::free(oldKeyVals);
+                    DataPool::deallocateBytes(oldKeyVals,
+                                              calcNumBytesTotal(oldMaxElementsWithBuffer));
                 } else {
                     DataPool::addOrFree(oldKeyVals, calcNumBytesTotal(oldMaxElementsWithBuffer));
                 }
@@ -2256,10 +4023,38 @@ private:
 #endif
     }
 
+    // Moves the already constructed n with hash h into the table, or destroys it when its key is
+    // already present.
+    std::pair<iterator, bool> emplaceNode(Node& n, size_t h) {
+        auto idxAndState = insertKeyPrepareEmptySpot(getFirstConst(n), h);
+        switch (idxAndState.second) {
+        case InsertionState::key_found:
+            n.destroy(*this);
+            break;
+
+        case InsertionState::new_node:
+            ::new (static_cast<void*>(&mKeyVals[idxAndState.first])) Node(*this, std::move(n));
+            break;
+
+        case InsertionState::overwrite_node:
+            mKeyVals[idxAndState.first] = std::move(n);
+            break;
+
+        case InsertionState::overflow_error:
+            n.destroy(*this);
+            throwOverflowError();
+            break;
+        }
+
+        setNodeHash(idxAndState.first, h);
+        return std::make_pair(iterAt<iterator>(idxAndState.first),
+                              InsertionState::key_found != idxAndState.second);
+    }
+
     template <typename OtherKey, typename... Args>
-    std::pair<iterator, bool> try_emplace_impl(OtherKey&& key, Args&&... args) {
+    std::pair<iterator, bool> try_emplace_impl(size_t h, OtherKey&& key, Args&&... args) {
         ROBIN_HOOD_TRACE(this)
-        auto idxAndState = insertKeyPrepareEmptySpot(key);
+        auto idxAndState = insertKeyPrepareEmptySpot(key, h);
         switch (idxAndState.second) {
         case InsertionState::key_found:
             break;
@@ -2281,14 +4076,16 @@ private:
             break;
         }
 
-        return std::make_pair(iterator(mKeyVals + idxAndState.first, mInfo + idxAndState.first),
+        setNodeHash(idxAndState.first, h);
+        return std::make_pair(iterAt<iterator>(idxAndState.first),
                               InsertionState::key_found != idxAndState.second);
     }
 
     template <typename OtherKey, typename Mapped>
     std::pair<iterator, bool> insertOrAssignImpl(OtherKey&& key, Mapped&& obj) {
         ROBIN_HOOD_TRACE(this)
-        auto idxAndState = insertKeyPrepareEmptySpot(key);
+        auto const h = hash_for(key);
+        auto idxAndState = insertKeyPrepareEmptySpot(key, h);
         switch (idxAndState.second) {
         case InsertionState::key_found:
             mKeyVals[idxAndState.first].getSecond() = std::forward<Mapped>(obj);
@@ -2311,7 +4108,8 @@ private:
             break;
         }
 
-        return std::make_pair(iterator(mKeyVals + idxAndState.first, mInfo + idxAndState.first),
+        setNodeHash(idxAndState.first, h);
+        return std::make_pair(iterAt<iterator>(idxAndState.first),
                               InsertionState::key_found != idxAndState.second);
     }
 
@@ -2324,11 +4122,11 @@ private:
 
         // malloc & zero mInfo. Faster than calloc everything.
         auto const numBytesTotal = calcNumBytesTotal(numElementsWithBuffer);
-        ROBIN_HOOD_LOG("std::calloc " << numBytesTotal << " = calcNumBytesTotal("
-                                      << numElementsWithBuffer << ")")
-        mKeyVals = reinterpret_cast<Node*>(
-            detail::assertNotNull<std::bad_alloc>(std::malloc(numBytesTotal)));
-        mInfo = reinterpret_cast<uint8_t*>(mKeyVals + numElementsWithBuffer);
+        ROBIN_HOOD_LOG("allocate " << numBytesTotal << " = calcNumBytesTotal("
+                                   << numElementsWithBuffer << ")")
+        mKeyVals = static_cast<Node*>(DataPool::allocateBytes(numBytesTotal));
+        mInfo = reinterpret_cast_no_cast_align_warning<InfoEntry*>(
+            mKeyVals + numElementsWithBuffer);
         std::memset(mInfo, 0, numBytesTotal - numElementsWithBuffer * sizeof(Node));
 
         // set sentinel
@@ -2343,23 +4141,56 @@ private:
     // Finds key, and if not already present prepares a spot where to pot the key & value.
     // This potentially shifts nodes out of the way, updates mInfo and number of inserted
     // elements, so the only operation left to do is create/assign a new node at that spot.
+    // h is the already calculated hash of key, see hash_for().
     template <typename OtherKey>
-    std::pair<size_t, InsertionState> insertKeyPrepareEmptySpot(OtherKey&& key) {
+    std::pair<size_t, InsertionState> insertKeyPrepareEmptySpot(OtherKey&& key, size_t h) {
         for (int i = 0; i < 256; ++i) {
+            if (ROBIN_HOOD_UNLIKELY(rehash_pending())) {
+                advanceRehash(key, h);
+            }
+
             size_t idx{};
             InfoType info{};
-            keyToIdx(key, &idx, &info);
+            hashToIdx(h, &idx, &info);
+#if ROBIN_HOOD(HAS_SSE2)
+            // compare only the potential matches, then continue at the end of the probe sequence
+            for (;;) {
+                auto const bits = matchGroup(idx, info);
+                auto matches = groupMatches(bits);
+                while (matches) {
+                    auto const matchIdx =
+                        idx + static_cast<size_t>(ROBIN_HOOD_COUNT_TRAILING_ZEROES(matches));
+                    if (nodeKeyEquals(key, h, mKeyVals[matchIdx])) {
+                        // key already exists, do NOT insert.
+                        // see http://en.cppreference.com/w/cpp/container/unordered_map/insert
+                        return std::make_pair(matchIdx, InsertionState::key_found);
+                    }
+                    matches &= matches - 1U;
+                }
+                auto const endBits = bits >> GroupSize;
+                if (endBits) {
+                    auto const lane =
+                        static_cast<size_t>(ROBIN_HOOD_COUNT_TRAILING_ZEROES(endBits));
+                    idx += lane;
+                    info += static_cast<InfoType>(lane) * mInfoInc;
+                    break;
+                }
+                idx += GroupSize;
+                info += static_cast<InfoType>(GroupSize) * mInfoInc;
+            }
+#else
             nextWhileLess(&info, &idx);
 
             // while we potentially have a match
             while (info == mInfo[idx]) {
-                if (WKeyEqual::operator()(key, mKeyVals[idx].getFirst())) {
+                if (nodeKeyEquals(key, h, mKeyVals[idx])) {
                     // key already exists, do NOT insert.
                     // see http://en.cppreference.com/w/cpp/container/unordered_map/insert
                     return std::make_pair(idx, InsertionState::key_found);
                 }
                 next(&info, &idx);
             }
+#endif
 
             // unlikely that this evaluates to true
             if (ROBIN_HOOD_UNLIKELY(mNumElements >= mMaxNumElementsAllowed)) {
@@ -2372,7 +4203,7 @@ private:
             // key not found, so we are now exactly where we want to insert it.
             auto const insertion_idx = idx;
             auto const insertion_info = info;
-            if (ROBIN_HOOD_UNLIKELY(insertion_info + mInfoInc > 0xFF)) {
+            if (ROBIN_HOOD_UNLIKELY(insertion_info + mInfoInc > MaxInfo)) {
                 mMaxNumElementsAllowed = 0;
             }
 
@@ -2385,7 +4216,7 @@ private:
                 shiftUp(idx, insertion_idx);
             }
             // put at empty spot
-            mInfo[insertion_idx] = static_cast<uint8_t>(insertion_info);
+            mInfo[insertion_idx] = static_cast<InfoEntry>(insertion_info);
             ++mNumElements;
             return std::make_pair(insertion_idx, idx == insertion_idx
                                                      ? InsertionState::new_node
@@ -2400,21 +4231,23 @@ private:
         ROBIN_HOOD_LOG("mInfoInc=" << mInfoInc << ", numElements=" << mNumElements
                                    << ", maxNumElementsAllowed="
                                    << calcMaxNumElementsAllowed(mMask + 1))
-        if (mInfoInc <= 2) {
+        if (mInfoInc <= MinInfoInc) {
             // need to be > 2 so that shift works (otherwise undefined behavior!)
             return false;
         }
         // we got space left, try to make info smaller
-        mInfoInc = static_cast<uint8_t>(mInfoInc >> 1U);
+        mInfoInc = static_cast<InfoType>(mInfoInc >> 1U);
 
         // remove one bit of the hash, leaving more space for the distance info.
         // This is extremely fast because we can operate on 8 bytes at once.
         ++mInfoHashShift;
         auto const numElementsWithBuffer = calcNumElementsWithBuffer(mMask + 1);
+        auto const highBitsCleared =
+            WideInfo ? UINT64_C(0x7fff7fff7fff7fff) : UINT64_C(0x7f7f7f7f7f7f7f7f);
 
-        for (size_t i = 0; i < numElementsWithBuffer; i += 8) {
+        for (size_t i = 0; i < numElementsWithBuffer; i += sizeof(uint64_t) / sizeof(InfoEntry)) {
             auto val = unaligned_load<uint64_t>(mInfo + i);
-            val = (val >> 1U) & UINT64_C(0x7f7f7f7f7f7f7f7f);
+            val = (val >> 1U) & highBitsCleared;
             std::memcpy(mInfo + i, &val, sizeof(val));
         }
         // update sentinel, which might have been cleared out!
@@ -2437,6 +4270,10 @@ private:
             return true;
         }
 
+        // a pending incremental rehash is usually done long before the map is full again, but not
+        // when mInfoInc can't be decreased any more.
+        finish_rehash();
+
         ROBIN_HOOD_LOG("mNumElements=" << mNumElements << ", maxNumElementsAllowed="
                                        << maxNumElementsAllowed << ", load="
                                        << (static_cast<double>(mNumElements) * 100.0 /
@@ -2447,97 +4284,1265 @@ private:
             // Try to rehash instead. Delete freed memory so we don't steadyily increase mem in case
             // we have to rehash a few times
             nextHashMultiplier();
-            rehashPowerOfTwo(mMask + 1, true);
+            rehashToBucketCount(mMask + 1, true);
         } else {
             // we've reached the capacity of the map, so the hash seems to work nice. Keep using it.
-            rehashPowerOfTwo((mMask + 1) * 2, false);
+            auto const numBuckets = calcGrownNumBuckets(mMask + 1);
+            if (ROBIN_HOOD_UNLIKELY(numBuckets == 0)) {
+                throwOverflowError();
+            }
+            if (Incremental && nullptr != this->incremental()) {
+                startIncrementalRehash(numBuckets);
+            } else {
+                rehashToBucketCount(numBuckets, false);
+            }
         }
         return true;
     }
 
+    // Adds the buckets of this table's arrays to the statistics of stats().
+    void addStats(table_stats* s, size_t* sumProbeLengths) const {
+        if (0 == mMask) {
+            return;
+        }
+        auto const numElementsWithBuffer = calcNumElementsWithBuffer(mMask + 1);
+        s->table_bytes += calcNumBytesTotal(numElementsWithBuffer);
+        size_t cluster = 0;
+        for (size_t idx = 0; idx < numElementsWithBuffer; ++idx) {
+            if (0 == mInfo[idx]) {
+                cluster = 0;
+                continue;
+            }
+            s->longest_cluster = (std::max)(s->longest_cluster, ++cluster);
+            // the upper bits count the distance, starting with mInfoInc in the home bucket
+            auto const distance = static_cast<size_t>(mInfo[idx] / mInfoInc) - 1;
+            if (distance >= s->distance_histogram.size()) {
+                s->distance_histogram.resize(distance + 1);
+            }
+            ++s->distance_histogram[distance];
+            *sumProbeLengths += distance + 1;
+        }
+    }
+
     void nextHashMultiplier() {
         // adding an *even* number, so that the multiplier will always stay odd. This is necessary
         // so that the hash stays a mixing function (and thus doesn't have any information loss).
         mHashMultiplier += UINT64_C(0xc4ceb9fe1a85ec54);
     }
 
-    void destroy() {
-        if (0 == mMask) {
-            // don't deallocate!
-            return;
-        }
+    // Same as rehashToBucketCount(numBuckets, false), but the entries are not moved yet. The old
+    // arrays are handed over to mIncremental, and advanceRehash() moves them bit by bit.
+    void startIncrementalRehash(size_t numBuckets) {
+        auto& r = *this->incremental();
+        auto& old = r.old;
+        old.mHashMultiplier = mHashMultiplier;
+        old.mKeyVals = mKeyVals;
+        old.mInfo = mInfo;
+        old.mNumElements = mNumElements;
+        old.mMask = mMask;
+        old.mMaxNumElementsAllowed = mMaxNumElementsAllowed;
+        old.mInfoInc = mInfoInc;
+        old.mInfoHashShift = mInfoHashShift;
+        r.idx = 0;
 
-        Destroyer<Self, IsFlat && std::is_trivially_destructible<Node>::value>{}
-            .nodesDoNotDeallocate(*this);
+        initData(numBuckets);
 
-        // This protection against not deleting mMask shouldn't be needed as it's sufficiently
-        // protected with the 0==mMask check, but I have this anyways because g++ 7 otherwise
-        // reports a compile error: attempt to free a non-heap object 'fm'
-        // [-Werror=free-nonheap-object]
-        if (mKeyVals != reinterpret_cast_no_cast_align_warning<Node*>(&mMask)) {
-            ROBIN_HOOD_LOG("std::free")
-            std::free(mKeyVals);
+        // Each step either moves an entry or skips a slot. Only inserts can fill the new arrays,
+        // so move fast enough that everything is over before they are full.
+        auto const work = calcNumElementsWithBuffer(old.mMask + 1) + old.mNumElements;
+        auto const room = mMaxNumElementsAllowed > old.mNumElements
+                              ? mMaxNumElementsAllowed - old.mNumElements
+                              : size_t(1);
+        r.slotsPerStep = (std::max)(r.slotsPerOperation, work / room + 1);
+    }
+
+    // Called by inserts and erases while a rehash is pending. Moves the next slots, and key (with
+    // hash h) when it is still in the old arrays, so the caller only has to deal with this table.
+    template <typename Other>
+    void advanceRehash(Other const& key, size_t h) {
+        auto& old = this->incremental()->old;
+        auto const oldIdx = old.findIdxWithHash(key, h);
+        if (old.mKeyVals + oldIdx != reinterpret_cast_no_cast_align_warning<Node*>(old.mInfo)) {
+            movePendingEntry(oldIdx);
         }
+        movePendingSlots(this->incremental()->slotsPerStep);
     }
 
-    void init() noexcept {
-        mKeyVals = reinterpret_cast_no_cast_align_warning<Node*>(&mMask);
-        mInfo = reinterpret_cast<uint8_t*>(&mMask);
-        mNumElements = 0;
-        mMask = 0;
-        mMaxNumElementsAllowed = 0;
-        mInfoInc = InitialInfoInc;
-        mInfoHashShift = InitialInfoHashShift;
+    // Moves up to n slots of the old arrays. Gives the old arrays back when everything is moved.
+    void movePendingSlots(size_t n) {
+        auto& r = *this->incremental();
+        while (0 != n && 0 != r.old.mNumElements) {
+            if (0 != r.old.mInfo[r.idx]) {
+                movePendingEntry(r.idx);
+            } else {
+                ++r.idx;
+            }
+            --n;
+        }
+        if (0 == r.old.mNumElements) {
+            releasePending();
+        }
     }
 
-    // members are sorted so no padding occurs
-    uint64_t mHashMultiplier = UINT64_C(0xc4ceb9fe1a85ec53);                // 8 byte  8
-    Node* mKeyVals = reinterpret_cast_no_cast_align_warning<Node*>(&mMask); // 8 byte 16
-    uint8_t* mInfo = reinterpret_cast<uint8_t*>(&mMask);                    // 8 byte 24
-    size_t mNumElements = 0;                                                // 8 byte 32
-    size_t mMask = 0;                                                       // 8 byte 40
-    size_t mMaxNumElementsAllowed = 0;                                      // 8 byte 48
-    InfoType mInfoInc = InitialInfoInc;                                     // 4 byte 52
-    InfoType mInfoHashShift = InitialInfoHashShift;                         // 4 byte 56
-                                                    // 16 byte 56 if NodeAllocator
-};
+    // Moves the entry at oldIdx of the old arrays into this table.
+    void movePendingEntry(size_t oldIdx) {
+        auto& old = this->incremental()->old;
+        insert_move(std::move(old.mKeyVals[oldIdx]));
+        old.closeGap(oldIdx);
+        --old.mNumElements;
+    }
 
-} // namespace detail
+    // The old arrays are kept even when this was the last entry, so that end() stays valid.
+    void erasePending(size_t oldIdx) {
+        auto& old = this->incremental()->old;
+        old.mKeyVals[oldIdx].destroy(*this);
+        old.closeGap(oldIdx);
+        --old.mNumElements;
+    }
 
-// map
+    ROBIN_HOOD(NODISCARD) bool isPendingNode(Node const* n) const noexcept {
+        auto const& old = this->incremental()->old;
+        auto const* const endNode = reinterpret_cast_no_cast_align_warning<Node const*>(old.mInfo);
+        return !std::less<Node const*>{}(n, old.mKeyVals) && std::less<Node const*>{}(n, endNode);
+    }
 
-template <typename Key, typename T, typename Hash = hash<Key>,
-          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80>
-using unordered_flat_map = detail::Table<true, MaxLoadFactor100, Key, T, Hash, KeyEqual>;
+    // Gives the empty old arrays back.
+    void releasePending() {
+        auto& old = this->incremental()->old;
+        DataPool::addOrFree(old.mKeyVals,
+                            calcNumBytesTotal(calcNumElementsWithBuffer(old.mMask + 1)));
+        old.init();
+    }
 
-template <typename Key, typename T, typename Hash = hash<Key>,
-          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80>
-using unordered_node_map = detail::Table<false, MaxLoadFactor100, Key, T, Hash, KeyEqual>;
+    // Destroys the entries that weren't moved yet, and gives the old arrays back.
+    void discardPendingRehash() {
+        if (!rehash_pending()) {
+            return;
+        }
+        auto& old = this->incremental()->old;
+        auto const numElementsWithBuffer = calcNumElementsWithBuffer(old.mMask + 1);
+        for (size_t idx = this->incremental()->idx; idx < numElementsWithBuffer; ++idx) {
+            if (0 != old.mInfo[idx]) {
+                old.mKeyVals[idx].destroy(*this);
+                old.mKeyVals[idx].~Node();
+            }
+        }
+        releasePending();
+    }
 
-template <typename Key, typename T, typename Hash = hash<Key>,
-          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80>
-using unordered_map =
-    detail::Table<sizeof(robin_hood::pair<Key, T>) <= sizeof(size_t) * 6 &&
-                      std::is_nothrow_move_constructible<robin_hood::pair<Key, T>>::value &&
-                      std::is_nothrow_move_assignable<robin_hood::pair<Key, T>>::value,
-                  MaxLoadFactor100, Key, T, Hash, KeyEqual>;
+    size_t trimNodes(std::false_type /*unused*/) noexcept {
+        return 0;
+    }
 
-// set
+    size_t trimNodes(std::true_type /*unused*/) {
+        return DataPool::shrink(nodeAddresses());
+    }
 
+    void relayoutNodes(std::false_type /*unused*/) noexcept {}
+
+    void relayoutNodes(std::true_type /*unused*/) {
+        DataPool::relayout(nodeAddresses());
+    }
+
+    // where the data pointers of all nodes are, in the order of iteration.
+    std::vector<value_type**> nodeAddresses() {
+        std::vector<value_type**> nodes;
+        if (0 != mMask) {
+            nodes.reserve(mNumElements);
+            auto const numElementsWithBuffer = calcNumElementsWithBuffer(mMask + 1);
+            for (size_t idx = 0; idx < numElementsWithBuffer; ++idx) {
+                if (0 != mInfo[idx]) {
+                    nodes.push_back(mKeyVals[idx].dataAddress());
+                }
+            }
+        }
+        return nodes;
+    }
+
+    // Copies the incremental rehash setting of o, call after assigning the hash and key_equal.
+    void copyIncrementalRehash(Table const& o) {
+        copyIncrementalRehash(o, std::integral_constant<bool, Incremental>{});
+    }
+
+    void copyIncrementalRehash(Table const& /*unused*/, std::false_type /*unused*/) noexcept {}
+
+    void copyIncrementalRehash(Table const& o, std::true_type /*unused*/) {
+        this->mIncremental.reset();
+        if (o.mIncremental) {
+            set_incremental_rehash(o.mIncremental->slotsPerOperation);
+        }
+    }
+
+    // Copies the old arrays of o's pending rehash, after cloneData(o). Just like the new arrays,
+    // their nodes come from this map's pool.
+    void clonePendingRehash(Table const& o) {
+        if (!o.rehash_pending()) {
+            return;
+        }
+        auto const& src = o.incremental()->old;
+        auto& r = *this->incremental();
+        auto& old = r.old;
+        auto const numElementsWithBuffer = calcNumElementsWithBuffer(src.mMask + 1);
+        auto const numBytesTotal = calcNumBytesTotal(numElementsWithBuffer);
+        // old.mMask stays 0 until everything is copied, so nothing is pending if a copy throws.
+        old.mKeyVals = static_cast<Node*>(DataPool::allocateBytes(numBytesTotal));
+        old.mInfo = reinterpret_cast_no_cast_align_warning<InfoEntry*>(old.mKeyVals +
+                                                                       numElementsWithBuffer);
+        std::copy(src.mInfo, src.mInfo + calcNumInfos(numElementsWithBuffer), old.mInfo);
+        size_t idx = 0;
+#if ROBIN_HOOD(HAS_EXCEPTIONS)
+        try {
+#endif
+            for (; idx < numElementsWithBuffer; ++idx) {
+                if (0 != old.mInfo[idx]) {
+                    ::new (static_cast<void*>(old.mKeyVals + idx)) Node(*this, *src.mKeyVals[idx]);
+                    old.setNodeHash(idx, src.nodeHash(src.mKeyVals[idx]));
+                }
+            }
+#if ROBIN_HOOD(HAS_EXCEPTIONS)
+        } catch (...) {
+            while (0 != idx) {
+                --idx;
+                if (0 != old.mInfo[idx]) {
+                    old.mKeyVals[idx].destroy(*this);
+                    old.mKeyVals[idx].~Node();
+                }
+            }
+            DataPool::deallocateBytes(old.mKeyVals, numBytesTotal);
+            old.init();
+            throw;
+        }
+#endif
+        old.mHashMultiplier = src.mHashMultiplier;
+        old.mNumElements = src.mNumElements;
+        old.mMask = src.mMask;
+        old.mMaxNumElementsAllowed = src.mMaxNumElementsAllowed;
+        old.mInfoInc = src.mInfoInc;
+        old.mInfoHashShift = src.mInfoHashShift;
+        r.idx = o.incremental()->idx;
+        r.slotsPerStep = o.incremental()->slotsPerStep;
+    }
+
+    void destroy() {
+        discardPendingRehash();
+        if (0 == mMask) {
+            // don't deallocate!
+            return;
+        }
+
+        // nodes of our own pool are freed with it, but a shared pool needs them back.
+        Destroyer<Self, IsFlat && std::is_trivially_destructible<Node>::value> destroyer{};
+        if (DataPool::OwnsNodes) {
+            destroyer.nodesDoNotDeallocate(*this);
+        } else {
+            destroyer.nodes(*this);
+        }
+
+        // This protection against not deleting mMask shouldn't be needed as it's sufficiently
+        // protected with the 0==mMask check, but I have this anyways because g++ 7 otherwise
+        // reports a compile error: attempt to free a non-heap object 'fm'
+        // [-Werror=free-nonheap-object]
+        if (mKeyVals != reinterpret_cast_no_cast_align_warning<Node*>(&mMask)) {
+            DataPool::deallocateBytes(mKeyVals,
+                                      calcNumBytesTotal(calcNumElementsWithBuffer(mMask + 1)));
+        }
+    }
+
+    // Replaces the content with o's entries, moved one by one. Used when o's memory can't be taken
+    // over, see operator=(Table&&).
+    void moveEntriesFrom(Table& o) {
+        o.finish_rehash();
+        clear();
+        WHash::operator=(std::move(static_cast<WHash&>(o)));
+        WKeyEqual::operator=(std::move(static_cast<WKeyEqual&>(o)));
+        reserve(o.size());
+        for (auto& v : o) {
+            emplace(std::move(v));
+        }
+        o.clear();
+    }
+
+    void init() noexcept {
+        mKeyVals = reinterpret_cast_no_cast_align_warning<Node*>(&mMask);
+        mInfo = reinterpret_cast_no_cast_align_warning<InfoEntry*>(&mMask);
+        mNumElements = 0;
+        mMask = 0;
+        mMaxNumElementsAllowed = 0;
+        mInfoInc = InitialInfoInc;
+        mInfoHashShift = InitialInfoHashShift;
+    }
+
+    // Streaming, see serialize() ///////////////////////////////////////
+
+    static constexpr uint64_t UnknownInputSize = (std::numeric_limits<uint64_t>::max)();
+
+    template <typename Q = mapped_type>
+    static constexpr typename std::enable_if<!std::is_void<Q>::value, size_t>::type
+    serializedElementMinSize() {
+        return SerializedMinSize<key_type>::value + SerializedMinSize<Q>::value;
+    }
+
+    template <typename Q = mapped_type>
+    static constexpr typename std::enable_if<std::is_void<Q>::value, size_t>::type
+    serializedElementMinSize() {
+        return SerializedMinSize<key_type>::value;
+    }
+
+    template <typename Out, typename Q = mapped_type>
+    static typename std::enable_if<!std::is_void<Q>::value>::type writeValue(Out& out,
+                                                                            value_type const& v) {
+        serializer<key_type>::write(out, v.first);
+        serializer<Q>::write(out, v.second);
+    }
+
+    template <typename Out, typename Q = mapped_type>
+    static typename std::enable_if<std::is_void<Q>::value>::type writeValue(Out& out,
+                                                                           value_type const& v) {
+        serializer<key_type>::write(out, v);
+    }
+
+    // reads an element that is known to be new, and inserts it with insert_move.
+    template <typename In, typename Q = mapped_type>
+    typename std::enable_if<!std::is_void<Q>::value>::type readNode(In& in) {
+        auto key = serializer<key_type>::read(in);
+        auto obj = serializer<Q>::read(in);
+        Node n(*this, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+               std::forward_as_tuple(std::move(obj)));
+        insertReadNode(n);
+    }
+
+    template <typename In, typename Q = mapped_type>
+    typename std::enable_if<std::is_void<Q>::value>::type readNode(In& in) {
+        Node n(*this, serializer<key_type>::read(in));
+        insertReadNode(n);
+    }
+
+    void insertReadNode(Node& n) {
+        setNodeHash(n, StoresHash{});
+        insert_move(std::move(n));
+    }
+
+    void setNodeHash(Node& n, std::true_type /*unused*/) {
+        n.setHash(static_cast<size_t>(WHash::operator()(n.getFirst())));
+    }
+
+    void setNodeHash(Node& ROBIN_HOOD_UNUSED(n) /*unused*/, std::false_type /*unused*/) noexcept {}
+
+    // Persistent image, see save() ////////////////////////////////////
+
+    template <typename Map>
+    friend class MappedTable;
+
+    // Everything except the arrays. The fields that only need to match are there to detect files
+    // that were written by an incompatible map.
+    struct ImageHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t endianness;
+        uint64_t nodeSize;
+        uint64_t growthFactor100;
+        uint64_t hashMultiplier;
+        uint64_t numElements;
+        uint64_t mask;
+        uint64_t maxNumElementsAllowed;
+        uint32_t infoInc;
+        uint32_t infoHashShift;
+        uint32_t maxLoadFactor100;
+        uint32_t infoSize;
+        uint64_t hashVariant;
+        uint64_t dataSize;
+    };
+
+    static char const* imageMagic() noexcept {
+        return "rhimage";
+    }
+    static constexpr uint32_t ImageVersion = 3;
+    static constexpr uint32_t ImageEndianness = 0x01020304;
+    // the arrays start at a cache line boundary
+    static constexpr size_t ImageDataOffset = 128;
+    static_assert(sizeof(ImageHeader) <= ImageDataOffset, "header too large");
+
+    ImageHeader makeImageHeader() const {
+        ImageHeader h{};
+        std::memcpy(h.magic, imageMagic(), sizeof(h.magic));
+        h.version = ImageVersion;
+        h.endianness = ImageEndianness;
+        h.nodeSize = sizeof(Node);
+        h.growthFactor100 = GrowthFactor100;
+        h.hashMultiplier = mHashMultiplier;
+        h.numElements = mNumElements;
+        h.mask = mMask;
+        h.maxNumElementsAllowed = mMaxNumElementsAllowed;
+        h.infoInc = mInfoInc;
+        h.infoHashShift = mInfoHashShift;
+        h.maxLoadFactor100 = MaxLoadFactor100;
+        h.infoSize = sizeof(InfoEntry);
+        h.hashVariant = ImageHashVariant<Hash>::get();
+        if (0 != mMask) {
+            h.dataSize = calcNumBytesTotal(calcNumElementsWithBuffer(mMask + 1));
+        }
+        return h;
+    }
+
+    // Returns nullptr when the header of an image with the given total size can be used, otherwise
+    // what's wrong with it. The arrays are checked with imageDataError().
+    ROBIN_HOOD(NODISCARD)
+    char const* imageError(ImageHeader const& h, uint64_t totalSize) const {
+        if (0 != std::memcmp(h.magic, imageMagic(), sizeof(h.magic))) {
+            return "robin_hood: not a map image";
+        }
+        if (h.version != ImageVersion || h.endianness != ImageEndianness) {
+            return "robin_hood: unsupported image version or endianness";
+        }
+        if (h.nodeSize != sizeof(Node) || h.growthFactor100 != GrowthFactor100 ||
+            h.maxLoadFactor100 != MaxLoadFactor100 || h.infoSize != sizeof(InfoEntry)) {
+            return "robin_hood: image was written by a different map type";
+        }
+        if (h.hashVariant != ImageHashVariant<Hash>::get()) {
+            return "robin_hood: image was written with a different hash";
+        }
+        if (0 == h.mask) {
+            return 0 == h.numElements && 0 == h.dataSize ? nullptr : "robin_hood: corrupt image";
+        }
+        // each bucket needs at least one info byte, so larger masks can't be right
+        if (h.mask >= totalSize || h.mask + 1 < InitialNumElements ||
+            (PowerOfTwoSizes && 0 != ((h.mask + 1) & h.mask))) {
+            return "robin_hood: corrupt image";
+        }
+        auto const numBuckets = static_cast<size_t>(h.mask) + 1;
+        auto const maxNumElementsAllowed = calcMaxNumElementsAllowed(numBuckets);
+        if (h.dataSize != calcNumBytesTotal(calcNumElementsWithBuffer(numBuckets)) ||
+            ImageDataOffset + h.dataSize > totalSize || h.numElements > maxNumElementsAllowed ||
+            h.maxNumElementsAllowed > maxNumElementsAllowed || 0 == (h.hashMultiplier & 1U)) {
+            return "robin_hood: corrupt image";
+        }
+        // try_increase_info() halves infoInc and increments infoHashShift together
+        auto infoHashShift = static_cast<uint32_t>(InitialInfoHashShift);
+        auto infoInc = static_cast<uint32_t>(InitialInfoInc);
+        while (infoInc > h.infoInc && infoInc > MinInfoInc) {
+            infoInc >>= 1U;
+            ++infoHashShift;
+        }
+        if (infoInc != h.infoInc || infoHashShift != h.infoHashShift) {
+            return "robin_hood: corrupt image";
+        }
+        return nullptr;
+    }
+
+    // Returns nullptr when the arrays of an image with a header that passed imageError() can be
+    // used, otherwise what's wrong with them. Finding a key has to stop at the sentinel, and
+    // inserting has to find an empty slot before it, so each entry has to be behind its bucket in
+    // the table, distances grow by at most one from slot to slot, and numElements slots are used.
+    // Whether the keys are in the buckets of their hash is not checked, that would need a rehash.
+    ROBIN_HOOD(NODISCARD)
+    char const* imageDataError(ImageHeader const& h, Node const* data) const {
+        if (0 == h.mask) {
+            return nullptr;
+        }
+        auto const mask = static_cast<size_t>(h.mask);
+        auto const numElementsWithBuffer = calcNumElementsWithBuffer(mask + 1);
+        auto const* info = reinterpret_cast_no_cast_align_warning<InfoEntry const*>(
+            data + numElementsWithBuffer);
+        auto const numInfos =
+            (static_cast<size_t>(h.dataSize) - numElementsWithBuffer * sizeof(Node)) /
+            sizeof(InfoEntry);
+
+        size_t numElements = 0;
+        size_t maxDistance = 0;
+        for (size_t idx = 0; idx < numElementsWithBuffer; ++idx) {
+            if (0 == info[idx]) {
+                maxDistance = 0;
+                continue;
+            }
+            if (info[idx] < h.infoInc || info[idx] > MaxInfo) {
+                return "robin_hood: corrupt image";
+            }
+            auto const distance = static_cast<size_t>(info[idx] / h.infoInc) - 1;
+            if (distance > maxDistance || idx - distance > mask) {
+                return "robin_hood: corrupt image";
+            }
+            maxDistance = distance + 1;
+            ++numElements;
+        }
+        if (numElements != h.numElements || 1 != info[numElementsWithBuffer]) {
+            return "robin_hood: corrupt image";
+        }
+        for (size_t idx = numElementsWithBuffer + 1; idx < numInfos; ++idx) {
+            if (0 != info[idx]) {
+                return "robin_hood: corrupt image";
+            }
+        }
+        return nullptr;
+    }
+
+    // Uses the arrays of an image that was checked with imageError(). The map now owns data,
+    // unless releaseImage() is called before it's destroyed.
+    void useImage(ImageHeader const& h, Node* data) noexcept {
+        if (0 == h.mask) {
+            return;
+        }
+        mHashMultiplier = h.hashMultiplier;
+        mNumElements = static_cast<size_t>(h.numElements);
+        mMask = static_cast<size_t>(h.mask);
+        mMaxNumElementsAllowed = static_cast<size_t>(h.maxNumElementsAllowed);
+        mInfoInc = h.infoInc;
+        mInfoHashShift = h.infoHashShift;
+        mKeyVals = data;
+        mInfo = reinterpret_cast_no_cast_align_warning<InfoEntry*>(
+            mKeyVals + calcNumElementsWithBuffer(mMask + 1));
+    }
+
+    // Forgets the arrays of an image without freeing them.
+    void releaseImage() noexcept {
+        init();
+    }
+
+    // members are sorted so no padding occurs
+    uint64_t mHashMultiplier = UINT64_C(0xc4ceb9fe1a85ec53);                // 8 byte  8
+    Node* mKeyVals = reinterpret_cast_no_cast_align_warning<Node*>(&mMask); // 8 byte 16
+    InfoEntry* mInfo = reinterpret_cast_no_cast_align_warning<InfoEntry*>(&mMask); // 8 byte 24
+    size_t mNumElements = 0;                                                // 8 byte 32
+    // number of buckets - 1, a bit mask only for power of two sizes. 0 before the first allocation.
+    size_t mMask = 0;                                                       // 8 byte 40
+    size_t mMaxNumElementsAllowed = 0;                                      // 8 byte 48
+    InfoType mInfoInc = InitialInfoInc;                                     // 4 byte 52
+    InfoType mInfoHashShift = InitialInfoHashShift;                         // 4 byte 56
+                                                    // 16 byte 72 if NodeAllocator
+};
+
+template <typename Table>
+struct IncrementalRehashState {
+    template <typename... Args>
+    explicit IncrementalRehashState(Args&&... args)
+        : old(std::forward<Args>(args)...) {}
+
+    // Owns the old arrays while a rehash is pending. Its nodes are allocated by the map's own
+    // pool. Slots before idx are already moved.
+    Table old;
+    size_t idx = 0;
+    size_t slotsPerOperation = 0;
+    size_t slotsPerStep = 0;
+};
+
+} // namespace detail
+
+// map
+
+// All maps and sets take an Allocator as last template argument, which is used for the table and
+// all nodes. The default uses std::malloc and std::free.
+template <typename Key, typename T, typename Hash = hash<Key>,
+          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80,
+          size_t GrowthFactor100 = 200, typename Allocator = malloc_allocator<char>>
+using unordered_flat_map = detail::Table<true, MaxLoadFactor100, Key, T, Hash, KeyEqual, false,
+                                         GrowthFactor100, Allocator>;
+
+template <typename Key, typename T, typename Hash = hash<Key>,
+          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80,
+          size_t GrowthFactor100 = 200, typename Allocator = malloc_allocator<char>>
+using unordered_node_map = detail::Table<false, MaxLoadFactor100, Key, T, Hash, KeyEqual, false,
+                                         GrowthFactor100, Allocator>;
+
+// Same as unordered_node_map, but each entry also stores the hash of its key. Rehashing never has
+// to hash a key again, and most unequal keys are rejected by comparing the hash. Useful for keys
+// that are expensive to hash or compare, e.g. long strings.
+template <typename Key, typename T, typename Hash = hash<Key>,
+          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80,
+          size_t GrowthFactor100 = 200, typename Allocator = malloc_allocator<char>>
+using unordered_node_map_cached_hash = detail::Table<false, MaxLoadFactor100, Key, T, Hash,
+                                                     KeyEqual, true, GrowthFactor100, Allocator>;
+
+template <typename Key, typename T, typename Hash = hash<Key>,
+          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80,
+          size_t GrowthFactor100 = 200, typename Allocator = malloc_allocator<char>>
+using unordered_map =
+    detail::Table<sizeof(robin_hood::pair<Key, T>) <= sizeof(size_t) * 6 &&
+                      std::is_nothrow_move_constructible<robin_hood::pair<Key, T>>::value &&
+                      std::is_nothrow_move_assignable<robin_hood::pair<Key, T>>::value,
+                  MaxLoadFactor100, Key, T, Hash, KeyEqual, false, GrowthFactor100, Allocator>;
+
+// Same as unordered_flat_map, but with 16 bit info entries. These allow 8 times longer probe
+// sequences, for hashes with many collisions like a string hash that only looks at a prefix. With
+// the 8 bit infos such a map grows while it is mostly empty, and throws std::overflow_error once
+// growing doesn't help. Needs one more byte per bucket, and is slower with a good hash.
+template <typename Key, typename T, typename Hash = hash<Key>,
+          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80,
+          size_t GrowthFactor100 = 200, typename Allocator = malloc_allocator<char>>
+using unordered_flat_map_wide_info = detail::Table<true, MaxLoadFactor100, Key, T, Hash, KeyEqual,
+                                                   false, GrowthFactor100, Allocator, true>;
+
+// Same as unordered_flat_map and unordered_node_map, but with set_incremental_rehash() to bound the
+// latency of the insert that grows the map. Iterators carry two more pointers.
+template <typename Key, typename T, typename Hash = hash<Key>,
+          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80,
+          size_t GrowthFactor100 = 200, typename Allocator = malloc_allocator<char>>
+using unordered_flat_map_incremental =
+    detail::Table<true, MaxLoadFactor100, Key, T, Hash, KeyEqual, false, GrowthFactor100,
+                  Allocator, false, true>;
+
+template <typename Key, typename T, typename Hash = hash<Key>,
+          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80,
+          size_t GrowthFactor100 = 200, typename Allocator = malloc_allocator<char>>
+using unordered_node_map_incremental =
+    detail::Table<false, MaxLoadFactor100, Key, T, Hash, KeyEqual, false, GrowthFactor100,
+                  Allocator, false, true>;
+
+// set
+
+template <typename Key, typename Hash = hash<Key>, typename KeyEqual = std::equal_to<Key>,
+          size_t MaxLoadFactor100 = 80, size_t GrowthFactor100 = 200,
+          typename Allocator = malloc_allocator<char>>
+using unordered_flat_set = detail::Table<true, MaxLoadFactor100, Key, void, Hash, KeyEqual, false,
+                                         GrowthFactor100, Allocator>;
+
+// Same as unordered_flat_set, but with 16 bit info entries, see unordered_flat_map_wide_info.
 template <typename Key, typename Hash = hash<Key>, typename KeyEqual = std::equal_to<Key>,
-          size_t MaxLoadFactor100 = 80>
-using unordered_flat_set = detail::Table<true, MaxLoadFactor100, Key, void, Hash, KeyEqual>;
+          size_t MaxLoadFactor100 = 80, size_t GrowthFactor100 = 200,
+          typename Allocator = malloc_allocator<char>>
+using unordered_flat_set_wide_info =
+    detail::Table<true, MaxLoadFactor100, Key, void, Hash, KeyEqual, false, GrowthFactor100,
+                  Allocator, true>;
 
 template <typename Key, typename Hash = hash<Key>, typename KeyEqual = std::equal_to<Key>,
-          size_t MaxLoadFactor100 = 80>
-using unordered_node_set = detail::Table<false, MaxLoadFactor100, Key, void, Hash, KeyEqual>;
+          size_t MaxLoadFactor100 = 80, size_t GrowthFactor100 = 200,
+          typename Allocator = malloc_allocator<char>>
+using unordered_node_set = detail::Table<false, MaxLoadFactor100, Key, void, Hash, KeyEqual, false,
+                                         GrowthFactor100, Allocator>;
 
+// Same as unordered_node_set, but with the hash of each key stored, see
+// unordered_node_map_cached_hash.
 template <typename Key, typename Hash = hash<Key>, typename KeyEqual = std::equal_to<Key>,
-          size_t MaxLoadFactor100 = 80>
+          size_t MaxLoadFactor100 = 80, size_t GrowthFactor100 = 200,
+          typename Allocator = malloc_allocator<char>>
+using unordered_node_set_cached_hash = detail::Table<false, MaxLoadFactor100, Key, void, Hash,
+                                                     KeyEqual, true, GrowthFactor100, Allocator>;
+
+template <typename Key, typename Hash = hash<Key>, typename KeyEqual = std::equal_to<Key>,
+          size_t MaxLoadFactor100 = 80, size_t GrowthFactor100 = 200,
+          typename Allocator = malloc_allocator<char>>
 using unordered_set = detail::Table<sizeof(Key) <= sizeof(size_t) * 6 &&
                                         std::is_nothrow_move_constructible<Key>::value &&
                                         std::is_nothrow_move_assignable<Key>::value,
-                                    MaxLoadFactor100, Key, void, Hash, KeyEqual>;
+                                    MaxLoadFactor100, Key, void, Hash, KeyEqual, false,
+                                    GrowthFactor100, Allocator>;
+
+// Erases all elements for which pred(value) returns true in a single pass, see Table::retain().
+// Returns the number of erased elements.
+template <bool IsFlat, size_t MaxLoadFactor100, typename Key, typename T, typename Hash,
+          typename KeyEqual, bool StoreHash, size_t GrowthFactor100, typename Allocator,
+          bool WideInfo, bool Incremental, typename Pred>
+size_t erase_if(detail::Table<IsFlat, MaxLoadFactor100, Key, T, Hash, KeyEqual, StoreHash,
+                              GrowthFactor100, Allocator, WideInfo, Incremental>& map,
+                Pred pred) {
+    using Map = detail::Table<IsFlat, MaxLoadFactor100, Key, T, Hash, KeyEqual, StoreHash,
+                              GrowthFactor100, Allocator, WideInfo, Incremental>;
+    return map.retain([&pred](typename Map::value_type& v) { return !pred(v); });
+}
+
+// Map for very many tiny maps. Up to N entries are stored inside the object itself and found with
+// a linear scan, so small maps need no allocation at all. When the N+1th entry is inserted, all
+// entries move into an unordered_flat_map that lives in the same storage, and the map stays hashed
+// from then on, also after clear(). The hash, key_equal and allocator are stored in the object and
+// handed to the hashed map. Copies, moves and swaps take them along.
+//
+// Inserting into the inline storage invalidates no iterators, but erasing moves the last entry
+// into the erased slot, and switching to the hashed layout invalidates all of them.
+template <typename Key, typename T, size_t N, typename Hash = hash<Key>,
+          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80,
+          size_t GrowthFactor100 = 200, typename Allocator = malloc_allocator<char>>
+class small_flat_map : detail::WrapHash<Hash>,
+                       detail::WrapKeyEqual<KeyEqual>,
+                       detail::WrapAllocator<Allocator> {
+    static_assert(N > 0, "N must be at least 1");
+
+    using WHash = detail::WrapHash<Hash>;
+    using WKeyEqual = detail::WrapKeyEqual<KeyEqual>;
+    using WAllocator = detail::WrapAllocator<Allocator>;
+
+public:
+    using map_type =
+        unordered_flat_map<Key, T, Hash, KeyEqual, MaxLoadFactor100, GrowthFactor100, Allocator>;
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = typename map_type::value_type;
+    using size_type = size_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using allocator_type = Allocator;
+
+    // Either a pointer into the inline entries, or an iterator of the hashed map.
+    template <bool IsConst>
+    class Iter {
+    public:
+        using value_type = typename map_type::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = typename std::conditional<IsConst, value_type const&, value_type&>::type;
+        using pointer = typename std::conditional<IsConst, value_type const*, value_type*>::type;
+        using iterator_category = std::forward_iterator_tag;
+
+    private:
+        using Ptr = pointer;
+        using MapIter = typename std::conditional<IsConst, typename map_type::const_iterator,
+                                                  typename map_type::iterator>::type;
+
+    public:
+
+        Iter() = default;
+
+        // Conversion constructor from iterator to const_iterator.
+        template <bool OtherIsConst,
+                  typename = typename std::enable_if<IsConst && !OtherIsConst>::type>
+        // NOLINTNEXTLINE(hicpp-explicit-conversions)
+        Iter(Iter<OtherIsConst> const& other) noexcept
+            : mPtr(other.mPtr)
+            , mIt(other.mIt) {}
+
+        explicit Iter(Ptr ptr) noexcept
+            : mPtr(ptr) {}
+
+        explicit Iter(MapIter it) noexcept
+            : mIt(it) {}
+
+        Iter& operator++() noexcept {
+            if (mPtr) {
+                ++mPtr;
+            } else {
+                ++mIt;
+            }
+            return *this;
+        }
+
+        Iter operator++(int) noexcept {
+            Iter tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        reference operator*() const {
+            return mPtr ? *mPtr : *mIt;
+        }
+
+        pointer operator->() const {
+            return mPtr ? mPtr : &*mIt;
+        }
+
+        template <bool O>
+        bool operator==(Iter<O> const& o) const noexcept {
+            return mPtr == o.mPtr && (mPtr || mIt == o.mIt);
+        }
+
+        template <bool O>
+        bool operator!=(Iter<O> const& o) const noexcept {
+            return !(*this == o);
+        }
+
+    private:
+        friend class small_flat_map;
+        Ptr mPtr{nullptr};
+        MapIter mIt{};
+    };
+
+    using iterator = Iter<false>;
+    using const_iterator = Iter<true>;
+
+    small_flat_map() = default;
+
+    // Nothing is allocated up front, like unordered_flat_map this ignores bucket_count.
+    explicit small_flat_map(size_t ROBIN_HOOD_UNUSED(bucket_count) /*unused*/,
+                            Hash const& h = Hash{}, KeyEqual const& equal = KeyEqual{},
+                            Allocator const& alloc = Allocator{})
+        : WHash(h)
+        , WKeyEqual(equal)
+        , WAllocator(alloc) {}
+
+    explicit small_flat_map(Allocator const& alloc)
+        : WHash()
+        , WKeyEqual()
+        , WAllocator(alloc) {}
+
+    template <typename InputIt>
+    small_flat_map(InputIt first, InputIt last, size_t ROBIN_HOOD_UNUSED(bucket_count) /*unused*/ = 0,
+                   Hash const& h = Hash{}, KeyEqual const& equal = KeyEqual{},
+                   Allocator const& alloc = Allocator{})
+        : WHash(h)
+        , WKeyEqual(equal)
+        , WAllocator(alloc) {
+        insert(first, last);
+    }
+
+    small_flat_map(std::initializer_list<value_type> initlist,
+                   size_t ROBIN_HOOD_UNUSED(bucket_count) /*unused*/ = 0, Hash const& h = Hash{},
+                   KeyEqual const& equal = KeyEqual{}, Allocator const& alloc = Allocator{})
+        : WHash(h)
+        , WKeyEqual(equal)
+        , WAllocator(alloc) {
+        insert(initlist.begin(), initlist.end());
+    }
+
+    small_flat_map(small_flat_map const& o)
+        : WHash(static_cast<WHash const&>(o))
+        , WKeyEqual(static_cast<WKeyEqual const&>(o))
+        , WAllocator(static_cast<WAllocator const&>(o)) {
+        if (o.is_inline()) {
+            constructInline(o.inlineData(), o.mNumInline);
+        } else {
+            ::new (static_cast<void*>(mStorage)) map_type(o.map());
+            mNumInline = Hashed;
+        }
+    }
+
+    small_flat_map(small_flat_map&& o) noexcept(NothrowMove)
+        : WHash(std::move(static_cast<WHash&>(o)))
+        , WKeyEqual(std::move(static_cast<WKeyEqual&>(o)))
+        , WAllocator(std::move(static_cast<WAllocator&>(o))) {
+        moveFrom(o);
+    }
+
+    small_flat_map& operator=(small_flat_map const& o) {
+        if (&o != this) {
+            small_flat_map tmp(o);
+            *this = std::move(tmp);
+        }
+        return *this;
+    }
+
+    small_flat_map& operator=(small_flat_map&& o) noexcept(NothrowMove) {
+        if (&o != this) {
+            destroy();
+            moveFrom(o);
+            static_cast<WHash&>(*this) = std::move(static_cast<WHash&>(o));
+            static_cast<WKeyEqual&>(*this) = std::move(static_cast<WKeyEqual&>(o));
+            static_cast<WAllocator&>(*this) = std::move(static_cast<WAllocator&>(o));
+        }
+        return *this;
+    }
+
+    ~small_flat_map() {
+        destroy();
+    }
+
+    void swap(small_flat_map& o) noexcept(NothrowMove) {
+        small_flat_map tmp(std::move(o));
+        o = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+    allocator_type get_allocator() const noexcept {
+        return static_cast<WAllocator const&>(*this);
+    }
+
+    // True while the entries are stored inside the object.
+    ROBIN_HOOD(NODISCARD) bool is_inline() const noexcept {
+        return mNumInline != Hashed;
+    }
+
+    ROBIN_HOOD(NODISCARD) size_type size() const noexcept {
+        return is_inline() ? mNumInline : map().size();
+    }
+
+    ROBIN_HOOD(NODISCARD) bool empty() const noexcept {
+        return 0 == size();
+    }
+
+    ROBIN_HOOD(NODISCARD) size_type max_size() const noexcept {
+        return static_cast<size_type>(-1);
+    }
+
+    iterator begin() noexcept {
+        return is_inline() ? iterator(inlineData()) : iterator(map().begin());
+    }
+
+    const_iterator begin() const noexcept {
+        return cbegin();
+    }
+
+    const_iterator cbegin() const noexcept {
+        return is_inline() ? const_iterator(inlineData()) : const_iterator(map().cbegin());
+    }
+
+    iterator end() noexcept {
+        return is_inline() ? iterator(inlineData() + mNumInline) : iterator(map().end());
+    }
+
+    const_iterator end() const noexcept {
+        return cend();
+    }
+
+    const_iterator cend() const noexcept {
+        return is_inline() ? const_iterator(inlineData() + mNumInline)
+                           : const_iterator(map().cend());
+    }
+
+    iterator find(key_type const& key) {
+        if (is_inline()) {
+            return iterator(inlineData() + findInline(key));
+        }
+        return iterator(map().find(key));
+    }
+
+    const_iterator find(key_type const& key) const {
+        if (is_inline()) {
+            return const_iterator(inlineData() + findInline(key));
+        }
+        return const_iterator(map().find(key));
+    }
+
+    size_t count(key_type const& key) const {
+        return find(key) == end() ? 0 : 1;
+    }
+
+    bool contains(key_type const& key) const {
+        return 1U == count(key);
+    }
+
+    mapped_type& at(key_type const& key) {
+        auto it = find(key);
+        if (it == end()) {
+            detail::doThrow<std::out_of_range>("key not found");
+        }
+        return it->second;
+    }
+
+    mapped_type const& at(key_type const& key) const {
+        auto it = find(key);
+        if (it == end()) {
+            detail::doThrow<std::out_of_range>("key not found");
+        }
+        return it->second;
+    }
+
+    mapped_type& operator[](key_type const& key) {
+        return try_emplace(key).first->second;
+    }
+
+    mapped_type& operator[](key_type&& key) {
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(key_type const& key, Args&&... args) {
+        return tryEmplace(key, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args) {
+        return tryEmplace(std::move(key), std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    iterator try_emplace(const_iterator /*hint*/, key_type const& key, Args&&... args) {
+        return tryEmplace(key, std::forward<Args>(args)...).first;
+    }
+
+    template <typename... Args>
+    iterator try_emplace(const_iterator /*hint*/, key_type&& key, Args&&... args) {
+        return tryEmplace(std::move(key), std::forward<Args>(args)...).first;
+    }
+
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(key_type const& key, M&& obj) {
+        return insertOrAssign(key, std::forward<M>(obj));
+    }
+
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& obj) {
+        return insertOrAssign(std::move(key), std::forward<M>(obj));
+    }
+
+    template <typename M>
+    iterator insert_or_assign(const_iterator /*hint*/, key_type const& key, M&& obj) {
+        return insertOrAssign(key, std::forward<M>(obj)).first;
+    }
+
+    template <typename M>
+    iterator insert_or_assign(const_iterator /*hint*/, key_type&& key, M&& obj) {
+        return insertOrAssign(std::move(key), std::forward<M>(obj)).first;
+    }
+
+    std::pair<iterator, bool> insert(value_type const& keyval) {
+        return tryEmplace(keyval.first, keyval.second);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& keyval) {
+        return tryEmplace(std::move(keyval.first), std::move(keyval.second));
+    }
+
+    iterator insert(const_iterator /*hint*/, value_type const& keyval) {
+        return insert(keyval).first;
+    }
+
+    iterator insert(const_iterator /*hint*/, value_type&& keyval) {
+        return insert(std::move(keyval)).first;
+    }
+
+    template <typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        for (; first != last; ++first) {
+            insert(value_type(*first));
+        }
+    }
+
+    void insert(std::initializer_list<value_type> ilist) {
+        insert(ilist.begin(), ilist.end());
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        return insert(value_type(std::forward<Args>(args)...));
+    }
+
+    template <typename... Args>
+    iterator emplace_hint(const_iterator /*hint*/, Args&&... args) {
+        return emplace(std::forward<Args>(args)...).first;
+    }
+
+    // Erases the entry at pos. Inline, the last entry takes its place, so the returned iterator
+    // points to that one, and erasing in a loop visits each entry once.
+    iterator erase(const_iterator pos) {
+        if (!is_inline()) {
+            return iterator(map().erase(pos.mIt));
+        }
+        auto const idx = static_cast<size_t>(pos.mPtr - inlineData());
+        eraseInline(idx);
+        return iterator(inlineData() + idx);
+    }
+
+    iterator erase(iterator pos) {
+        return erase(const_iterator(pos));
+    }
+
+    size_t erase(key_type const& key) {
+        if (!is_inline()) {
+            return map().erase(key);
+        }
+        auto const idx = findInline(key);
+        if (idx == mNumInline) {
+            return 0;
+        }
+        eraseInline(idx);
+        return 1;
+    }
+
+    // Keeps only the entries for which pred(value) returns true, and returns the number of erased
+    // entries. See unordered_flat_map::retain().
+    template <typename Pred>
+    size_t retain(Pred pred) {
+        if (!is_inline()) {
+            return map().retain(pred);
+        }
+        auto const oldSize = mNumInline;
+        for (size_t idx = 0; idx < mNumInline;) {
+            if (pred(inlineData()[idx])) {
+                ++idx;
+            } else {
+                eraseInline(idx);
+            }
+        }
+        return oldSize - mNumInline;
+    }
+
+    // Switches to the hashed layout when c doesn't fit inline.
+    void reserve(size_t c) {
+        if (is_inline()) {
+            if (c <= N) {
+                return;
+            }
+            makeHashed(c);
+        }
+        map().reserve(c);
+    }
+
+    void rehash(size_t c) {
+        if (is_inline()) {
+            reserve(c);
+        } else {
+            map().rehash(c);
+        }
+    }
+
+    // Shrinks the hashed map, it doesn't go back to the inline layout.
+    void compact() {
+        if (!is_inline()) {
+            map().compact();
+        }
+    }
+
+    void clear() {
+        if (is_inline()) {
+            destroyInline();
+        } else {
+            map().clear();
+        }
+    }
+
+    bool operator==(small_flat_map const& other) const {
+        if (other.size() != size()) {
+            return false;
+        }
+        for (auto const& kv : other) {
+            auto it = find(kv.first);
+            if (it == end() || !(it->second == kv.second)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(small_flat_map const& other) const {
+        return !(*this == other);
+    }
+
+private:
+    static constexpr size_t Hashed = (std::numeric_limits<size_t>::max)();
+    static constexpr bool NothrowMove = std::is_nothrow_move_constructible<value_type>::value;
+    static constexpr size_t InlineBytes = sizeof(value_type) * N;
+    static constexpr size_t StorageBytes =
+        InlineBytes > sizeof(map_type) ? InlineBytes : sizeof(map_type);
+    static constexpr size_t StorageAlign = alignof(value_type) > alignof(map_type)
+                                               ? alignof(value_type)
+                                               : alignof(map_type);
+
+    value_type* inlineData() noexcept {
+        return detail::reinterpret_cast_no_cast_align_warning<value_type*>(mStorage);
+    }
+
+    value_type const* inlineData() const noexcept {
+        return detail::reinterpret_cast_no_cast_align_warning<value_type const*>(mStorage);
+    }
+
+    map_type& map() noexcept {
+        return *detail::reinterpret_cast_no_cast_align_warning<map_type*>(mStorage);
+    }
+
+    map_type const& map() const noexcept {
+        return *detail::reinterpret_cast_no_cast_align_warning<map_type const*>(mStorage);
+    }
+
+    // index of key in the inline entries, or mNumInline when it's not there.
+    template <typename K>
+    size_t findInline(K const& key) const {
+        auto const* data = inlineData();
+        size_t idx = 0;
+        while (idx != mNumInline && !WKeyEqual::operator()(data[idx].first, key)) {
+            ++idx;
+        }
+        return idx;
+    }
+
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> tryEmplace(K&& key, Args&&... args) {
+        if (is_inline()) {
+            auto const idx = findInline(key);
+            if (idx != mNumInline) {
+                return std::make_pair(iterator(inlineData() + idx), false);
+            }
+            if (mNumInline < N) {
+                ::new (static_cast<void*>(inlineData() + idx)) value_type(
+                    std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                    std::forward_as_tuple(std::forward<Args>(args)...));
+                ++mNumInline;
+                return std::make_pair(iterator(inlineData() + idx), true);
+            }
+            makeHashed(N + 1);
+        }
+        auto result = map().try_emplace(std::forward<K>(key), std::forward<Args>(args)...);
+        return std::make_pair(iterator(result.first), result.second);
+    }
+
+    template <typename K, typename M>
+    std::pair<iterator, bool> insertOrAssign(K&& key, M&& obj) {
+        auto result = tryEmplace(std::forward<K>(key), std::forward<M>(obj));
+        if (!result.second) {
+            result.first->second = std::forward<M>(obj);
+        }
+        return result;
+    }
+
+    // unordered, so the last entry can simply take the erased one's place
+    void eraseInline(size_t idx) {
+        auto* data = inlineData();
+        --mNumInline;
+        if (idx != mNumInline) {
+            data[idx] = std::move(data[mNumInline]);
+        }
+        data[mNumInline].~value_type();
+    }
+
+    // moves the inline entries into a map that has room for c entries.
+    void makeHashed(size_t c) {
+        map_type m(0, static_cast<WHash const&>(*this), static_cast<WKeyEqual const&>(*this),
+                   get_allocator());
+        m.reserve(c);
+        auto* data = inlineData();
+        for (size_t i = 0; i < mNumInline; ++i) {
+            m.insert(std::move(data[i]));
+        }
+        destroyInline();
+        ::new (static_cast<void*>(mStorage)) map_type(std::move(m));
+        mNumInline = Hashed;
+    }
+
+    void destroyInline() noexcept {
+        auto* data = inlineData();
+        for (size_t i = 0; i < mNumInline; ++i) {
+            data[i].~value_type();
+        }
+        mNumInline = 0;
+    }
+
+    void destroy() noexcept {
+        if (is_inline()) {
+            destroyInline();
+        } else {
+            map().~map_type();
+            mNumInline = 0;
+        }
+    }
+
+    // constructs n inline entries from *src, src[1], ... . We must not hold any entries. When a
+    // constructor throws, the entries constructed so far are destroyed again.
+    template <typename Iter>
+    void constructInline(Iter src, size_t n) {
+#if ROBIN_HOOD(HAS_EXCEPTIONS)
+        try {
+#endif
+            // mNumInline counts the constructed entries, so destroyInline() finds them
+            for (; mNumInline < n; ++mNumInline, ++src) {
+                ::new (static_cast<void*>(inlineData() + mNumInline)) value_type(*src);
+            }
+#if ROBIN_HOOD(HAS_EXCEPTIONS)
+        } catch (...) {
+            destroyInline();
+            throw;
+        }
+#endif
+    }
+
+    // takes over o's entries, o is left empty. We must not hold any entries. When moving an entry
+    // throws, we stay empty and o keeps its entries.
+    void moveFrom(small_flat_map& o) noexcept(NothrowMove) {
+        if (o.is_inline()) {
+            constructInline(std::make_move_iterator(o.inlineData()), o.mNumInline);
+            o.destroyInline();
+        } else {
+            ::new (static_cast<void*>(mStorage)) map_type(std::move(o.map()));
+            mNumInline = Hashed;
+        }
+    }
+
+    alignas(StorageAlign) unsigned char mStorage[StorageBytes]{};
+    size_t mNumInline = 0;
+};
+
+// Erases all entries for which pred(value) returns true, see small_flat_map::retain().
+template <typename Key, typename T, size_t N, typename Hash, typename KeyEqual,
+          size_t MaxLoadFactor100, size_t GrowthFactor100, typename Allocator, typename Pred>
+size_t erase_if(
+    small_flat_map<Key, T, N, Hash, KeyEqual, MaxLoadFactor100, GrowthFactor100, Allocator>& map,
+    Pred pred) {
+    using Map =
+        small_flat_map<Key, T, N, Hash, KeyEqual, MaxLoadFactor100, GrowthFactor100, Allocator>;
+    return map.retain([&pred](typename Map::value_type& v) { return !pred(v); });
+}
 
 } // namespace robin_hood
 
@@ -0,0 +1,548 @@
+//                 ______  _____                 ______                _________
+//  ______________ ___  /_ ___(_)_______         ___  /_ ______ ______ ______  /
+//  __  ___/_  __ \__  __ \__  / __  __ \        __  __ \_  __ \_  __ \_  __  /
+//  _  /    / /_/ /_  /_/ /_  /  _  / / /        _  / / // /_/ // /_/ // /_/ /
+//  /_/     \____/ /_.___/ /_/   /_/ /_/ ________/_/ /_/ \____/ \____/ \__,_/
+//                                      _/_____/
+//
+// Multithreading additions to robin_hood.h. They need <thread>, <mutex> and <atomic>, so they are
+// only available when this header is included.
+// https://github.com/martinus/robin-hood-hashing
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2018-2021 Martin Ankerl <http://martin.ankerl.com>
+
+#ifndef ROBIN_HOOD_CONCURRENT_H_INCLUDED
+#define ROBIN_HOOD_CONCURRENT_H_INCLUDED
+
+#include "robin_hood.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace robin_hood {
+
+// A map that can be used from several threads at once. Elements are spread over NumShards
+// independent unordered_flat_maps by the upper bits of their hash, each with its own mutex, so
+// threads only contend when they happen to access the same shard.
+//
+// Iterators and references into the map would be invalidated by other threads, so there are none.
+// Instead, visit() and insert_or_visit() call a function with the element while its shard is
+// locked. That function must not access the map itself.
+//
+// All shards allocate from copies of the same allocator, which therefore has to be thread safe.
+template <typename Key, typename T, size_t NumShards = 64, typename Hash = hash<Key>,
+          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80,
+          typename Allocator = malloc_allocator<char>>
+class concurrent_flat_map {
+    static_assert(NumShards > 0, "NumShards must be at least 1");
+
+public:
+    using map_type = unordered_flat_map<Key, T, Hash, KeyEqual, MaxLoadFactor100, 200, Allocator>;
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = typename map_type::value_type;
+    using size_type = size_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using allocator_type = Allocator;
+
+    concurrent_flat_map() = default;
+    explicit concurrent_flat_map(Allocator const& alloc)
+        : concurrent_flat_map(alloc, ROBIN_HOOD_STD::make_index_sequence<NumShards>()) {}
+    concurrent_flat_map(concurrent_flat_map const&) = delete;
+    concurrent_flat_map& operator=(concurrent_flat_map const&) = delete;
+
+    // Inserts a copy of value when its key isn't present yet. Returns true when inserted.
+    bool insert(value_type const& value) {
+        return try_emplace(value.first, value.second);
+    }
+
+    template <typename... Args>
+    bool try_emplace(key_type const& key, Args&&... args) {
+        auto const h = hash_for(key);
+        auto& shard = shardFor(h);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.map.try_emplace_with_hash(key, h, std::forward<Args>(args)...).second;
+    }
+
+    // Returns true when inserted, false when an existing value was assigned.
+    template <typename Mapped>
+    bool insert_or_assign(key_type const& key, Mapped&& obj) {
+        auto const h = hash_for(key);
+        auto& shard = shardFor(h);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.map.try_emplace_with_hash(key, h, std::forward<Mapped>(obj));
+        if (!it.second) {
+            it.first->second = std::forward<Mapped>(obj);
+        }
+        return it.second;
+    }
+
+    // Inserts value when its key isn't present yet, otherwise calls f(existing value).
+    // Returns true when inserted.
+    template <typename F>
+    bool insert_or_visit(value_type const& value, F f) {
+        auto const h = hash_for(value.first);
+        auto& shard = shardFor(h);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.map.try_emplace_with_hash(value.first, h, value.second);
+        if (!it.second) {
+            f(*it.first);
+        }
+        return it.second;
+    }
+
+    // Calls f(value) for the element with the given key, and returns the number of visited
+    // elements (0 or 1).
+    template <typename F>
+    size_t visit(key_type const& key, F f) {
+        auto const h = hash_for(key);
+        auto& shard = shardFor(h);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.map.find_with_hash(key, h);
+        if (it == shard.map.end()) {
+            return 0;
+        }
+        f(*it);
+        return 1;
+    }
+
+    template <typename F>
+    size_t visit(key_type const& key, F f) const {
+        auto const h = hash_for(key);
+        auto const& shard = shardFor(h);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.map.find_with_hash(key, h);
+        if (it == shard.map.end()) {
+            return 0;
+        }
+        f(*it);
+        return 1;
+    }
+
+    // Calls f(value) for all elements. Shards are locked one after the other, so this is no
+    // snapshot when other threads modify the map at the same time.
+    template <typename F>
+    void visit_all(F f) {
+        for (auto& shard : mShards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (auto& value : shard.map) {
+                f(value);
+            }
+        }
+    }
+
+    template <typename F>
+    void visit_all(F f) const {
+        for (auto const& shard : mShards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (auto const& value : shard.map) {
+                f(value);
+            }
+        }
+    }
+
+    size_t erase(key_type const& key) {
+        auto const h = hash_for(key);
+        auto& shard = shardFor(h);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.map.erase_with_hash(key, h);
+    }
+
+    // Erases all elements for which pred(value) returns true, see robin_hood::erase_if().
+    template <typename Pred>
+    size_t erase_if(Pred pred) {
+        size_t numErased = 0;
+        for (auto& shard : mShards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            numErased += robin_hood::erase_if(shard.map, pred);
+        }
+        return numErased;
+    }
+
+    size_t count(key_type const& key) const {
+        return visit(key, [](value_type const& /*unused*/) {});
+    }
+
+    bool contains(key_type const& key) const {
+        return 1U == count(key);
+    }
+
+    // Sum of all shard's sizes. Only exact when no other thread modifies the map.
+    size_t size() const {
+        size_t s = 0;
+        for (auto const& shard : mShards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            s += shard.map.size();
+        }
+        return s;
+    }
+
+    bool empty() const {
+        return 0U == size();
+    }
+
+    void clear() {
+        for (auto& shard : mShards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.map.clear();
+        }
+    }
+
+    // Reserves room for about c elements, spread evenly over all shards.
+    void reserve(size_t c) {
+        // some headroom because the elements are not perfectly evenly distributed
+        auto const perShard = c / NumShards + c / NumShards / 8 + 1;
+        for (auto& shard : mShards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.map.reserve(perShard);
+        }
+    }
+
+    // Hashing doesn't touch a shard's data, so no lock is needed.
+    size_t hash_for(key_type const& key) const {
+        return mShards.front().map.hash_for(key);
+    }
+
+    allocator_type get_allocator() const noexcept {
+        return mShards.front().map.get_allocator();
+    }
+
+private:
+    // Each shard starts on its own cache line, so that threads working on different shards don't
+    // slow each other down with false sharing.
+    struct alignas(64) Shard {
+        Shard() = default;
+        Shard(Allocator const& alloc) // NOLINT(google-explicit-constructor)
+            : map(alloc) {}
+
+        mutable std::mutex mutex{};
+        map_type map{};
+    };
+
+    // Shards can't be moved because of the mutex, so each one is list-initialized in place.
+    template <size_t... Is>
+    concurrent_flat_map(Allocator const& alloc, ROBIN_HOOD_STD::index_sequence<Is...> /*unused*/)
+        : mShards{{{((void)Is, alloc)}...}} {}
+
+    // The shard maps mix the hash the same way, and use the lowest bits of the result for the info
+    // and the bucket. The shard is selected by the highest bits, so the keys of a shard are still
+    // spread over all of its buckets. Works with any number of shards.
+    static size_t shardIdx(size_t h) noexcept {
+        auto x = static_cast<uint64_t>(h) * UINT64_C(0xc4ceb9fe1a85ec53);
+        x ^= x >> 33U;
+        return static_cast<size_t>(detail::mulhi(x, NumShards));
+    }
+
+    Shard& shardFor(size_t h) noexcept {
+        return mShards[shardIdx(h)];
+    }
+
+    Shard const& shardFor(size_t h) const noexcept {
+        return mShards[shardIdx(h)];
+    }
+
+    std::array<Shard, NumShards> mShards{};
+};
+
+// Read-copy-update map for data that is read by many threads but rarely changed. Readers get a
+// pointer to an immutable snapshot without any locks: a read is one atomic store to announce the
+// reader's epoch, one atomic load of the snapshot pointer, and one atomic store when done. Writers
+// copy the current snapshot (a memcpy for trivially copyable entries), change the copy, and publish
+// it. Old snapshots are freed as soon as no reader that might still see them is active.
+//
+// Each reading thread needs its own reader, see make_reader(). Readers must be destroyed before
+// the map.
+template <typename Key, typename T, typename Hash = hash<Key>,
+          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80>
+class rcu_flat_map {
+    // announced epoch of a reader slot that's not reading
+    static constexpr uint64_t Idle = 0;
+
+    // Padded so that readers only ever write to their own cache line. The slots are allocated with
+    // new[], which doesn't respect alignas before C++17.
+    struct Slot {
+        std::atomic<uint64_t> epoch{Idle};
+        std::atomic<bool> isUsed{false};
+        char padding[64]{};
+    };
+
+public:
+    using map_type = unordered_flat_map<Key, T, Hash, KeyEqual, MaxLoadFactor100>;
+
+    class reader {
+    public:
+        reader(reader&& o) noexcept
+            : mMap(o.mMap)
+            , mSlot(o.mSlot) {
+            o.mSlot = nullptr;
+        }
+        reader(reader const&) = delete;
+        reader& operator=(reader const&) = delete;
+        reader& operator=(reader&&) = delete;
+
+        ~reader() {
+            if (mSlot != nullptr) {
+                mSlot->isUsed.store(false);
+            }
+        }
+
+        // Calls f(snapshot) with the current snapshot and returns its result. The snapshot stays
+        // valid until f returns, don't keep references to it. Calls must not be nested.
+        template <typename F>
+        auto read(F f) const -> decltype(f(std::declval<map_type const&>())) {
+            ReadGuard guard(*mSlot, mMap->mEpoch.load());
+            return f(*mMap->mCurrent.load());
+        }
+
+    private:
+        friend class rcu_flat_map;
+
+        struct ReadGuard {
+            Slot& slot;
+
+            ReadGuard(Slot& s, uint64_t epoch) noexcept
+                : slot(s) {
+                slot.epoch.store(epoch);
+            }
+            ReadGuard(ReadGuard const&) = delete;
+            ReadGuard& operator=(ReadGuard const&) = delete;
+            ~ReadGuard() {
+                slot.epoch.store(Idle);
+            }
+        };
+
+        reader(rcu_flat_map const* map, Slot* slot) noexcept
+            : mMap(map)
+            , mSlot(slot) {}
+
+        rcu_flat_map const* mMap;
+        Slot* mSlot;
+    };
+
+    // Up to maxReaders readers can exist at the same time.
+    explicit rcu_flat_map(size_t maxReaders = 128)
+        : mSlots(new Slot[maxReaders])
+        , mNumSlots(maxReaders)
+        , mCurrent(new map_type()) {}
+
+    rcu_flat_map(rcu_flat_map const&) = delete;
+    rcu_flat_map& operator=(rcu_flat_map const&) = delete;
+
+    ~rcu_flat_map() {
+        delete mCurrent.load();
+    }
+
+    // Thread safe. Throws std::overflow_error when all maxReaders readers are in use.
+    reader make_reader() const {
+        for (size_t i = 0; i < mNumSlots; ++i) {
+            auto& slot = mSlots[i];
+            bool expected = false;
+            if (!slot.isUsed.load() && slot.isUsed.compare_exchange_strong(expected, true)) {
+                return reader(this, &slot);
+            }
+        }
+        detail::doThrow<std::overflow_error>("all readers are in use");
+        return reader(this, nullptr);
+    }
+
+    // Copies the current snapshot, calls f(copy) to change it, and publishes the copy. Use a
+    // single update for several changes, each update copies the whole map. Updates are serialized,
+    // readers never wait for them.
+    template <typename F>
+    void update(F f) {
+        std::lock_guard<std::mutex> lock(mWriteMutex);
+        std::unique_ptr<map_type> next(new map_type(*mCurrent.load()));
+        f(*next);
+        // a pending incremental rehash would modify the snapshot while it's read
+        next->finish_rehash();
+
+        std::unique_ptr<map_type> old(mCurrent.exchange(next.release()));
+        // readers that announce this epoch or a later one can't see the old snapshot
+        auto const epoch = ++mEpoch;
+        mRetired.emplace_back(epoch, std::move(old));
+        reclaimRetired();
+    }
+
+    // Frees old snapshots that are no longer read. update() does this too, so this is only needed
+    // when memory should be freed before the next update. Returns the number of old snapshots that
+    // are still in use.
+    size_t reclaim() {
+        std::lock_guard<std::mutex> lock(mWriteMutex);
+        reclaimRetired();
+        return mRetired.size();
+    }
+
+private:
+    void reclaimRetired() {
+        // oldest epoch that an active reader has announced
+        auto minEpoch = (std::numeric_limits<uint64_t>::max)();
+        for (size_t i = 0; i < mNumSlots; ++i) {
+            auto const e = mSlots[i].epoch.load();
+            if (e != Idle && e < minEpoch) {
+                minEpoch = e;
+            }
+        }
+        mRetired.erase(std::remove_if(mRetired.begin(), mRetired.end(),
+                                      [minEpoch](RetiredMap const& r) {
+                                          return r.first <= minEpoch;
+                                      }),
+                       mRetired.end());
+    }
+
+    using RetiredMap = std::pair<uint64_t, std::unique_ptr<map_type>>;
+
+    std::unique_ptr<Slot[]> mSlots;
+    size_t const mNumSlots;
+    std::atomic<map_type*> mCurrent;
+    std::atomic<uint64_t> mEpoch{1};
+    std::mutex mWriteMutex{};
+    std::vector<RetiredMap> mRetired{};
+};
+
+namespace detail {
+
+// Implementation of build_parallel(). A friend of Table, so it can fill the table's regions.
+struct ParallelBuild {
+    // Runs op(0) ... op(numThreads - 1), op(0) in the calling thread.
+    template <typename Op>
+    static void run(size_t numThreads, Op const& op) {
+        std::vector<std::thread> threads;
+        threads.reserve(numThreads - 1);
+        for (size_t t = 1; t < numThreads; ++t) {
+            threads.emplace_back([&op, t] { op(t); });
+        }
+        op(0);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    template <typename Map, typename Iter>
+    static void build(Map& map, Iter first, Iter last, size_t numThreads) {
+        ROBIN_HOOD_TRACE(&map)
+        static constexpr size_t MinElementsPerThread = 1U << 14U;
+
+        map.finish_rehash();
+        auto const numInput = static_cast<size_t>(std::distance(first, last));
+        if (0 == numInput) {
+            return;
+        }
+        map.reserve(map.mNumElements + numInput);
+
+        if (0 == numThreads) {
+            numThreads = std::thread::hardware_concurrency();
+        }
+        numThreads = (std::max)(
+            static_cast<size_t>(1), (std::min)(numThreads, numInput / MinElementsPerThread));
+        auto const numRegions = Map::is_flat ? numThreads : 1;
+        auto const numBuckets = map.mMask + 1;
+        auto const regionSize = (numBuckets + numRegions - 1) / numRegions;
+        auto const chunkSize = (numInput + numThreads - 1) / numThreads;
+
+        auto chunkBegin = [&](size_t t) {
+            auto it = first;
+            std::advance(it, static_cast<typename std::iterator_traits<Iter>::difference_type>(
+                                 (std::min)(t * chunkSize, numInput)));
+            return it;
+        };
+        auto regionOf = [&](size_t h) {
+            size_t idx{};
+            typename Map::InfoType info{};
+            map.hashToIdx(h, &idx, &info);
+            return idx / regionSize;
+        };
+
+        // hash everything and count the elements per chunk and region
+        std::vector<size_t> hashes(numInput);
+        std::vector<size_t> offsets(numThreads * numRegions);
+        run(numThreads, [&](size_t t) {
+            auto it = chunkBegin(t);
+            auto* counts = offsets.data() + t * numRegions;
+            for (size_t i = t * chunkSize, end = (std::min)(i + chunkSize, numInput); i < end;
+                 ++i, ++it) {
+                hashes[i] = map.hash_for(map.getFirstConst(*it));
+                ++counts[regionOf(hashes[i])];
+            }
+        });
+
+        // exclusive prefix sum, ordered by region then chunk. regionBegin has one extra entry.
+        std::vector<size_t> regionBegin(numRegions + 1);
+        size_t sum = 0;
+        for (size_t r = 0; r < numRegions; ++r) {
+            regionBegin[r] = sum;
+            for (size_t t = 0; t < numThreads; ++t) {
+                auto const count = offsets[t * numRegions + r];
+                offsets[t * numRegions + r] = sum;
+                sum += count;
+            }
+        }
+        regionBegin[numRegions] = sum;
+
+        // partition by region
+        // hash and element
+        using Entry = std::pair<size_t, Iter>;
+        std::vector<Entry> entries(numInput);
+        run(numThreads, [&](size_t t) {
+            auto it = chunkBegin(t);
+            auto* pos = offsets.data() + t * numRegions;
+            for (size_t i = t * chunkSize, end = (std::min)(i + chunkSize, numInput); i < end;
+                 ++i, ++it) {
+                entries[pos[regionOf(hashes[i])]++] = Entry(hashes[i], it);
+            }
+        });
+        std::vector<size_t>().swap(hashes);
+
+        // fill each region, the last one includes the overflow buffer
+        auto const numElementsWithBuffer = map.calcNumElementsWithBuffer(numBuckets);
+        std::vector<std::vector<Entry>> deferred(numRegions);
+        std::vector<size_t> numInserted(numRegions);
+        run(numRegions, [&](size_t r) {
+            auto const regionEnd =
+                r + 1 == numRegions ? numElementsWithBuffer : (r + 1) * regionSize;
+            size_t n = 0;
+            for (size_t i = regionBegin[r]; i < regionBegin[r + 1]; ++i) {
+                if (!map.insertInRegion(*entries[i].second, entries[i].first, regionEnd, &n)) {
+                    deferred[r].push_back(entries[i]);
+                }
+            }
+            numInserted[r] = n;
+        });
+        for (auto n : numInserted) {
+            map.mNumElements += n;
+        }
+
+        for (auto const& d : deferred) {
+            for (auto const& e : d) {
+                map.insertWithHash(*e.second, e.first);
+            }
+        }
+    }
+};
+
+} // namespace detail
+
+// Bulk insert of [first, last) into map for large inputs, e.g. when building a map at startup.
+// Keys are hashed by numThreads threads (0 uses all hardware threads), then partitioned by bucket
+// into one region of the table per thread. Each thread fills its own region; only elements whose
+// probe sequence would cross into the next region are inserted afterwards by the calling thread.
+// Node maps allocate from a pool that's not thread safe, so they only hash in parallel.
+//
+// Hash, key_equal and the element's constructor are called concurrently and must not throw.
+// When the range contains duplicate keys, it is unspecified which one is inserted.
+template <typename Map, typename Iter>
+void build_parallel(Map& map, Iter first, Iter last, size_t numThreads = 0) {
+    detail::ParallelBuild::build(map, first, last, numThreads);
+}
+
+} // namespace robin_hood
+
+#endif
@@ -0,0 +1,532 @@
+//                 ______  _____                 ______                _________
+//  ______________ ___  /_ ___(_)_______         ___  /_ ______ ______ ______  /
+//  __  ___/_  __ \__  __ \__  / __  __ \        __  __ \_  __ \_  __ \_  __  /
+//  _  /    / /_/ /_  /_/ /_  /  _  / / /        _  / / // /_/ // /_/ // /_/ /
+//  /_/     \____/ /_.___/ /_/   /_/ /_/ ________/_/ /_/ \____/ \____/ \__,_/
+//                                      _/_____/
+//
+// Operating system specific additions to robin_hood.h: memory mapped images, huge pages and NUMA
+// placement. They need POSIX and Linux system headers, so they are only available when this header
+// is included.
+// https://github.com/martinus/robin-hood-hashing
+//
+// Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2018-2021 Martin Ankerl <http://martin.ankerl.com>
+
+#ifndef ROBIN_HOOD_OS_H_INCLUDED
+#define ROBIN_HOOD_OS_H_INCLUDED
+
+#include "robin_hood.h"
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+// memory mapped files, see mapped_flat_map
+#if defined(__unix__) || defined(__APPLE__)
+#    define ROBIN_HOOD_PRIVATE_DEFINITION_HAS_MMAP() 1
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#else
+#    define ROBIN_HOOD_PRIVATE_DEFINITION_HAS_MMAP() 0
+#endif
+
+// NUMA placement with the raw mbind/get_mempolicy/getcpu syscalls, see numa_allocator
+#if defined(__linux__)
+#    include <sys/syscall.h>
+#endif
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_get_mempolicy) && defined(SYS_getcpu)
+#    define ROBIN_HOOD_PRIVATE_DEFINITION_HAS_NUMA() 1
+#else
+#    define ROBIN_HOOD_PRIVATE_DEFINITION_HAS_NUMA() 0
+#endif
+
+namespace robin_hood {
+
+#if ROBIN_HOOD(HAS_MMAP)
+
+// Allocator for very large maps. Allocations of at least ThresholdBytes are mapped directly from
+// the OS, aligned to 2MB and backed by huge pages where possible: explicit ones (MAP_HUGETLB) when
+// the system has some reserved, otherwise transparent huge pages (MADV_HUGEPAGE). This greatly
+// reduces TLB misses of random lookups. With Prefault, all pages are faulted in right away, e.g.
+// in reserve(), instead of at the first inserts. Smaller allocations use std::malloc.
+template <typename T, size_t ThresholdBytes = size_t(2) * 1024 * 1024, bool Prefault = false>
+struct huge_page_allocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = huge_page_allocator<U, ThresholdBytes, Prefault>;
+    };
+
+    static constexpr size_t HugePageSize = size_t(2) * 1024 * 1024;
+
+    huge_page_allocator() noexcept = default;
+
+    template <typename U>
+    huge_page_allocator(
+        huge_page_allocator<U, ThresholdBytes, Prefault> const& /*unused*/) noexcept {}
+
+    T* allocate(size_t n) {
+        auto const numBytes = n * sizeof(T);
+        if (numBytes < ThresholdBytes) {
+            return static_cast<T*>(detail::assertNotNull<std::bad_alloc>(std::malloc(numBytes)));
+        }
+        return static_cast<T*>(mapHuge(roundUp(numBytes)));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+        auto const numBytes = n * sizeof(T);
+        if (numBytes < ThresholdBytes) {
+            std::free(ptr);
+        } else {
+            ::munmap(ptr, roundUp(numBytes));
+        }
+    }
+
+private:
+    static size_t roundUp(size_t numBytes) noexcept {
+        return (numBytes + HugePageSize - 1) / HugePageSize * HugePageSize;
+    }
+
+    static void* mapHuge(size_t size) {
+#    if defined(MAP_HUGETLB)
+        auto const populate = Prefault ? MAP_POPULATE : 0;
+        auto* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | populate, -1, 0);
+        if (MAP_FAILED != p) {
+            return p;
+        }
+#    endif
+        // over-allocate so a 2MB aligned range fits, and give the rest back
+        auto* raw = ::mmap(nullptr, size + HugePageSize, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == raw) {
+            detail::doThrow<std::bad_alloc>();
+        }
+        auto* const begin = static_cast<char*>(raw);
+        auto const misalignment = reinterpret_cast<uintptr_t>(begin) % HugePageSize;
+        auto const head = misalignment == 0 ? size_t(0) : HugePageSize - misalignment;
+        if (head != 0) {
+            ::munmap(begin, head);
+        }
+        ::munmap(begin + head + size, HugePageSize - head);
+        auto* const data = begin + head;
+#    if defined(MADV_HUGEPAGE)
+        ::madvise(data, size, MADV_HUGEPAGE);
+#    endif
+        if (Prefault) {
+            // after madvise, so the faults already get huge pages
+            for (size_t i = 0; i < size; i += 4096) {
+                *static_cast<char volatile*>(data + i) = 0;
+            }
+        }
+        return data;
+    }
+};
+
+template <typename T, typename U, size_t ThresholdBytes, bool Prefault>
+bool operator==(huge_page_allocator<T, ThresholdBytes, Prefault> const& /*unused*/,
+                huge_page_allocator<U, ThresholdBytes, Prefault> const& /*unused*/) noexcept {
+    return true;
+}
+
+template <typename T, typename U, size_t ThresholdBytes, bool Prefault>
+bool operator!=(huge_page_allocator<T, ThresholdBytes, Prefault> const& /*unused*/,
+                huge_page_allocator<U, ThresholdBytes, Prefault> const& /*unused*/) noexcept {
+    return false;
+}
+
+#endif
+
+namespace detail {
+namespace numa {
+
+#if ROBIN_HOOD(HAS_NUMA)
+
+// from linux/mempolicy.h, so libnuma's headers are not needed
+static constexpr int MpolBind = 2;
+static constexpr int MpolInterleave = 3;
+static constexpr unsigned long MpolFMemsAllowed = 1U << 2U;
+static constexpr size_t MaxNodes = 1024;
+using NodeMask = std::array<unsigned long, MaxNodes / (8 * sizeof(unsigned long))>;
+
+// Nodes this process may allocate memory on. Empty when that can't be determined.
+inline NodeMask const& allowedNodes() noexcept {
+    static NodeMask const mask = [] {
+        NodeMask m{};
+        int mode = 0;
+        if (0 != ::syscall(SYS_get_mempolicy, &mode, m.data(), MaxNodes, nullptr,
+                           MpolFMemsAllowed)) {
+            m.fill(0);
+        }
+        return m;
+    }();
+    return mask;
+}
+
+// Highest allowed node + 1, at least 1.
+inline size_t numNodes() noexcept {
+    static constexpr size_t BitsPerWord = 8 * sizeof(unsigned long);
+    auto const& mask = allowedNodes();
+    size_t n = 1;
+    for (size_t i = 0; i < MaxNodes; ++i) {
+        if (0 != ((mask[i / BitsPerWord] >> (i % BitsPerWord)) & 1U)) {
+            n = i + 1;
+        }
+    }
+    return n;
+}
+
+inline size_t currentNode() noexcept {
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (0 != ::syscall(SYS_getcpu, &cpu, &node, nullptr)) {
+        return 0;
+    }
+    return node;
+}
+
+// Interleaves [ptr, ptr + numBytes) over all allowed nodes when node is negative, otherwise
+// binds it to node. Pages must not be touched yet. Failures are ignored, e.g. a node that
+// doesn't exist: the memory then simply has the default policy.
+inline void place(void* ptr, size_t numBytes, int node) noexcept {
+    NodeMask mask{};
+    int mode = MpolInterleave;
+    if (node < 0) {
+        mask = allowedNodes();
+    } else if (static_cast<size_t>(node) < MaxNodes) {
+        auto const n = static_cast<size_t>(node);
+        mask[n / (8 * sizeof(unsigned long))] = 1UL << (n % (8 * sizeof(unsigned long)));
+        mode = MpolBind;
+    }
+    ::syscall(SYS_mbind, ptr, numBytes, mode, mask.data(), MaxNodes + 1, 0U);
+}
+
+#else
+
+inline size_t numNodes() noexcept {
+    return 1;
+}
+
+inline size_t currentNode() noexcept {
+    return 0;
+}
+
+#endif
+
+} // namespace numa
+} // namespace detail
+
+// Allocator that places large allocations on NUMA nodes: interleaved over all nodes, so all
+// threads see the same average latency, or bound to a single node. Allocations smaller than
+// ThresholdBytes (e.g. the first node pool blocks) use std::malloc and the default first touch
+// policy. Where NUMA is not supported this is the same as malloc_allocator.
+template <typename T, size_t ThresholdBytes = size_t(64) * 1024>
+class numa_allocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = numa_allocator<U, ThresholdBytes>;
+    };
+
+    // interleaved over all nodes
+    numa_allocator() noexcept = default;
+
+    template <typename U>
+    numa_allocator(numa_allocator<U, ThresholdBytes> const& o) noexcept
+        : mNode(o.node()) {}
+
+    static numa_allocator interleaved() noexcept {
+        return numa_allocator();
+    }
+
+    static numa_allocator bound_to(size_t node) noexcept {
+        numa_allocator a;
+        a.mNode = static_cast<int>(node);
+        return a;
+    }
+
+    // the node all memory is bound to, or -1 when interleaved.
+    ROBIN_HOOD(NODISCARD) int node() const noexcept {
+        return mNode;
+    }
+
+    T* allocate(size_t n) {
+        auto const numBytes = n * sizeof(T);
+#if ROBIN_HOOD(HAS_NUMA)
+        if (numBytes >= ThresholdBytes) {
+            // mbind needs page aligned memory that nobody else uses
+            auto* p = ::mmap(nullptr, numBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                             -1, 0);
+            if (MAP_FAILED == p) {
+                detail::doThrow<std::bad_alloc>();
+            }
+            detail::numa::place(p, numBytes, mNode);
+            return static_cast<T*>(p);
+        }
+#endif
+        return static_cast<T*>(detail::assertNotNull<std::bad_alloc>(std::malloc(numBytes)));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+#if ROBIN_HOOD(HAS_NUMA)
+        if (n * sizeof(T) >= ThresholdBytes) {
+            ::munmap(ptr, n * sizeof(T));
+            return;
+        }
+#else
+        (void)n;
+#endif
+        std::free(ptr);
+    }
+
+private:
+    int mNode = -1;
+};
+
+template <typename T, typename U, size_t ThresholdBytes>
+bool operator==(numa_allocator<T, ThresholdBytes> const& a,
+                numa_allocator<U, ThresholdBytes> const& b) noexcept {
+    return a.node() == b.node();
+}
+
+template <typename T, typename U, size_t ThresholdBytes>
+bool operator!=(numa_allocator<T, ThresholdBytes> const& a,
+                numa_allocator<U, ThresholdBytes> const& b) noexcept {
+    return !(a == b);
+}
+
+// Number of NUMA nodes, and the node of the CPU the calling thread runs on. 1 and 0 where NUMA is
+// not supported.
+inline size_t numa_num_nodes() noexcept {
+    return detail::numa::numNodes();
+}
+
+inline size_t numa_current_node() noexcept {
+    return detail::numa::currentNode();
+}
+
+// Read-only flat map with one copy per NUMA node, each bound to its node with numa_allocator.
+// Lookups use the copy on the node of the calling thread, so no reader pays remote memory latency
+// no matter which thread built the map. To change the content, build a new one.
+//
+// The node of a thread is determined at its first lookup and then cached, so readers should be
+// pinned to a node.
+template <typename Key, typename T, typename Hash = hash<Key>,
+          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80>
+class replicated_flat_map {
+public:
+    using map_type = unordered_flat_map<Key, T, Hash, KeyEqual, MaxLoadFactor100, 200,
+                                        numa_allocator<char>>;
+    using key_type = typename map_type::key_type;
+    using mapped_type = typename map_type::mapped_type;
+    using value_type = typename map_type::value_type;
+    using size_type = typename map_type::size_type;
+    using const_iterator = typename map_type::const_iterator;
+    using iterator = const_iterator;
+
+    // Copies all entries of source, a map or any range of value_type. numReplicas 0 creates one
+    // replica per node; more replicas than nodes are possible, e.g. to emulate a topology.
+    template <typename Map>
+    explicit replicated_flat_map(Map const& source, size_t numReplicas = 0, Hash const& h = Hash{},
+                                 KeyEqual const& equal = KeyEqual{}) {
+        if (0 == numReplicas) {
+            numReplicas = numa_num_nodes();
+        }
+        mReplicas.reserve(numReplicas);
+        for (size_t node = 0; node < numReplicas; ++node) {
+            mReplicas.emplace_back(0, h, equal, numa_allocator<char>::bound_to(node));
+            if (0 == node) {
+                mReplicas[0].insert(source.begin(), source.end());
+            } else {
+                // copy assignment keeps the replica's allocator, and is a memcpy where possible
+                mReplicas[node] = mReplicas[0];
+            }
+        }
+    }
+
+    // The replica of the calling thread's node.
+    map_type const& local() const noexcept {
+        static thread_local size_t const node = numa_current_node();
+        return mReplicas[node % mReplicas.size()];
+    }
+
+    map_type const& replica(size_t node) const noexcept {
+        return mReplicas[node];
+    }
+
+    size_t num_replicas() const noexcept {
+        return mReplicas.size();
+    }
+
+    const_iterator find(key_type const& key) const {
+        return local().find(key);
+    }
+
+    size_t count(key_type const& key) const {
+        return local().count(key);
+    }
+
+    bool contains(key_type const& key) const {
+        return local().contains(key);
+    }
+
+    const_iterator begin() const {
+        return local().begin();
+    }
+
+    const_iterator end() const {
+        return local().end();
+    }
+
+    size_type size() const noexcept {
+        return mReplicas[0].size();
+    }
+
+    ROBIN_HOOD(NODISCARD) bool empty() const noexcept {
+        return mReplicas[0].empty();
+    }
+
+private:
+    std::vector<map_type> mReplicas{};
+};
+
+#if ROBIN_HOOD(HAS_MMAP)
+
+namespace detail {
+
+// Read-only view of a file written by Map::save(). The file is mapped into memory and lookups and
+// iteration work directly on the mapped arrays, so opening it costs the same no matter how many
+// entries it has; pages are only read from disk when they are first touched. The file must not be
+// modified while a view of it is open.
+template <typename Map>
+class MappedTable {
+    using Header = typename Map::ImageHeader;
+
+public:
+    using key_type = typename Map::key_type;
+    using mapped_type = typename Map::mapped_type;
+    using value_type = typename Map::value_type;
+    using size_type = typename Map::size_type;
+    using hasher = typename Map::hasher;
+    using key_equal = typename Map::key_equal;
+    using const_iterator = typename Map::const_iterator;
+    using iterator = const_iterator;
+
+    // Throws std::runtime_error when the file can't be mapped, was written by an incompatible map
+    // or is corrupt. Checking the info bytes reads them once.
+    explicit MappedTable(char const* path)
+        : mMap() {
+        ROBIN_HOOD_TRACE(this)
+        auto const fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            doThrow<std::runtime_error>("robin_hood: can't open file");
+        }
+        struct stat st {};
+        if (0 != ::fstat(fd, &st) || st.st_size < static_cast<off_t>(sizeof(Header))) {
+            ::close(fd);
+            doThrow<std::runtime_error>("robin_hood: not a map image");
+        }
+        mSize = static_cast<size_t>(st.st_size);
+        mData = ::mmap(nullptr, mSize, PROT_READ, MAP_SHARED, fd, 0);
+        // the mapping stays valid after the file is closed
+        ::close(fd);
+        if (MAP_FAILED == mData) {
+            doThrow<std::runtime_error>("robin_hood: can't map file");
+        }
+
+        Header header{};
+        std::memcpy(&header, mData, sizeof(header));
+        auto* const data = reinterpret_cast_no_cast_align_warning<typename Map::Node*>(
+            static_cast<char*>(mData) + Map::ImageDataOffset);
+        auto const* error = mMap.imageError(header, mSize);
+        if (error == nullptr) {
+            error = mMap.imageDataError(header, data);
+        }
+        if (error != nullptr) {
+            ::munmap(mData, mSize);
+            doThrow<std::runtime_error>(error);
+        }
+        mMap.useImage(header, data);
+    }
+
+    MappedTable(MappedTable const&) = delete;
+    MappedTable& operator=(MappedTable const&) = delete;
+
+    ~MappedTable() {
+        ROBIN_HOOD_TRACE(this)
+        mMap.releaseImage();
+        ::munmap(mData, mSize);
+    }
+
+    const_iterator find(key_type const& key) const {
+        return mMap.find(key);
+    }
+
+    size_t count(key_type const& key) const {
+        return mMap.count(key);
+    }
+
+    bool contains(key_type const& key) const {
+        return mMap.contains(key);
+    }
+
+    const_iterator begin() const {
+        return mMap.begin();
+    }
+    const_iterator cbegin() const {
+        return mMap.cbegin();
+    }
+    const_iterator end() const {
+        return mMap.end();
+    }
+    const_iterator cend() const {
+        return mMap.cend();
+    }
+
+    size_type size() const noexcept {
+        return mMap.size();
+    }
+
+    ROBIN_HOOD(NODISCARD) bool empty() const noexcept {
+        return mMap.empty();
+    }
+
+    // The mapped map, e.g. to pass it to code that takes a map. Must not outlive the view.
+    Map const& map() const noexcept {
+        return mMap;
+    }
+
+private:
+    Map mMap;
+    void* mData = nullptr;
+    size_t mSize = 0;
+};
+
+} // namespace detail
+
+template <typename Key, typename T, typename Hash = hash<Key>,
+          typename KeyEqual = std::equal_to<Key>, size_t MaxLoadFactor100 = 80,
+          size_t GrowthFactor100 = 200>
+using mapped_flat_map = detail::MappedTable<
+    unordered_flat_map<Key, T, Hash, KeyEqual, MaxLoadFactor100, GrowthFactor100>>;
+
+template <typename Key, typename Hash = hash<Key>, typename KeyEqual = std::equal_to<Key>,
+          size_t MaxLoadFactor100 = 80, size_t GrowthFactor100 = 200>
+using mapped_flat_set = detail::MappedTable<
+    unordered_flat_set<Key, Hash, KeyEqual, MaxLoadFactor100, GrowthFactor100>>;
+
+#endif
+
+} // namespace robin_hood
+
+#endif
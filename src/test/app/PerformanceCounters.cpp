@@ -96,6 +96,11 @@ uint64_t const* PerformanceCounters::monitor(Event e) {
     case Event::emulation_faults:
         return mon(this, PERF_COUNT_SW_EMULATION_FAULTS);
 
+    case Event::dtlb_load_misses:
+        return monitor(PERF_TYPE_HW_CACHE,
+                       PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8U) |
+                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16U));
+
 #    if !defined(__clang__)
     default:
 #        if ROBIN_HOOD(HAS_EXCEPTIONS)
@@ -91,7 +91,10 @@ public:
 
         // Number of emulation faults. The kernel sometimes traps on unimplemented instructions and
         // emulates them for user space.  This can negatively impact performance.
-        emulation_faults
+        emulation_faults,
+
+        // Data TLB misses of loads. Each one needs a page walk, huge pages make them rare.
+        dtlb_load_misses
     };
 
     uint64_t const* monitor(Event e);
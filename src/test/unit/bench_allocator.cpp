@@ -0,0 +1,112 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+#include <thirdparty/nanobench/nanobench.h>
+
+#include <memory>
+
+namespace {
+
+// Hands out memory from a fixed buffer and never frees anything. Everything is released at once
+// with reset().
+class BumpArena {
+public:
+    explicit BumpArena(size_t numBytes)
+        : mData(new char[numBytes])
+        , mSize(numBytes) {}
+
+    void* allocate(size_t numBytes, size_t alignment) {
+        auto const begin = (mUsed + alignment - 1) / alignment * alignment;
+        if (begin + numBytes > mSize) {
+            throw std::bad_alloc();
+        }
+        mUsed = begin + numBytes;
+        return mData.get() + begin;
+    }
+
+    void reset() noexcept {
+        mUsed = 0;
+    }
+
+private:
+    std::unique_ptr<char[]> mData;
+    size_t mSize;
+    size_t mUsed = 0;
+};
+
+template <typename T>
+class BumpAllocator {
+public:
+    using value_type = T;
+
+    explicit BumpAllocator(BumpArena* arena) noexcept
+        : mArena(arena) {}
+
+    template <typename U>
+    BumpAllocator(BumpAllocator<U> const& o) noexcept // NOLINT(google-explicit-constructor)
+        : mArena(o.arena()) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(mArena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* ROBIN_HOOD_UNUSED(ptr) /*unused*/,
+                    size_t ROBIN_HOOD_UNUSED(n) /*unused*/) noexcept {}
+
+    BumpArena* arena() const noexcept {
+        return mArena;
+    }
+
+private:
+    BumpArena* mArena;
+};
+
+template <typename T, typename U>
+bool operator==(BumpAllocator<T> const& a, BumpAllocator<U> const& b) noexcept {
+    return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(BumpAllocator<T> const& a, BumpAllocator<U> const& b) noexcept {
+    return !(a == b);
+}
+
+} // namespace
+
+// Many short lived maps, like one per request: default allocator against a bump arena that is
+// reset after each request.
+TEST_CASE("bench_allocator" * doctest::test_suite("nanobench") * doctest::skip()) {
+    static constexpr size_t NumMaps = 100;
+    static constexpr size_t NumElements = 200;
+
+    ankerl::nanobench::Bench bench;
+    bench.title("100 maps with 200 entries").relative(true);
+
+    sfc64 rng(123);
+    size_t size = 0;
+    bench.run("unordered_node_map, malloc_allocator", [&] {
+        for (size_t m = 0; m < NumMaps; ++m) {
+            robin_hood::unordered_node_map<uint64_t, uint64_t> map;
+            for (size_t i = 0; i < NumElements; ++i) {
+                map[rng()] = i;
+            }
+            size += map.size();
+        }
+    });
+
+    BumpArena arena(size_t(64) * 1024 * 1024);
+    bench.run("unordered_node_map, bump arena", [&] {
+        for (size_t m = 0; m < NumMaps; ++m) {
+            robin_hood::unordered_node_map<uint64_t, uint64_t, robin_hood::hash<uint64_t>,
+                                           std::equal_to<uint64_t>, 80, 200, BumpAllocator<char>>
+                map(BumpAllocator<char>{&arena});
+            for (size_t i = 0; i < NumElements; ++i) {
+                map[rng()] = i;
+            }
+            size += map.size();
+        }
+        arena.reset();
+    });
+    ankerl::nanobench::doNotOptimizeAway(size);
+}
@@ -0,0 +1,57 @@
+#include <robin_hood_concurrent.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+#include <thirdparty/nanobench/nanobench.h>
+
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+TYPE_TO_STRING(robin_hood::unordered_flat_map<uint64_t, uint64_t>);
+TYPE_TO_STRING(robin_hood::unordered_node_map<uint64_t, uint64_t>);
+
+// Startup time of a large map built from a vector without duplicates.
+TEST_CASE_TEMPLATE("bench_build_parallel" * doctest::test_suite("nanobench") * doctest::skip(), Map,
+                   robin_hood::unordered_flat_map<uint64_t, uint64_t>,
+                   robin_hood::unordered_node_map<uint64_t, uint64_t>) {
+    static constexpr size_t NumElements = 10000000;
+
+    std::vector<std::pair<uint64_t, uint64_t>> data;
+    sfc64 rng(123);
+    for (size_t i = 0; i < NumElements; ++i) {
+        data.emplace_back(rng(), i);
+    }
+
+    ankerl::nanobench::Bench bench;
+    bench.title("build " + type_string(Map{})).unit("element").relative(true);
+    bench.batch(NumElements);
+
+    size_t size = 0;
+    bench.run("insert(first, last)", [&] {
+        Map map;
+        map.insert(data.begin(), data.end());
+        size += map.size();
+    });
+
+    bench.run("reserve + insert(first, last)", [&] {
+        Map map;
+        map.reserve(data.size());
+        map.insert(data.begin(), data.end());
+        size += map.size();
+    });
+
+    std::vector<size_t> threadCounts{1};
+    if (std::thread::hardware_concurrency() > 1) {
+        threadCounts.push_back(std::thread::hardware_concurrency());
+    }
+    for (auto numThreads : threadCounts) {
+        bench.run("build_parallel, " + std::to_string(numThreads) + " threads", [&] {
+            Map map;
+            robin_hood::build_parallel(map, data.begin(), data.end(), numThreads);
+            size += map.size();
+        });
+    }
+    ankerl::nanobench::doNotOptimizeAway(size);
+}
@@ -0,0 +1,109 @@
+#include <robin_hood_concurrent.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+#include <thirdparty/nanobench/nanobench.h>
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// what most users do: one mutex around the whole map
+class LockedMap {
+public:
+    void insert(uint64_t key) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mMap.try_emplace(key, key);
+    }
+
+    size_t count(uint64_t key) const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mMap.count(key);
+    }
+
+    void erase(uint64_t key) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mMap.erase(key);
+    }
+
+private:
+    mutable std::mutex mMutex{};
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> mMap{};
+};
+
+class ShardedMap {
+public:
+    void insert(uint64_t key) {
+        mMap.try_emplace(key, key);
+    }
+
+    size_t count(uint64_t key) const {
+        return mMap.count(key);
+    }
+
+    void erase(uint64_t key) {
+        mMap.erase(key);
+    }
+
+private:
+    robin_hood::concurrent_flat_map<uint64_t, uint64_t> mMap{};
+};
+
+// Each thread does NumOps operations on keys in [0, NumKeys): 90% lookups, 5% inserts and
+// 5% erases. Returns the total number of operations per second.
+template <typename Map>
+double opsPerSecond(size_t numThreads) {
+    static constexpr size_t NumOps = 2000000;
+    static constexpr uint64_t NumKeys = 1000000;
+
+    Map map;
+    for (uint64_t i = 0; i < NumKeys; i += 2) {
+        map.insert(i);
+    }
+
+    std::atomic<size_t> numFound(0);
+    std::vector<std::thread> threads;
+    auto const begin = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&map, &numFound, t] {
+            sfc64 rng(t);
+            size_t found = 0;
+            for (size_t i = 0; i < NumOps; ++i) {
+                auto const key = rng.uniform<uint64_t>(NumKeys);
+                auto const op = rng.uniform<uint64_t>(20);
+                if (op == 0) {
+                    map.insert(key);
+                } else if (op == 1) {
+                    map.erase(key);
+                } else {
+                    found += map.count(key);
+                }
+            }
+            numFound += found;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - begin;
+    ankerl::nanobench::doNotOptimizeAway(numFound.load());
+    return static_cast<double>(NumOps * numThreads) / elapsed.count();
+}
+
+} // namespace
+
+TEST_CASE("bench_concurrent_map" * doctest::test_suite("nanobench") * doctest::skip()) {
+    auto const maxThreads = (std::max)(4U, std::thread::hardware_concurrency());
+    std::cout << "threads   mutex Mops/s   concurrent_flat_map Mops/s" << std::endl;
+    for (size_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+        std::cout << std::setw(7) << numThreads << std::fixed << std::setprecision(2)
+                  << std::setw(15) << opsPerSecond<LockedMap>(numThreads) / 1e6 << std::setw(29)
+                  << opsPerSecond<ShardedMap>(numThreads) / 1e6 << std::endl;
+    }
+}
@@ -0,0 +1,59 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+#include <thirdparty/nanobench/nanobench.h>
+
+#include <string>
+
+TYPE_TO_STRING(robin_hood::unordered_flat_map<uint64_t, uint64_t>);
+TYPE_TO_STRING(robin_hood::unordered_node_map<uint64_t, uint64_t>);
+
+// Removes part of a large map, once with an erase(iterator) loop and once with erase_if. The map is
+// filled close to its max load factor, so clusters are long.
+TEST_CASE_TEMPLATE("bench_erase_if" * doctest::test_suite("nanobench") * doctest::skip(), Map,
+                   robin_hood::unordered_flat_map<uint64_t, uint64_t>,
+                   robin_hood::unordered_node_map<uint64_t, uint64_t>) {
+    // 76% of 2^21 buckets
+    static constexpr size_t NumElements = 1600000;
+
+    Map original;
+    sfc64 rng(123);
+    for (size_t i = 0; i < NumElements; ++i) {
+        original[rng()] = rng.uniform<uint64_t>(100);
+    }
+
+    ankerl::nanobench::Bench bench;
+    bench.title(type_string(Map{})).unit("element").relative(true);
+    bench.batch(NumElements);
+
+    // the copy is part of each measurement, so also benchmark it alone.
+    size_t numLeft = 0;
+    bench.run("copy only", [&] {
+        Map map = original;
+        numLeft += map.size();
+    });
+
+    for (uint64_t percent : {30U, 90U}) {
+        bench.run("erase " + std::to_string(percent) + "% with erase(iterator) loop", [&] {
+            Map map = original;
+            for (auto it = map.begin(); it != map.end();) {
+                if (it->second < percent) {
+                    it = map.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            numLeft += map.size();
+        });
+
+        bench.run("erase " + std::to_string(percent) + "% with erase_if", [&] {
+            Map map = original;
+            robin_hood::erase_if(map, [percent](typename Map::value_type const& kv) {
+                return kv.second < percent;
+            });
+            numLeft += map.size();
+        });
+    }
+    ankerl::nanobench::doNotOptimizeAway(numLeft);
+}
@@ -3,8 +3,10 @@
 #include <app/benchmark.h>
 #include <app/doctest.h>
 #include <app/sfc64.h>
+#include <thirdparty/nanobench/nanobench.h>
 
 #include <array>
+#include <vector>
 
 TYPE_TO_STRING(robin_hood::unordered_flat_map<size_t, size_t>);
 TYPE_TO_STRING(robin_hood::unordered_node_map<size_t, size_t>);
@@ -95,3 +97,60 @@ TEST_CASE_TEMPLATE("bench_find_random" * doctest::test_suite("bench") * doctest:
     }
     REQUIRE(checksum == requiredChecksum);
 }
+
+TEST_CASE_TEMPLATE("bench_find_load_factor" * doctest::test_suite("nanobench") * doctest::skip(),
+                   Map, robin_hood::unordered_flat_map<size_t, size_t>,
+                   robin_hood::unordered_node_map<size_t, size_t>) {
+    static constexpr size_t numBuckets = 1U << 20U;
+
+    ankerl::nanobench::Bench bench;
+    bench.title("find " + type_string(Map{})).minEpochIterations(200000);
+    size_t checksum = 0;
+
+    for (size_t loadFactor100 : {20U, 40U, 60U, 79U}) {
+        Map map;
+        map.reserve(numBuckets * 79 / 100);
+
+        ankerl::nanobench::Rng rng(123);
+        std::vector<size_t> keys(numBuckets * loadFactor100 / 100);
+        for (auto& key : keys) {
+            key = static_cast<size_t>(rng());
+            map[key] = 1;
+        }
+        REQUIRE(map.bucket_count() == numBuckets);
+
+        auto const name = std::to_string(loadFactor100) + "% load";
+        size_t i = 0;
+        bench.run(name + " hit", [&] {
+            checksum += map.find(keys[i])->second;
+            if (++i == keys.size()) {
+                i = 0;
+            }
+        });
+        bench.run(name + " miss", [&] { checksum += map.count(static_cast<size_t>(rng())); });
+
+        // batch variants, 64 keys at once
+        std::vector<typename Map::iterator> found(64);
+        std::vector<size_t> missKeys(64);
+        i = 0;
+        bench.batch(found.size()).run(name + " hit find_many", [&] {
+            auto const begin = keys.begin() + static_cast<std::ptrdiff_t>(i);
+            map.find_many(begin, begin + 64, found.begin());
+            for (auto const& it : found) {
+                checksum += it->second;
+            }
+            i += 64;
+            if (i + 64 > keys.size()) {
+                i = 0;
+            }
+        });
+        bench.run(name + " miss contains_many", [&] {
+            for (auto& key : missKeys) {
+                key = static_cast<size_t>(rng());
+            }
+            checksum += map.contains_many(missKeys.begin(), missKeys.end());
+        });
+        bench.batch(1);
+    }
+    ankerl::nanobench::doNotOptimizeAway(checksum);
+}
@@ -0,0 +1,79 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+#include <thirdparty/nanobench/nanobench.h>
+
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+template <size_t GrowthFactor100>
+using FlatMap = robin_hood::unordered_flat_map<uint64_t, uint64_t, robin_hood::hash<uint64_t>,
+                                               std::equal_to<uint64_t>, 80, GrowthFactor100>;
+
+template <typename Map>
+size_t numBytesTotal(Map const& map) {
+    return map.calcNumBytesTotal(map.calcNumElementsWithBuffer(map.bucket_count()));
+}
+
+} // namespace
+
+TYPE_TO_STRING(FlatMap<200>);
+TYPE_TO_STRING(FlatMap<150>);
+TYPE_TO_STRING(FlatMap<125>);
+
+// Memory vs. throughput of the growth factor: smaller factors waste less memory on average but
+// have to rehash more often, and can't use a mask for the range reduction.
+TEST_CASE_TEMPLATE("bench_growth_factor" * doctest::test_suite("nanobench") * doctest::skip(), Map,
+                   FlatMap<200>, FlatMap<150>, FlatMap<125>) {
+    static constexpr size_t NumInserts = 2000000;
+
+    // average bytes per element, sampled after each insert
+    {
+        Map map;
+        sfc64 rng(123);
+        double sumBytesPerElement = 0;
+        size_t bytesTotal = 0;
+        for (size_t i = 0; i < NumInserts; ++i) {
+            map[rng()] = i;
+            auto const bytes = numBytesTotal(map);
+            sumBytesPerElement += static_cast<double>(bytes) / static_cast<double>(map.size());
+            bytesTotal = bytes;
+        }
+        std::cout << type_string(map) << ": " << std::fixed << std::setprecision(2)
+                  << sumBytesPerElement / static_cast<double>(NumInserts)
+                  << " average bytes per element, " << bytesTotal << " bytes total"
+                  << std::endl;
+    }
+
+    ankerl::nanobench::Bench bench;
+    bench.title("growth factor").unit("op");
+
+    bench.batch(NumInserts).run("insert " + type_string(Map{}), [&] {
+        Map map;
+        sfc64 rng(123);
+        for (size_t i = 0; i < NumInserts; ++i) {
+            map[rng()] = i;
+        }
+        ankerl::nanobench::doNotOptimizeAway(map.size());
+    });
+
+    Map map;
+    sfc64 rng(123);
+    for (size_t i = 0; i < NumInserts; ++i) {
+        map[rng()] = i;
+    }
+    size_t numFound = 0;
+    bench.batch(NumInserts * 2).run("find " + type_string(Map{}), [&] {
+        // half of the lookups are successful
+        sfc64 foundRng(123);
+        sfc64 notFoundRng(321);
+        for (size_t i = 0; i < NumInserts; ++i) {
+            numFound += map.count(foundRng());
+            numFound += map.count(notFoundRng());
+        }
+    });
+    ankerl::nanobench::doNotOptimizeAway(numFound);
+}
@@ -12,7 +12,19 @@ TEST_CASE_TEMPLATE("bench_hash_int" * doctest::test_suite("nanobench") * doctest
     // add a (neglectible) bit of randomization so the compiler can't optimize this away
     ankerl::nanobench::Bench bench;
     robin_hood::hash<T> hasher;
+    robin_hood::hash_hw<T> hasherHw;
     T i = 0;
     size_t a = 0;
     bench.run("robin_hood::hash " + type_string(i), [&] { a += hasher(i++); }).doNotOptimizeAway(a);
+    bench.run("robin_hood::hash_hw " + type_string(i), [&] { a += hasherHw(i++); })
+        .doNotOptimizeAway(a);
+
+    // each hash depends on the previous one, so this measures latency
+    bench.run("robin_hood::hash latency " + type_string(i), [&] {
+        a = hasher(static_cast<T>(a));
+    });
+    bench.run("robin_hood::hash_hw latency " + type_string(i), [&] {
+        a = hasherHw(static_cast<T>(a));
+    });
+    bench.doNotOptimizeAway(a);
 }
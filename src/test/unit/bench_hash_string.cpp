@@ -25,6 +25,8 @@
 #endif
 
 #include <fstream>
+#include <string>
+#include <vector>
 
 namespace {
 
@@ -60,6 +62,38 @@ TEST_CASE("bench_hash_bytes_robin" * doctest::test_suite("nanobench") * doctest:
     bench("robin", [](void const* data, size_t len) { return robin_hood::hash_bytes(data, len); });
 }
 
+TEST_CASE("bench_hash_bytes_robin_hw" * doctest::test_suite("nanobench") * doctest::skip()) {
+    bench("robin_hw",
+          [](void const* data, size_t len) { return robin_hood::hash_bytes_hw(data, len); });
+}
+
+// Throughput of hash_bytes and hash_bytes_hw per key length, as a table.
+TEST_CASE("bench_hash_bytes_lengths" * doctest::test_suite("nanobench") * doctest::skip()) {
+    ankerl::nanobench::Rng rng(123);
+    std::vector<uint8_t> blob(10000 + 1024);
+    for (auto& b : blob) {
+        b = static_cast<uint8_t>(rng());
+    }
+
+    ankerl::nanobench::Bench bench;
+    bench.title("hash_bytes").unit("byte");
+    size_t offset = 0;
+    size_t result = 0;
+    for (size_t len : {4U, 8U, 16U, 24U, 32U, 64U, 100U, 1000U, 10000U}) {
+        // different offsets so the hash can't be cached
+        auto const next = [&] {
+            offset = (offset + 67) & 1023U;
+            return blob.data() + offset;
+        };
+        bench.batch(len);
+        bench.run("hash_bytes " + std::to_string(len),
+                  [&] { result += robin_hood::hash_bytes(next(), len); });
+        bench.run("hash_bytes_hw " + std::to_string(len),
+                  [&] { result += robin_hood::hash_bytes_hw(next(), len); });
+    }
+    ankerl::nanobench::doNotOptimizeAway(result);
+}
+
 #if ROBIN_HOOD(CXX) >= ROBIN_HOOD(CXX17)
 
 TEST_CASE("bench_hash_bytes_stdhash" * doctest::test_suite("nanobench") * doctest::skip()) {
@@ -71,6 +105,39 @@ TEST_CASE("bench_hash_bytes_stdhash" * doctest::test_suite("nanobench") * doctes
 
 #endif
 
+TYPE_TO_STRING(robin_hood::unordered_node_map<std::string, size_t>);
+TYPE_TO_STRING(robin_hood::unordered_node_map_cached_hash<std::string, size_t>);
+
+// Grows a map from empty with long keys. Every rehash has to hash all keys again, unless the map
+// stores the hashes.
+TEST_CASE_TEMPLATE("bench_grow_string_keys" * doctest::test_suite("nanobench") * doctest::skip(),
+                   Map, robin_hood::unordered_node_map<std::string, size_t>,
+                   robin_hood::unordered_node_map_cached_hash<std::string, size_t>) {
+    static constexpr size_t KeyLength = 100;
+    static constexpr size_t NumKeys = 200000;
+
+    ankerl::nanobench::Rng rng(123);
+    std::vector<std::string> keys(NumKeys);
+    for (auto& key : keys) {
+        key.resize(KeyLength);
+        for (auto& c : key) {
+            c = static_cast<char>('a' + rng.bounded(26));
+        }
+    }
+
+    ankerl::nanobench::Bench()
+        .title("grow with 100 byte keys")
+        .unit("insert")
+        .batch(keys.size())
+        .run(type_string(Map{}), [&] {
+            Map map;
+            for (size_t i = 0; i < keys.size(); ++i) {
+                map.emplace(keys[i], i);
+            }
+            ankerl::nanobench::doNotOptimizeAway(map.size());
+        });
+}
+
 #if 0
 TEST_CASE("bench_hash_bytes_xxhash" * doctest::test_suite("nanobench") * doctest::skip()) {
     bench("xxhash", [](void const* data, size_t len) { return XXH64(data, len, 0); });
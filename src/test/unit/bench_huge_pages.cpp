@@ -0,0 +1,82 @@
+#include <robin_hood_os.h>
+
+#include <app/PerformanceCounters.h>
+#include <app/doctest.h>
+#include <app/sfc64.h>
+#include <thirdparty/nanobench/nanobench.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#if ROBIN_HOOD(HAS_MMAP)
+
+namespace {
+
+// Runs op and prints its time, page faults and dTLB load misses.
+template <typename Op>
+void measure(std::string const& name, Op op) {
+    PerformanceCounters pc;
+    auto const* pageFaults = pc.monitor(PerformanceCounters::Event::page_faults);
+    auto const* dtlbMisses = pc.monitor(PerformanceCounters::Event::dtlb_load_misses);
+    pc.reset();
+    pc.enable();
+    auto const begin = std::chrono::steady_clock::now();
+    op();
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - begin;
+    pc.disable();
+    pc.fetch();
+
+    auto show = [](uint64_t const* value) {
+        return PerformanceCounters::no_data == *value ? std::string("-") : std::to_string(*value);
+    };
+    std::cout << std::setw(38) << name << std::fixed << std::setprecision(3) << std::setw(10)
+              << elapsed.count() << std::setw(14) << show(pageFaults) << std::setw(14)
+              << show(dtlbMisses) << std::endl;
+}
+
+template <typename Map>
+void run(std::string const& name) {
+    static constexpr size_t NumElements = 20000000;
+    static constexpr size_t NumLookups = 20000000;
+
+    Map map;
+    measure(name + " reserve", [&] { map.reserve(NumElements); });
+    sfc64 rng(123);
+    measure(name + " insert", [&] {
+        for (size_t i = 0; i < NumElements; ++i) {
+            map[rng()] = i;
+        }
+    });
+
+    size_t found = 0;
+    measure(name + " find", [&] {
+        sfc64 lookup(123);
+        for (size_t i = 0; i < NumLookups; ++i) {
+            found += map.count(lookup());
+        }
+    });
+    ankerl::nanobench::doNotOptimizeAway(found);
+}
+
+} // namespace
+
+// A map with 20M entries (about 600MB) with 4K pages, huge pages, and prefaulted huge pages.
+TEST_CASE("bench_huge_pages" * doctest::test_suite("nanobench") * doctest::skip()) {
+    using Flat = robin_hood::unordered_flat_map<uint64_t, uint64_t>;
+    using Huge = robin_hood::unordered_flat_map<uint64_t, uint64_t, robin_hood::hash<uint64_t>,
+                                                std::equal_to<uint64_t>, 80, 200,
+                                                robin_hood::huge_page_allocator<char>>;
+    using Prefault = robin_hood::unordered_flat_map<
+        uint64_t, uint64_t, robin_hood::hash<uint64_t>, std::equal_to<uint64_t>, 80, 200,
+        robin_hood::huge_page_allocator<char, size_t(2) * 1024 * 1024, true>>;
+
+    std::cout << std::setw(38) << "" << std::setw(10) << "seconds" << std::setw(14)
+              << "page faults" << std::setw(14) << "dTLB misses" << std::endl;
+    run<Flat>("malloc_allocator");
+    run<Huge>("huge_page_allocator");
+    run<Prefault>("huge_page_allocator, Prefault");
+}
+
+#endif
@@ -0,0 +1,54 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+#include <thirdparty/nanobench/nanobench.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+TYPE_TO_STRING(robin_hood::unordered_flat_map_incremental<uint64_t, uint64_t>);
+TYPE_TO_STRING(robin_hood::unordered_node_map_incremental<uint64_t, uint64_t>);
+
+// Measures the time of each single insert while the map grows, and shows the tail latencies of
+// the default resize (everything is moved at once) and of the incremental rehash.
+TEST_CASE_TEMPLATE("bench_insert_latency" * doctest::test_suite("nanobench") * doctest::skip(),
+                   Map, robin_hood::unordered_flat_map_incremental<uint64_t, uint64_t>,
+                   robin_hood::unordered_node_map_incremental<uint64_t, uint64_t>) {
+    static constexpr size_t NumInserts = 5000000;
+    using Clock = std::chrono::steady_clock;
+
+    std::cout << type_string(Map{}) << ", " << NumInserts << " inserts, ns per insert"
+              << std::endl;
+    std::cout << "slots/op        p50        p99      p99.9        max   total ms" << std::endl;
+    for (size_t slotsPerOperation : {0U, 8U, 64U}) {
+        std::vector<Clock::duration> durations(NumInserts);
+        ankerl::nanobench::Rng rng(123);
+        Map map;
+        map.set_incremental_rehash(slotsPerOperation);
+
+        auto const begin = Clock::now();
+        for (size_t i = 0; i < NumInserts; ++i) {
+            auto const key = rng();
+            auto const before = Clock::now();
+            map[key] = i;
+            durations[i] = Clock::now() - before;
+        }
+        auto const total = Clock::now() - begin;
+        ankerl::nanobench::doNotOptimizeAway(map.size());
+
+        std::sort(durations.begin(), durations.end());
+        auto ns = [&](double percentile) {
+            auto idx = static_cast<size_t>(percentile * static_cast<double>(NumInserts - 1));
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(durations[idx]).count();
+        };
+        std::cout << std::setw(8) << slotsPerOperation << std::setw(11) << ns(0.5)
+                  << std::setw(11) << ns(0.99) << std::setw(11) << ns(0.999) << std::setw(11)
+                  << ns(1.0) << std::setw(11)
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(total).count()
+                  << std::endl;
+    }
+}
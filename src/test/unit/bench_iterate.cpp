@@ -43,3 +43,41 @@ TEST_CASE_TEMPLATE("bench iterate" * doctest::test_suite("bench") * doctest::ski
     }
     REQUIRE(result == 62499999975000);
 }
+
+// After random inserts and erases the nodes are scattered over the pool in free list order.
+// relayout() puts them back in iteration order.
+TEST_CASE("bench iterate relayout" * doctest::test_suite("bench") * doctest::skip()) {
+    static constexpr size_t num_elements = 5000000;
+    static constexpr size_t num_iters = 10;
+
+    sfc64 rng(321);
+    robin_hood::unordered_node_map<uint64_t, uint64_t> map;
+    for (size_t n = 0; n < num_elements; ++n) {
+        map[rng.uniform<uint64_t>(num_elements * 2)] = n;
+        map.erase(rng.uniform<uint64_t>(num_elements * 2));
+    }
+
+    uint64_t result = 0;
+    BENCHMARK("iterate after churn", num_iters * map.size(), "it") {
+        for (size_t i = 0; i < num_iters; ++i) {
+            for (auto const& keyVal : map) {
+                result += keyVal.second;
+            }
+        }
+    }
+    auto const expected = result;
+
+    BENCHMARK("relayout", map.size(), "node") {
+        map.relayout();
+    }
+
+    result = 0;
+    BENCHMARK("iterate after relayout", num_iters * map.size(), "it") {
+        for (size_t i = 0; i < num_iters; ++i) {
+            for (auto const& keyVal : map) {
+                result += keyVal.second;
+            }
+        }
+    }
+    REQUIRE(result == expected);
+}
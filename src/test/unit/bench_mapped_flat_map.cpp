@@ -0,0 +1,62 @@
+#include <robin_hood_os.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+#include <thirdparty/nanobench/nanobench.h>
+
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#if ROBIN_HOOD(HAS_MMAP)
+
+// Startup time of a large lookup table: rebuild it from the raw data, load() a saved copy, or
+// map the saved copy and do a few lookups.
+TEST_CASE("bench_mapped_flat_map" * doctest::test_suite("nanobench") * doctest::skip()) {
+    static constexpr size_t NumElements = 5000000;
+    static constexpr size_t NumLookups = 1000;
+    char const* path = "robin_hood_bench_mapped_flat_map.bin";
+
+    std::vector<std::pair<uint64_t, uint64_t>> data;
+    sfc64 rng(123);
+    for (size_t i = 0; i < NumElements; ++i) {
+        data.emplace_back(rng(), i);
+    }
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> original(data.begin(), data.end());
+    original.save(path);
+
+    ankerl::nanobench::Bench bench;
+    bench.title("startup with " + std::to_string(NumElements) + " entries, " +
+                std::to_string(NumLookups) + " lookups")
+        .relative(true);
+
+    size_t found = 0;
+    auto lookups = [&](robin_hood::unordered_flat_map<uint64_t, uint64_t> const& map) {
+        for (size_t i = 0; i < NumLookups; ++i) {
+            found += map.count(data[i * 997].first);
+        }
+    };
+
+    bench.run("rebuild", [&] {
+        robin_hood::unordered_flat_map<uint64_t, uint64_t> map;
+        map.reserve(data.size());
+        map.insert(data.begin(), data.end());
+        lookups(map);
+    });
+
+    bench.run("load", [&] {
+        robin_hood::unordered_flat_map<uint64_t, uint64_t> map;
+        map.load(path);
+        lookups(map);
+    });
+
+    bench.run("mapped_flat_map", [&] {
+        robin_hood::mapped_flat_map<uint64_t, uint64_t> const view(path);
+        lookups(view.map());
+    });
+
+    ankerl::nanobench::doNotOptimizeAway(found);
+    std::remove(path);
+}
+
+#endif
@@ -1,5 +1,3 @@
-//#define ROBIN_HOOD_COUNT_ENABLED
-
 #include <robin_hood.h>
 
 #include <app/benchmark.h>
@@ -176,10 +174,6 @@ TEST_CASE("bench_quick_overall_map_flat" * doctest::test_suite("bench") * doctes
     benchAll<robin_hood::unordered_flat_map<uint64_t, size_t>>(&bench);
     benchAll<robin_hood::unordered_flat_map<std::string, size_t>>(&bench);
     std::cout << geomean1(bench) << std::endl;
-
-#ifdef ROBIN_HOOD_COUNT_ENABLED
-    std::cout << robin_hood::counts() << std::endl;
-#endif
 }
 
 TEST_CASE("bench_quick_overall_map_node" * doctest::test_suite("bench") * doctest::skip()) {
@@ -187,10 +181,6 @@ TEST_CASE("bench_quick_overall_map_node" * doctest::test_suite("bench") * doctes
     benchAll<robin_hood::unordered_node_map<uint64_t, size_t>>(&bench);
     benchAll<robin_hood::unordered_node_map<std::string, size_t>>(&bench);
     std::cout << geomean1(bench) << std::endl;
-
-#ifdef ROBIN_HOOD_COUNT_ENABLED
-    std::cout << robin_hood::counts() << std::endl;
-#endif
 }
 
 TEST_CASE("bench_quick_overall_map_std" * doctest::test_suite("bench") * doctest::skip()) {
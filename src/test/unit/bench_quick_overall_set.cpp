@@ -1,5 +1,3 @@
-//#define ROBIN_HOOD_COUNT_ENABLED
-
 #include <robin_hood.h>
 
 #include <app/benchmark.h>
@@ -172,10 +170,6 @@ TEST_CASE("bench_quick_overall_set_flat" * doctest::test_suite("bench") * doctes
     benchAll<robin_hood::unordered_flat_set<std::string>>(&bench);
     benchAll<robin_hood::unordered_set<std::string>>(&bench);
     std::cout << geomean1(bench) << std::endl;
-
-#ifdef ROBIN_HOOD_COUNT_ENABLED
-    std::cout << robin_hood::counts() << std::endl;
-#endif
 }
 
 TEST_CASE("bench_quick_overall_set_node" * doctest::test_suite("bench") * doctest::skip()) {
@@ -183,10 +177,6 @@ TEST_CASE("bench_quick_overall_set_node" * doctest::test_suite("bench") * doctes
     benchAll<robin_hood::unordered_node_set<uint64_t>>(&bench);
     benchAll<robin_hood::unordered_node_set<std::string>>(&bench);
     std::cout << geomean1(bench) << std::endl;
-
-#ifdef ROBIN_HOOD_COUNT_ENABLED
-    std::cout << robin_hood::counts() << std::endl;
-#endif
 }
 
 TEST_CASE("bench_quick_overall_set_std" * doctest::test_suite("bench") * doctest::skip()) {
@@ -0,0 +1,118 @@
+#include <robin_hood_concurrent.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+#include <thirdparty/nanobench/nanobench.h>
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+static constexpr uint64_t NumKeys = 100000;
+static constexpr size_t NumLookups = 2000000;
+
+using Map = robin_hood::unordered_flat_map<uint64_t, uint64_t>;
+
+struct LockedMap {
+    struct Reader {
+        LockedMap& m;
+
+        size_t count(uint64_t key) {
+            std::lock_guard<std::mutex> lock(m.mutex);
+            return m.map.count(key);
+        }
+    };
+
+    Reader make_reader() {
+        return Reader{*this};
+    }
+
+    void update(uint64_t key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        map[key] = key;
+    }
+
+    std::mutex mutex{};
+    Map map{};
+};
+
+struct RcuMap {
+    struct Reader {
+        robin_hood::rcu_flat_map<uint64_t, uint64_t>::reader r;
+
+        size_t count(uint64_t key) {
+            return r.read([key](Map const& m) { return m.count(key); });
+        }
+    };
+
+    Reader make_reader() {
+        return Reader{map.make_reader()};
+    }
+
+    void update(uint64_t key) {
+        map.update([key](Map& m) { m[key] = key; });
+    }
+
+    robin_hood::rcu_flat_map<uint64_t, uint64_t> map{};
+};
+
+// numThreads readers do NumLookups lookups each, while a writer updates the map every 10ms.
+// Returns the total number of lookups per second.
+template <typename M>
+double lookupsPerSecond(size_t numThreads) {
+    M map;
+    for (uint64_t i = 0; i < NumKeys; i += 2) {
+        map.update(i);
+    }
+
+    std::atomic<bool> done(false);
+    std::thread writer([&] {
+        uint64_t key = 1;
+        while (!done) {
+            map.update(key);
+            key += 2;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    });
+
+    std::atomic<size_t> numFound(0);
+    std::vector<std::thread> readers;
+    auto const begin = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < numThreads; ++t) {
+        readers.emplace_back([&map, &numFound, t] {
+            auto reader = map.make_reader();
+            sfc64 rng(t);
+            size_t found = 0;
+            for (size_t i = 0; i < NumLookups; ++i) {
+                found += reader.count(rng.uniform<uint64_t>(NumKeys));
+            }
+            numFound += found;
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - begin;
+    done = true;
+    writer.join();
+    ankerl::nanobench::doNotOptimizeAway(numFound.load());
+    return static_cast<double>(NumLookups * numThreads) / elapsed.count();
+}
+
+} // namespace
+
+TEST_CASE("bench_rcu_map" * doctest::test_suite("nanobench") * doctest::skip()) {
+    auto const maxThreads = (std::max)(4U, std::thread::hardware_concurrency());
+    std::cout << "readers   mutex Mlookups/s   rcu_flat_map Mlookups/s" << std::endl;
+    for (size_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+        std::cout << std::setw(7) << numThreads << std::fixed << std::setprecision(2)
+                  << std::setw(19) << lookupsPerSecond<LockedMap>(numThreads) / 1e6
+                  << std::setw(26) << lookupsPerSecond<RcuMap>(numThreads) / 1e6 << std::endl;
+    }
+}
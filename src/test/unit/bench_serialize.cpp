@@ -0,0 +1,55 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+#include <thirdparty/nanobench/nanobench.h>
+
+#include <sstream>
+#include <string>
+
+// Reload of a map with string keys: deserialize() against reading all entries and inserting them
+// one by one.
+TEST_CASE("bench_serialize" * doctest::test_suite("nanobench") * doctest::skip()) {
+    static constexpr size_t NumElements = 1000000;
+    using Map = robin_hood::unordered_flat_map<std::string, uint64_t>;
+
+    Map map;
+    sfc64 rng(123);
+    for (size_t i = 0; i < NumElements; ++i) {
+        map[std::to_string(rng())] = i;
+    }
+    std::stringstream ss;
+    map.serialize(ss);
+    auto const data = ss.str();
+
+    ankerl::nanobench::Bench bench;
+    bench.title("reload " + std::to_string(NumElements) + " string keys")
+        .unit("element")
+        .batch(NumElements)
+        .relative(true);
+
+    size_t size = 0;
+    bench.run("read + operator[]", [&] {
+        std::istringstream in(data);
+        auto read = [&in](void* dst, size_t n) {
+            in.read(static_cast<char*>(dst), static_cast<std::streamsize>(n));
+        };
+        auto const num = robin_hood::serializer<uint64_t>::read(read);
+        robin_hood::serializer<uint64_t>::read(read);
+        Map loaded;
+        for (uint64_t i = 0; i < num; ++i) {
+            auto key = robin_hood::serializer<std::string>::read(read);
+            loaded[std::move(key)] = robin_hood::serializer<uint64_t>::read(read);
+        }
+        size += loaded.size();
+    });
+
+    bench.run("deserialize", [&] {
+        std::istringstream in(data);
+        Map loaded;
+        loaded.deserialize(in);
+        size += loaded.size();
+    });
+
+    ankerl::nanobench::doNotOptimizeAway(size);
+}
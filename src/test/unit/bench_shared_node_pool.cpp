@@ -0,0 +1,72 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#    include <malloc.h>
+#    define ROBIN_HOOD_BENCH_MALLINFO2 1
+#endif
+
+namespace {
+
+// Bytes currently allocated with malloc, including its bookkeeping. 0 where that is not known.
+size_t heapBytes() {
+#if defined(ROBIN_HOOD_BENCH_MALLINFO2)
+    auto const info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+// Creates NumMaps maps with NumEntries entries each, and prints the time and memory it took.
+template <typename Map, typename MakeMap>
+void run(std::string const& name, MakeMap makeMap) {
+    static constexpr size_t NumMaps = 1000000;
+    static constexpr size_t NumEntries = 10;
+
+    auto const heapBefore = heapBytes();
+    auto const begin = std::chrono::steady_clock::now();
+    std::vector<Map> maps;
+    maps.reserve(NumMaps);
+    sfc64 rng(123);
+    for (size_t m = 0; m < NumMaps; ++m) {
+        maps.push_back(makeMap());
+        auto& map = maps.back();
+        for (size_t i = 0; i < NumEntries; ++i) {
+            map[rng()] = i;
+        }
+    }
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - begin;
+    auto const heap = heapBytes() - heapBefore;
+
+    auto const numInserts = static_cast<double>(NumMaps * NumEntries);
+    std::cout << std::setw(32) << name << std::fixed << std::setprecision(2) << std::setw(12)
+              << numInserts / elapsed.count() / 1e6 << std::setw(12)
+              << static_cast<double>(heap) / (1024.0 * 1024.0) << std::endl;
+}
+
+} // namespace
+
+// 1M small node maps, each with its own node pool, and with all nodes in a shared pool.
+TEST_CASE("bench_shared_node_pool" * doctest::test_suite("nanobench") * doctest::skip()) {
+    using Own = robin_hood::unordered_node_map<uint64_t, uint64_t>;
+    using Shared = robin_hood::unordered_node_map<uint64_t, uint64_t, robin_hood::hash<uint64_t>,
+                                                  std::equal_to<uint64_t>, 80, 200,
+                                                  robin_hood::shared_node_allocator<char>>;
+
+    std::cout << std::setw(32) << "" << std::setw(12) << "Minserts/s" << std::setw(12) << "heap MB"
+              << std::endl;
+    run<Own>("own pool per map", [] { return Own(); });
+    run<Shared>("shared_node_allocator, thread", [] { return Shared(); });
+    robin_hood::node_pool<Shared::value_type> pool;
+    run<Shared>("shared_node_allocator, explicit",
+                [&] { return Shared(robin_hood::shared_node_allocator<char>(pool)); });
+}
@@ -0,0 +1,56 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+#include <thirdparty/nanobench/nanobench.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+static constexpr size_t NumMaps = 100000;
+
+// Builds NumMaps maps with 0 to 6 entries each, and looks up random keys in random maps.
+template <typename Map>
+void run(ankerl::nanobench::Bench& bench, std::string const& name) {
+    size_t result = 0;
+    bench.run(name + " build", [&] {
+        sfc64 rng(123);
+        std::vector<Map> maps(NumMaps);
+        for (auto& map : maps) {
+            auto const n = rng.uniform<uint64_t>(7);
+            for (uint64_t i = 0; i < n; ++i) {
+                map[rng.uniform<uint64_t>(100)] = i;
+            }
+        }
+        result += maps.size();
+    });
+
+    sfc64 rng(123);
+    std::vector<Map> maps(NumMaps);
+    for (auto& map : maps) {
+        auto const n = rng.uniform<uint64_t>(7);
+        for (uint64_t i = 0; i < n; ++i) {
+            map[rng.uniform<uint64_t>(100)] = i;
+        }
+    }
+    bench.run(name + " find", [&] {
+        for (size_t i = 0; i < NumMaps; ++i) {
+            auto const& map = maps[rng.uniform<uint64_t>(NumMaps)];
+            result += map.count(rng.uniform<uint64_t>(100));
+        }
+    });
+    ankerl::nanobench::doNotOptimizeAway(result);
+}
+
+} // namespace
+
+// Lots of maps with only a few entries each, e.g. the inner maps of a map of maps.
+TEST_CASE("bench_small_flat_map" * doctest::test_suite("nanobench") * doctest::skip()) {
+    ankerl::nanobench::Bench bench;
+    bench.title("100k maps with 0-6 entries").unit("map").batch(NumMaps).relative(true);
+    bench.minEpochIterations(10);
+    run<robin_hood::unordered_flat_map<uint64_t, uint64_t>>(bench, "unordered_flat_map");
+    run<robin_hood::small_flat_map<uint64_t, uint64_t, 6>>(bench, "small_flat_map<6>");
+}
@@ -0,0 +1,173 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+#include <thirdparty/nanobench/nanobench.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+size_t numBytesAllocated = 0;
+
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() noexcept = default;
+
+    template <typename U>
+    CountingAllocator(CountingAllocator<U> const& /*unused*/) noexcept {}
+
+    T* allocate(size_t n) {
+        numBytesAllocated += n * sizeof(T);
+        return static_cast<T*>(std::malloc(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+        numBytesAllocated -= n * sizeof(T);
+        std::free(ptr);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(CountingAllocator<T> const& /*unused*/,
+                CountingAllocator<U> const& /*unused*/) noexcept {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(CountingAllocator<T> const& /*unused*/,
+                CountingAllocator<U> const& /*unused*/) noexcept {
+    return false;
+}
+
+static constexpr size_t MaxNumElements = 2000000;
+static constexpr size_t NumLookups = 100000;
+
+// Weak hash that ignores the lowest Bits bits, so each group of 2^Bits keys shares one hash value,
+// like a string hash that only looks at a prefix.
+template <size_t Bits>
+struct PrefixHash {
+    static constexpr size_t GroupSize = size_t(1) << Bits;
+
+    size_t operator()(uint64_t key) const noexcept {
+        return robin_hood::hash_int(key >> Bits);
+    }
+};
+
+// Random keys, so each key has its own hash value.
+template <typename Hash>
+uint64_t makeKey(Hash const& /*unused*/, sfc64& rng, size_t /*unused*/, uint64_t* /*unused*/) {
+    return rng();
+}
+
+// Groups of keys with a random prefix.
+template <size_t Bits>
+uint64_t makeKey(PrefixHash<Bits> const& /*unused*/, sfc64& rng, size_t i, uint64_t* prefix) {
+    if (0 == i % PrefixHash<Bits>::GroupSize) {
+        *prefix = rng() << Bits;
+    }
+    return *prefix | (i % PrefixHash<Bits>::GroupSize);
+}
+
+// Inserts MaxNumElements keys, and prints the average memory per element over all sizes and the
+// lowest load at which the set had to grow. Then finds random keys that are all in the set and
+// keys that are all missing. Stops early when the set throws because an info overflowed.
+template <typename Set>
+void run(ankerl::nanobench::Bench& bench, std::string const& name) {
+    sfc64 rng(123);
+    std::vector<uint64_t> keys(MaxNumElements);
+    Set set;
+    double sumBytesPerElement = 0.0;
+    double minLoadAtGrow = 1.0;
+    auto lastNumBuckets = set.bucket_count();
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < MaxNumElements; ++i) {
+        keys[i] = makeKey(typename Set::hasher{}, rng, i, &prefix);
+        try {
+            set.insert(keys[i]);
+        } catch (std::overflow_error const&) {
+            std::cout << std::setw(44) << name << " overflow after " << i << " elements"
+                      << std::endl;
+            return;
+        }
+        if (set.bucket_count() != lastNumBuckets && lastNumBuckets >= 1024) {
+            minLoadAtGrow = (std::min)(minLoadAtGrow, static_cast<double>(i) /
+                                                          static_cast<double>(lastNumBuckets));
+        }
+        lastNumBuckets = set.bucket_count();
+        sumBytesPerElement +=
+            static_cast<double>(numBytesAllocated) / static_cast<double>(set.size());
+    }
+    std::cout << std::setw(44) << name << std::fixed << std::setprecision(2) << std::setw(16)
+              << sumBytesPerElement / static_cast<double>(MaxNumElements) << std::setw(16)
+              << minLoadAtGrow * 100.0 << std::endl;
+
+    uint64_t result = 0;
+    bench.run(name + " find hit", [&] {
+        for (size_t i = 0; i < NumLookups; ++i) {
+            result += set.count(keys[rng.uniform<uint64_t>(MaxNumElements)]);
+        }
+    });
+    bench.run(name + " find miss", [&] {
+        for (size_t i = 0; i < NumLookups; ++i) {
+            result += set.count(makeKey(typename Set::hasher{}, rng, 0, &prefix));
+        }
+    });
+    ankerl::nanobench::doNotOptimizeAway(result);
+}
+
+} // namespace
+
+// Sets of uint64_t with 8 bit and 16 bit info entries, at the default and at high load factors.
+TEST_CASE("bench_wide_info" * doctest::test_suite("nanobench") * doctest::skip()) {
+    using Hash = robin_hood::hash<uint64_t>;
+    using Eq = std::equal_to<uint64_t>;
+    using Alloc = CountingAllocator<char>;
+
+    ankerl::nanobench::Bench bench;
+    bench.title("2M uint64_t").unit("find").batch(NumLookups).relative(true);
+    bench.minEpochIterations(20);
+    std::cout << std::setw(44) << "" << std::setw(16) << "bytes/element" << std::setw(16)
+              << "min load% grow" << std::endl;
+    run<robin_hood::unordered_flat_set<uint64_t, Hash, Eq, 80, 200, Alloc>>(
+        bench, "unordered_flat_set 80%");
+    run<robin_hood::unordered_flat_set<uint64_t, Hash, Eq, 95, 200, Alloc>>(
+        bench, "unordered_flat_set 95%");
+    run<robin_hood::unordered_flat_set_wide_info<uint64_t, Hash, Eq, 90, 200, Alloc>>(
+        bench, "unordered_flat_set_wide_info 90%");
+    run<robin_hood::unordered_flat_set_wide_info<uint64_t, Hash, Eq, 95, 200, Alloc>>(
+        bench, "unordered_flat_set_wide_info 95%");
+}
+
+// Same with a weak hash that maps groups of keys to the same value. The probe sequences get so long
+// that the 8 bit infos overflow: the map grows while it is mostly empty, and throws once growing
+// doesn't help.
+TEST_CASE("bench_wide_info_weak_hash" * doctest::test_suite("nanobench") * doctest::skip()) {
+    using Eq = std::equal_to<uint64_t>;
+    using Alloc = CountingAllocator<char>;
+
+    ankerl::nanobench::Bench bench;
+    bench.title("2M uint64_t, weak hash").unit("find").batch(NumLookups).relative(true);
+    bench.minEpochIterations(5);
+    std::cout << std::setw(44) << "" << std::setw(16) << "bytes/element" << std::setw(16)
+              << "min load% grow" << std::endl;
+    run<robin_hood::unordered_flat_set<uint64_t, PrefixHash<3>, Eq, 80, 200, Alloc>>(
+        bench, "unordered_flat_set 80%, 8 per hash");
+    run<robin_hood::unordered_flat_set_wide_info<uint64_t, PrefixHash<3>, Eq, 80, 200, Alloc>>(
+        bench, "unordered_flat_set_wide_info 80%, 8 per hash");
+    run<robin_hood::unordered_flat_set<uint64_t, PrefixHash<4>, Eq, 80, 200, Alloc>>(
+        bench, "unordered_flat_set 80%, 16 per hash");
+    run<robin_hood::unordered_flat_set_wide_info<uint64_t, PrefixHash<4>, Eq, 80, 200, Alloc>>(
+        bench, "unordered_flat_set_wide_info 80%, 16 per hash");
+    run<robin_hood::unordered_flat_set<uint64_t, PrefixHash<5>, Eq, 80, 200, Alloc>>(
+        bench, "unordered_flat_set 80%, 32 per hash");
+    run<robin_hood::unordered_flat_set_wide_info<uint64_t, PrefixHash<5>, Eq, 80, 200, Alloc>>(
+        bench, "unordered_flat_set_wide_info 80%, 32 per hash");
+}
@@ -0,0 +1,210 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#    if __has_include(<memory_resource>)
+#        include <memory_resource>
+#        define ROBIN_HOOD_TEST_PMR 1
+#    endif
+#endif
+
+namespace {
+
+// Memory of one allocator "instance". Allocators compare equal when they share an Arena.
+struct Arena {
+    size_t numAllocs = 0;
+    size_t numBytes = 0;
+};
+
+template <typename T>
+class CountingAllocator {
+public:
+    using value_type = T;
+
+    explicit CountingAllocator(Arena* arena) noexcept
+        : mArena(arena) {}
+
+    template <typename U>
+    CountingAllocator(CountingAllocator<U> const& o) noexcept // NOLINT(google-explicit-constructor)
+        : mArena(o.arena()) {}
+
+    T* allocate(size_t n) {
+        ++mArena->numAllocs;
+        mArena->numBytes += n * sizeof(T);
+        return static_cast<T*>(std::malloc(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+        REQUIRE(mArena->numBytes >= n * sizeof(T));
+        mArena->numBytes -= n * sizeof(T);
+        std::free(ptr);
+    }
+
+    Arena* arena() const noexcept {
+        return mArena;
+    }
+
+private:
+    Arena* mArena;
+};
+
+template <typename T, typename U>
+bool operator==(CountingAllocator<T> const& a, CountingAllocator<U> const& b) noexcept {
+    return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(CountingAllocator<T> const& a, CountingAllocator<U> const& b) noexcept {
+    return !(a == b);
+}
+
+// Stateless, but its instances don't share memory.
+template <typename T>
+struct UnequalAllocator {
+    using value_type = T;
+    using is_always_equal = std::false_type;
+
+    UnequalAllocator() noexcept = default;
+
+    template <typename U>
+    UnequalAllocator(UnequalAllocator<U> const& /*unused*/) noexcept {} // NOLINT
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(std::malloc(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t /*unused*/) noexcept {
+        std::free(ptr);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(UnequalAllocator<T> const& /*unused*/,
+                UnequalAllocator<U> const& /*unused*/) noexcept {
+    return false;
+}
+
+template <typename T, typename U>
+bool operator!=(UnequalAllocator<T> const& /*unused*/,
+                UnequalAllocator<U> const& /*unused*/) noexcept {
+    return true;
+}
+
+} // namespace
+
+// with incremental rehash, so the old arrays are covered too
+using FlatMap =
+    robin_hood::unordered_flat_map_incremental<uint64_t, std::string, robin_hood::hash<uint64_t>,
+                                               std::equal_to<uint64_t>, 80, 200,
+                                               CountingAllocator<char>>;
+using NodeMap =
+    robin_hood::unordered_node_map_incremental<uint64_t, std::string, robin_hood::hash<uint64_t>,
+                                               std::equal_to<uint64_t>, 80, 200,
+                                               CountingAllocator<char>>;
+
+TYPE_TO_STRING(FlatMap);
+TYPE_TO_STRING(NodeMap);
+
+TEST_CASE_TEMPLATE("allocator", Map, FlatMap, NodeMap) {
+    Arena arena;
+    {
+        Map map(CountingAllocator<char>{&arena});
+        REQUIRE(map.get_allocator().arena() == &arena);
+        // the old arrays of an incremental rehash go through the allocator too
+        map.set_incremental_rehash(4);
+        for (uint64_t i = 0; i < 10000; ++i) {
+            map[i] = std::to_string(i);
+        }
+        for (uint64_t i = 0; i < 10000; i += 2) {
+            map.erase(i);
+        }
+        map.set_incremental_rehash(0);
+        map.compact();
+        REQUIRE(arena.numAllocs > 0U);
+        REQUIRE(arena.numBytes > 0U);
+
+        // copies use the same allocator
+        Map copy(map);
+        REQUIRE(copy == map);
+        REQUIRE(copy.get_allocator().arena() == &arena);
+        copy = map;
+        copy[1] = "x";
+
+        Map moved(std::move(copy));
+        REQUIRE(moved.size() == map.size());
+        moved.swap(map);
+        moved.clear();
+        moved.rehash(0);
+    }
+    // all memory was returned to the allocator
+    REQUIRE(arena.numBytes == 0U);
+}
+
+TEST_CASE_TEMPLATE("allocator_move_between_arenas", Map, FlatMap, NodeMap) {
+    Arena a;
+    Arena b;
+    {
+        Map mapA(CountingAllocator<char>{&a});
+        Map mapB(CountingAllocator<char>{&b});
+        for (uint64_t i = 0; i < 100; ++i) {
+            mapA[i] = std::to_string(i);
+        }
+        auto const bytesA = a.numBytes;
+
+        // the allocator doesn't propagate, so the entries are moved one by one
+        mapB = std::move(mapA);
+        REQUIRE(mapB.get_allocator().arena() == &b);
+        REQUIRE(mapB.size() == 100U);
+        REQUIRE(mapB[17] == "17");
+        REQUIRE(b.numBytes > 0U);
+        REQUIRE(a.numBytes <= bytesA);
+        REQUIRE(mapA.empty());
+
+        mapA[1000] = "still usable";
+        REQUIRE(mapA.size() == 1U);
+    }
+    REQUIRE(a.numBytes == 0U);
+    REQUIRE(b.numBytes == 0U);
+}
+
+TEST_CASE("allocator_move_noexcept") {
+    // move assignment allocates when the allocators differ, so it is only noexcept when they can't
+    using UnequalMap =
+        robin_hood::unordered_flat_map<uint64_t, std::string, robin_hood::hash<uint64_t>,
+                                       std::equal_to<uint64_t>, 80, 200, UnequalAllocator<char>>;
+    REQUIRE(std::is_nothrow_move_assignable<robin_hood::unordered_flat_map<int, int>>::value);
+    REQUIRE(!std::is_nothrow_move_assignable<FlatMap>::value);
+    REQUIRE(!std::is_nothrow_move_assignable<UnequalMap>::value);
+
+    UnequalMap a;
+    UnequalMap b;
+    a[1] = "one";
+    b = std::move(a);
+    REQUIRE(b.size() == 1U);
+    REQUIRE(b[1] == "one");
+}
+
+#if defined(ROBIN_HOOD_TEST_PMR)
+
+TEST_CASE("allocator_pmr") {
+    std::vector<char> buffer(1 << 20);
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(),
+                                              std::pmr::null_memory_resource());
+    robin_hood::unordered_node_map<uint64_t, uint64_t, robin_hood::hash<uint64_t>,
+                                   std::equal_to<uint64_t>, 80, 200,
+                                   std::pmr::polymorphic_allocator<char>>
+        map(&arena);
+    for (uint64_t i = 0; i < 1000; ++i) {
+        map[i] = i;
+    }
+    REQUIRE(map.size() == 1000U);
+    REQUIRE(map[500] == 500U);
+}
+
+#endif
@@ -0,0 +1,113 @@
+#include <robin_hood_concurrent.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// puts 16 consecutive keys into the same bucket, which gives long clusters that cross the
+// boundaries between regions, and overflowing info bytes.
+struct CollidingHash {
+    size_t operator()(uint64_t key) const noexcept {
+        return robin_hood::hash<uint64_t>{}(key / 16);
+    }
+};
+
+} // namespace
+
+TYPE_TO_STRING(robin_hood::unordered_flat_map<uint64_t, uint64_t>);
+TYPE_TO_STRING(robin_hood::unordered_node_map<uint64_t, uint64_t>);
+TYPE_TO_STRING(robin_hood::unordered_flat_map<uint64_t, uint64_t, CollidingHash>);
+TYPE_TO_STRING(robin_hood::unordered_flat_map<uint64_t, uint64_t, robin_hood::hash<uint64_t>,
+                                              std::equal_to<uint64_t>, 80, 150>);
+
+TEST_CASE_TEMPLATE("build_parallel" * doctest::test_suite("stochastic"), Map,
+                   robin_hood::unordered_flat_map<uint64_t, uint64_t>,
+                   robin_hood::unordered_node_map<uint64_t, uint64_t>,
+                   robin_hood::unordered_flat_map<uint64_t, uint64_t, CollidingHash>,
+                   robin_hood::unordered_flat_map<uint64_t, uint64_t, robin_hood::hash<uint64_t>,
+                                                  std::equal_to<uint64_t>, 80, 150>) {
+    sfc64 rng(123);
+    std::vector<std::pair<uint64_t, uint64_t>> data;
+    for (uint64_t i = 0; i < 300000; ++i) {
+        // about 5% duplicates
+        data.emplace_back(rng.uniform<uint64_t>(3000000), i);
+    }
+
+    for (size_t numThreads : {1U, 3U, 8U, 0U}) {
+        Map expected;
+        for (auto const& kv : data) {
+            expected.emplace(kv.first, kv.second);
+        }
+
+        Map map;
+        robin_hood::build_parallel(map, data.begin(), data.end(), numThreads);
+        REQUIRE(map.size() == expected.size());
+        for (auto const& kv : data) {
+            auto it = map.find(kv.first);
+            REQUIRE(it != map.end());
+            if (it->second != expected[kv.first]) {
+                // a duplicate, it's unspecified which one is inserted
+                REQUIRE(it->second != kv.second);
+            }
+        }
+
+        // the map is fully usable afterwards
+        for (uint64_t i = 0; i < 1000; ++i) {
+            map[i + 10000000] = i;
+            map.erase(data[i].first);
+        }
+        REQUIRE(map.size() == expected.size());
+    }
+}
+
+TEST_CASE("build_parallel_nonempty") {
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> map;
+    std::unordered_map<uint64_t, uint64_t> uo;
+    for (uint64_t i = 0; i < 100000; ++i) {
+        map[i * 3] = i;
+        uo[i * 3] = i;
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> data;
+    for (uint64_t i = 0; i < 200000; ++i) {
+        data.emplace_back(i * 5, 1);
+        uo.emplace(i * 5, 1);
+    }
+    robin_hood::build_parallel(map, data.begin(), data.end(), 4);
+    REQUIRE(map.size() == uo.size());
+    for (auto const& kv : uo) {
+        REQUIRE(map.find(kv.first)->second == kv.second);
+    }
+
+    robin_hood::build_parallel(map, data.end(), data.end(), 4);
+    REQUIRE(map.size() == uo.size());
+}
+
+TEST_CASE("build_parallel_set_and_strings") {
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < 100000; ++i) {
+        keys.push_back("some string that is not tiny " + std::to_string(i));
+    }
+
+    robin_hood::unordered_flat_set<std::string> set;
+    robin_hood::build_parallel(set, keys.begin(), keys.end(), 5);
+    REQUIRE(set.size() == keys.size());
+
+    robin_hood::unordered_node_map<std::string, size_t> map;
+    std::vector<std::pair<std::string, size_t>> data;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        data.emplace_back(keys[i], i);
+    }
+    robin_hood::build_parallel(map, data.begin(), data.end(), 5);
+    REQUIRE(map.size() == keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        REQUIRE(set.count(keys[i]) == 1U);
+        REQUIRE(map[keys[i]] == i);
+    }
+}
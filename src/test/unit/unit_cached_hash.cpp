@@ -0,0 +1,95 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+// counts how often the hash function was called
+struct CountingHash {
+    static size_t& numCalls() {
+        static size_t n = 0;
+        return n;
+    }
+
+    size_t operator()(std::string const& str) const {
+        ++numCalls();
+        return robin_hood::hash<std::string>{}(str);
+    }
+};
+
+} // namespace
+
+TEST_CASE("cached_hash_rehash_does_not_hash") {
+    robin_hood::unordered_node_map_cached_hash<std::string, size_t, CountingHash> map;
+    CountingHash::numCalls() = 0;
+    for (size_t i = 0; i < 10000; ++i) {
+        map[std::to_string(i)] = i;
+    }
+    // exactly one hash per insert, no matter how often the map has grown
+    REQUIRE(CountingHash::numCalls() == 10000U);
+
+    CountingHash::numCalls() = 0;
+    map.rehash(map.size() * 4);
+    REQUIRE(CountingHash::numCalls() == 0U);
+
+    // copies take over the stored hashes too
+    auto copy = map;
+    REQUIRE(CountingHash::numCalls() == 0U);
+    REQUIRE(copy == map);
+    for (size_t i = 0; i < 10000; ++i) {
+        REQUIRE(copy.find(std::to_string(i))->second == i);
+    }
+}
+
+TEST_CASE("cached_hash_random") {
+    robin_hood::unordered_node_map_cached_hash<std::string, uint64_t> map;
+    std::unordered_map<std::string, uint64_t> ref;
+    sfc64 rng(321);
+
+    for (size_t i = 0; i < 20000; ++i) {
+        auto key = std::to_string(rng.uniform<uint64_t>(2000));
+        switch (rng.uniform<uint64_t>(5)) {
+        case 0:
+            REQUIRE(map.erase(key) == ref.erase(key));
+            break;
+        case 1:
+            REQUIRE(map.emplace(key, i).second == ref.emplace(key, i).second);
+            break;
+        case 2: {
+            auto isNew = ref.find(key) == ref.end();
+            ref[key] = i;
+            REQUIRE(map.insert_or_assign(key, i).second == isNew);
+            break;
+        }
+        case 3: {
+            auto isNew = ref.emplace(key, i).second;
+            REQUIRE(map.try_emplace(std::move(key), i).second == isNew);
+            break;
+        }
+        default:
+            map[key] = i;
+            ref[key] = i;
+            break;
+        }
+        REQUIRE(map.size() == ref.size());
+    }
+
+    for (auto const& kv : ref) {
+        auto it = map.find(kv.first);
+        REQUIRE(it != map.end());
+        REQUIRE(it->second == kv.second);
+    }
+
+    robin_hood::unordered_node_set_cached_hash<std::string> set;
+    for (auto const& kv : ref) {
+        REQUIRE(set.insert(kv.first).second);
+    }
+    for (auto const& kv : ref) {
+        REQUIRE(set.count(kv.first) == 1U);
+    }
+    REQUIRE(set.count("not in there") == 0U);
+}
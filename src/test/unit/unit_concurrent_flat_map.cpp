@@ -0,0 +1,184 @@
+#include <robin_hood_concurrent.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+TEST_CASE("concurrent_flat_map") {
+    robin_hood::concurrent_flat_map<std::string, int> map;
+    REQUIRE(map.empty());
+
+    REQUIRE(map.insert({"a", 1}));
+    REQUIRE(!map.insert({"a", 2}));
+    REQUIRE(map.try_emplace("b", 2));
+    REQUIRE(!map.try_emplace("b", 3));
+    REQUIRE(map.insert_or_assign("c", 3));
+    REQUIRE(!map.insert_or_assign("c", 4));
+    REQUIRE(map.size() == 3U);
+
+    int value = 0;
+    REQUIRE(map.visit("c", [&](robin_hood::pair<std::string, int> const& kv) {
+        value = kv.second;
+    }) == 1U);
+    REQUIRE(value == 4);
+    REQUIRE(map.visit("x", [&](robin_hood::pair<std::string, int> const&) { value = 0; }) == 0U);
+    REQUIRE(value == 4);
+
+    // insert_or_visit can modify the existing value
+    REQUIRE(!map.insert_or_visit({"a", 100}, [](robin_hood::pair<std::string, int>& kv) {
+        kv.second += 10;
+    }));
+    REQUIRE(map.insert_or_visit({"d", 5}, [](robin_hood::pair<std::string, int>&) {}));
+    auto const& cmap = map;
+    REQUIRE(cmap.visit("a", [&](robin_hood::pair<std::string, int> const& kv) {
+        value = kv.second;
+    }) == 1U);
+    REQUIRE(value == 11);
+
+    REQUIRE(map.contains("d"));
+    REQUIRE(map.count("d") == 1U);
+    REQUIRE(map.erase("d") == 1U);
+    REQUIRE(map.erase("d") == 0U);
+    REQUIRE(!map.contains("d"));
+
+    int sum = 0;
+    cmap.visit_all([&](robin_hood::pair<std::string, int> const& kv) { sum += kv.second; });
+    REQUIRE(sum == 11 + 2 + 4);
+
+    REQUIRE(map.erase_if([](robin_hood::pair<std::string, int> const& kv) {
+        return kv.second < 10;
+    }) == 2U);
+    REQUIRE(map.size() == 1U);
+    map.clear();
+    REQUIRE(map.empty());
+}
+
+TEST_CASE("concurrent_flat_map_shards") {
+    // all shards are used, also with a number of shards that is not a power of two
+    robin_hood::concurrent_flat_map<uint64_t, uint64_t, 7> map;
+    map.reserve(10000);
+    for (uint64_t i = 0; i < 10000; ++i) {
+        REQUIRE(map.insert({i, i}));
+    }
+    REQUIRE(map.size() == 10000U);
+    for (uint64_t i = 0; i < 10000; ++i) {
+        REQUIRE(map.contains(i));
+    }
+}
+
+namespace {
+
+// Counts the blocks that are currently allocated.
+template <typename T>
+class BlockCountingAllocator {
+public:
+    using value_type = T;
+
+    explicit BlockCountingAllocator(std::atomic<size_t>* numBlocks) noexcept
+        : mNumBlocks(numBlocks) {}
+
+    template <typename U>
+    BlockCountingAllocator(BlockCountingAllocator<U> const& o) noexcept // NOLINT
+        : mNumBlocks(o.numBlocks()) {}
+
+    T* allocate(size_t n) {
+        ++*mNumBlocks;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+        --*mNumBlocks;
+        std::allocator<T>().deallocate(ptr, n);
+    }
+
+    std::atomic<size_t>* numBlocks() const noexcept {
+        return mNumBlocks;
+    }
+
+private:
+    std::atomic<size_t>* mNumBlocks;
+};
+
+template <typename T, typename U>
+bool operator==(BlockCountingAllocator<T> const& a, BlockCountingAllocator<U> const& b) noexcept {
+    return a.numBlocks() == b.numBlocks();
+}
+
+template <typename T, typename U>
+bool operator!=(BlockCountingAllocator<T> const& a, BlockCountingAllocator<U> const& b) noexcept {
+    return !(a == b);
+}
+
+// Consecutive keys give consecutive hashes, the map has to mix them to select the shard.
+struct IdentityHash {
+    size_t operator()(uint64_t key) const noexcept {
+        return static_cast<size_t>(key);
+    }
+};
+
+} // namespace
+
+TEST_CASE("concurrent_flat_map_allocator") {
+    using Alloc = BlockCountingAllocator<char>;
+    std::atomic<size_t> numBlocks{0};
+    {
+        robin_hood::concurrent_flat_map<uint64_t, uint64_t, 7, IdentityHash,
+                                        std::equal_to<uint64_t>, 80, Alloc>
+            map{Alloc(&numBlocks)};
+        REQUIRE(map.get_allocator() == Alloc(&numBlocks));
+        REQUIRE(numBlocks == 0U);
+        for (uint64_t i = 0; i < 1000; ++i) {
+            REQUIRE(map.insert({i, i}));
+        }
+        // each shard got some of the keys, and holds one block with its arrays
+        REQUIRE(numBlocks == 7U);
+        for (uint64_t i = 0; i < 1000; ++i) {
+            REQUIRE(map.contains(i));
+        }
+    }
+    REQUIRE(numBlocks == 0U);
+}
+
+TEST_CASE("concurrent_flat_map_threads") {
+    static constexpr size_t NumThreads = 4;
+    static constexpr uint64_t NumKeys = 20000;
+    robin_hood::concurrent_flat_map<uint64_t, uint64_t> map;
+
+    // each thread counts all keys, and visits keys it owns once in a while.
+    std::vector<std::thread> threads;
+    std::vector<size_t> numVisited(NumThreads);
+    for (size_t t = 0; t < NumThreads; ++t) {
+        threads.emplace_back([&map, &numVisited, t] {
+            sfc64 rng(t);
+            for (uint64_t i = 0; i < NumKeys; ++i) {
+                map.insert_or_visit({i, UINT64_C(1)}, [](robin_hood::pair<uint64_t, uint64_t>& kv) {
+                    ++kv.second;
+                });
+                auto const k = rng.uniform<uint64_t>(NumKeys);
+                if (k % NumThreads == t && rng.uniform<uint64_t>(10) == 0) {
+                    numVisited[t] += map.visit(k, [](robin_hood::pair<uint64_t, uint64_t>& kv) {
+                        kv.second += 1000000;
+                    });
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    REQUIRE(map.size() == NumKeys);
+    uint64_t sum = 0;
+    map.visit_all([&](robin_hood::pair<uint64_t, uint64_t> const& kv) { sum += kv.second; });
+    size_t totalVisits = 0;
+    for (auto n : numVisited) {
+        totalVisits += n;
+    }
+    REQUIRE(sum == NumKeys * NumThreads + totalVisits * 1000000);
+}
@@ -0,0 +1,161 @@
+#include <robin_hood.h>
+
+#include <app/CtorDtorVerifier.h>
+#include <app/checksum.h>
+#include <app/doctest.h>
+#include <app/sfc64.h>
+
+#include <stdexcept>
+#include <unordered_map>
+
+TYPE_TO_STRING(robin_hood::unordered_flat_map<uint64_t, uint64_t>);
+TYPE_TO_STRING(robin_hood::unordered_node_map<uint64_t, uint64_t>);
+TYPE_TO_STRING(robin_hood::unordered_flat_map<CtorDtorVerifier, CtorDtorVerifier>);
+TYPE_TO_STRING(robin_hood::unordered_node_map<CtorDtorVerifier, CtorDtorVerifier>);
+
+TEST_CASE_TEMPLATE("erase_if_random" * doctest::test_suite("stochastic"), Map,
+                   robin_hood::unordered_flat_map<uint64_t, uint64_t>,
+                   robin_hood::unordered_node_map<uint64_t, uint64_t>) {
+    sfc64 rng(123);
+    for (uint64_t numKeys : {0U, 1U, 7U, 100U, 10000U}) {
+        Map rh;
+        std::unordered_map<uint64_t, uint64_t> uo;
+        for (uint64_t i = 0; i < numKeys; ++i) {
+            // keys in a small range give long clusters
+            auto const key = rng.uniform<uint64_t>(numKeys * 2 + 1);
+            rh[key] = i;
+            uo[key] = i;
+        }
+
+        // erase about a third each round, until nothing is left
+        while (!uo.empty()) {
+            auto const mod = rng.uniform<uint64_t>(3) + 2;
+            auto pred = [mod](std::pair<uint64_t const, uint64_t> const& kv) {
+                return kv.second % mod == 0;
+            };
+            size_t numErased = 0;
+            for (auto it = uo.begin(); it != uo.end();) {
+                if (pred(*it)) {
+                    it = uo.erase(it);
+                    ++numErased;
+                } else {
+                    ++it;
+                }
+            }
+            REQUIRE(robin_hood::erase_if(rh, [mod](typename Map::value_type const& kv) {
+                        return kv.second % mod == 0;
+                    }) == numErased);
+            REQUIRE(rh.size() == uo.size());
+            for (auto const& kv : uo) {
+                REQUIRE(rh.find(kv.first) != rh.end());
+                REQUIRE(rh.find(kv.first)->second == kv.second);
+            }
+            REQUIRE(checksum::map(rh) == checksum::map(uo));
+
+            // the map is still fully usable
+            for (auto& kv : uo) {
+                kv.second /= mod;
+                rh[kv.first] = kv.second;
+            }
+            if (uo.size() < 3) {
+                REQUIRE(robin_hood::erase_if(rh, [](typename Map::value_type const&) {
+                            return true;
+                        }) == uo.size());
+                uo.clear();
+            }
+        }
+        REQUIRE(rh.empty());
+        REQUIRE(rh.begin() == rh.end());
+    }
+}
+
+TEST_CASE_TEMPLATE("retain", Map, robin_hood::unordered_flat_map<uint64_t, uint64_t>,
+                   robin_hood::unordered_node_map<uint64_t, uint64_t>) {
+    Map map;
+    REQUIRE(map.retain([](typename Map::value_type const&) { return false; }) == 0U);
+    for (uint64_t i = 0; i < 1000; ++i) {
+        map[i] = i;
+    }
+    REQUIRE(map.retain([](typename Map::value_type const& kv) { return kv.first < 10; }) == 990U);
+    REQUIRE(map.size() == 10U);
+    for (uint64_t i = 0; i < 10; ++i) {
+        REQUIRE(map.count(i) == 1U);
+    }
+}
+
+TEST_CASE_TEMPLATE("retain_rehash_pending", Map,
+                   robin_hood::unordered_flat_map_incremental<uint64_t, uint64_t>,
+                   robin_hood::unordered_node_map_incremental<uint64_t, uint64_t>) {
+    // a pending incremental rehash is finished first
+    Map map;
+    map.set_incremental_rehash(1);
+    uint64_t i = 0;
+    while (!map.rehash_pending()) {
+        map[i] = i;
+        ++i;
+    }
+    auto const numBefore = map.size();
+    REQUIRE(map.retain([](typename Map::value_type const& kv) { return kv.first % 2 == 0; }) ==
+            numBefore / 2);
+    REQUIRE(!map.rehash_pending());
+    REQUIRE(map.size() == numBefore - numBefore / 2);
+}
+
+TEST_CASE("retain_set") {
+    robin_hood::unordered_flat_set<int> set;
+    for (int i = 0; i < 100; ++i) {
+        set.insert(i);
+    }
+    REQUIRE(robin_hood::erase_if(set, [](int i) { return i >= 50; }) == 50U);
+    REQUIRE(set.size() == 50U);
+    REQUIRE(set.count(49) == 1U);
+    REQUIRE(set.count(50) == 0U);
+}
+
+TEST_CASE_TEMPLATE("erase_if_ctor_dtor", Map,
+                   robin_hood::unordered_flat_map<CtorDtorVerifier, CtorDtorVerifier>,
+                   robin_hood::unordered_node_map<CtorDtorVerifier, CtorDtorVerifier>) {
+    {
+        Map map;
+        for (uint64_t i = 0; i < 1000; ++i) {
+            map[i] = i * 3;
+        }
+        REQUIRE(robin_hood::erase_if(map, [](typename Map::value_type const& kv) {
+                    return kv.first.val() % 3 != 0;
+                }) == 666U);
+        REQUIRE(map.size() == 334U);
+        for (uint64_t i = 0; i < 1000; i += 3) {
+            REQUIRE(map.find(i)->second.val() == i * 3);
+        }
+    }
+    REQUIRE(CtorDtorVerifier::mapSize() == static_cast<size_t>(0));
+}
+
+#if ROBIN_HOOD(HAS_EXCEPTIONS)
+
+TEST_CASE_TEMPLATE("erase_if_throws", Map, robin_hood::unordered_flat_map<uint64_t, uint64_t>,
+                   robin_hood::unordered_node_map<uint64_t, uint64_t>) {
+    Map map;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        map[i * 7] = i;
+    }
+
+    // everything before the throw is erased, the rest is kept and still found
+    size_t numCalls = 0;
+    REQUIRE_THROWS_AS(robin_hood::erase_if(map,
+                                           [&numCalls](typename Map::value_type const&) {
+                                               if (++numCalls == 500) {
+                                                   throw std::runtime_error("pred");
+                                               }
+                                               return true;
+                                           }),
+                      std::runtime_error);
+    REQUIRE(map.size() == 501U);
+    size_t numFound = 0;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        numFound += map.count(i * 7);
+    }
+    REQUIRE(numFound == 501U);
+}
+
+#endif
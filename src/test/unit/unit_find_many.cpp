@@ -0,0 +1,49 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+
+#include <vector>
+
+TYPE_TO_STRING(robin_hood::unordered_flat_map<uint64_t, uint64_t>);
+TYPE_TO_STRING(robin_hood::unordered_node_map<uint64_t, uint64_t>);
+
+TEST_CASE_TEMPLATE("find_many", Map, robin_hood::unordered_flat_map<uint64_t, uint64_t>,
+                   robin_hood::unordered_node_map<uint64_t, uint64_t>) {
+    Map map;
+    Map const& cmap = map;
+
+    std::vector<uint64_t> keys{1, 2, 3};
+    std::vector<typename Map::iterator> its(keys.size());
+    REQUIRE(map.find_many(keys.begin(), keys.end(), its.begin()) == its.end());
+    for (auto const& it : its) {
+        REQUIRE(it == map.end());
+    }
+    REQUIRE(map.contains_many(keys.begin(), keys.end()) == 0U);
+
+    sfc64 rng(123);
+    for (uint64_t i = 0; i < 1000; ++i) {
+        map[rng.uniform<uint64_t>(2000)] = i;
+    }
+
+    // more keys than a single batch
+    keys.clear();
+    for (uint64_t i = 0; i < 2000; ++i) {
+        keys.push_back(i);
+    }
+    std::vector<typename Map::const_iterator> cits;
+    cmap.find_many(keys.begin(), keys.end(), std::back_inserter(cits));
+    REQUIRE(cits.size() == keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        REQUIRE(cits[i] == cmap.find(keys[i]));
+    }
+
+    for (size_t i = 0; i + 64 <= keys.size(); i += 64) {
+        auto const bits = map.contains_many(keys.begin() + static_cast<std::ptrdiff_t>(i),
+                                            keys.begin() + static_cast<std::ptrdiff_t>(i + 64));
+        for (size_t j = 0; j < 64; ++j) {
+            REQUIRE(((bits >> j) & 1U) == map.count(keys[i + j]));
+        }
+    }
+    REQUIRE_THROWS_AS((void)map.contains_many(keys.begin(), keys.begin() + 65), std::length_error);
+}
@@ -0,0 +1,87 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+
+#include <unordered_map>
+
+TYPE_TO_STRING(robin_hood::unordered_flat_map<uint64_t, uint64_t, robin_hood::hash<uint64_t>,
+                                              std::equal_to<uint64_t>, 80, 150>);
+TYPE_TO_STRING(robin_hood::unordered_node_map<uint64_t, uint64_t, robin_hood::hash<uint64_t>,
+                                              std::equal_to<uint64_t>, 80, 125>);
+
+TEST_CASE("mulhi") {
+    using robin_hood::detail::mulhi;
+    REQUIRE(mulhi(UINT64_C(12345), 1) == 0U);
+    REQUIRE(mulhi(UINT64_C(1) << 63U, 6) == 3U);
+    REQUIRE(mulhi(UINT64_C(0xffffffffffffffff), UINT64_C(0xffffffffffffffff)) ==
+            UINT64_C(0xfffffffffffffffe));
+    REQUIRE(mulhi(UINT64_C(0x123456789abcdef0), UINT64_C(0x0fedcba987654321)) ==
+            UINT64_C(0x0121fa00ad77d742));
+
+    sfc64 rng(123);
+    for (size_t i = 0; i < 1000; ++i) {
+        auto const a = rng();
+        auto const b = rng.uniform<uint64_t>(1000000) + 1;
+        REQUIRE(mulhi(a, b) < b);
+        REQUIRE(mulhi(a, UINT64_C(1) << 20U) == a >> 44U);
+    }
+}
+
+TEST_CASE_TEMPLATE("growth_factor", Map,
+                   robin_hood::unordered_flat_map<uint64_t, uint64_t, robin_hood::hash<uint64_t>,
+                                                  std::equal_to<uint64_t>, 80, 150>,
+                   robin_hood::unordered_node_map<uint64_t, uint64_t, robin_hood::hash<uint64_t>,
+                                                  std::equal_to<uint64_t>, 80, 125>) {
+    Map map;
+    REQUIRE(map.bucket_count() == 0U);
+
+    // reserve allocates just as much as necessary
+    map.reserve(1000);
+    REQUIRE(map.bucket_count() == 1250U);
+    map.reserve(1001);
+    REQUIRE(map.bucket_count() == 1252U);
+    map.compact();
+    REQUIRE(map.bucket_count() == 8U);
+
+    // grows by the growth factor, not by 2
+    size_t numBuckets = map.bucket_count();
+    size_t numGrows = 0;
+    for (uint64_t i = 0; i < 100000; ++i) {
+        map[i] = i;
+        if (map.bucket_count() != numBuckets) {
+            REQUIRE(map.bucket_count() < numBuckets * 2);
+            numBuckets = map.bucket_count();
+            ++numGrows;
+        }
+    }
+    REQUIRE(numGrows > 20U);
+    REQUIRE(map.load_factor() > 0.4F);
+
+    // compare with std::unordered_map
+    std::unordered_map<uint64_t, uint64_t> uo;
+    for (auto const& kv : map) {
+        uo[kv.first] = kv.second;
+    }
+    sfc64 rng(321);
+    for (size_t i = 0; i < 200000; ++i) {
+        auto const key = rng.uniform<uint64_t>(200000);
+        if (rng.uniform<uint64_t>(3) == 0) {
+            REQUIRE(map.erase(key) == uo.erase(key));
+        } else {
+            map[key] = i;
+            uo[key] = i;
+        }
+        REQUIRE(map.size() == uo.size());
+    }
+    for (auto const& kv : uo) {
+        REQUIRE(map.find(kv.first)->second == kv.second);
+    }
+    REQUIRE(map.count(200001) == 0U);
+
+    map.compact();
+    REQUIRE(map.bucket_count() == (map.size() * 100 + 79) / 80);
+    for (auto const& kv : uo) {
+        REQUIRE(map.find(kv.first)->second == kv.second);
+    }
+}
@@ -0,0 +1,161 @@
+#include <robin_hood.h>
+
+#include <app/avalanche.h>
+#include <app/doctest.h>
+#include <app/sfc64.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// Root mean squared deviation of the probability that an output bit flips when an input bit flips,
+// from the ideal 0.5. The map mixes the hash once more in hashToIdx, so that's done here as well.
+template <typename Op>
+double avalancheBias(Op const& op) {
+    static constexpr uint64_t NumIters = 10000;
+    Avalanche a;
+    a.eval(NumIters, [&op](uint64_t x) {
+        auto h = static_cast<uint64_t>(op(x));
+        h *= UINT64_C(0xc4ceb9fe1a85ec53);
+        h ^= h >> 33U;
+        return h;
+    });
+    return std::sqrt(static_cast<double>(a.rms()) / (64.0 * 64.0)) /
+           static_cast<double>(NumIters * 3);
+}
+
+// Computed during static initialization, before main().
+bool const staticHasHwHash = robin_hood::has_hw_hash();
+size_t const staticHashIntHw = robin_hood::hash_int_hw(UINT64_C(123));
+size_t const staticHashBytesHw = robin_hood::hash_bytes_hw("static initialization", 21);
+
+} // namespace
+
+TEST_CASE("hash_hw_static_init") {
+    // has_hw_hash() gives the same answer before main(), so the hashes match
+    REQUIRE(staticHasHwHash == robin_hood::has_hw_hash());
+    REQUIRE(staticHashIntHw == robin_hood::hash_int_hw(UINT64_C(123)));
+    REQUIRE(staticHashBytesHw == robin_hood::hash_bytes_hw("static initialization", 21));
+}
+
+TEST_CASE("hash_hw_avalanche") {
+    // about 0.003 for a perfectly random hash with this number of samples
+    REQUIRE(avalancheBias([](uint64_t x) { return robin_hood::hash_int(x); }) < 0.006);
+    REQUIRE(avalancheBias([](uint64_t x) { return robin_hood::hash_int_hw(x); }) < 0.006);
+
+    // 8 bytes at the end of the data, so they are read by the last block
+    for (size_t len : {8U, 12U, 16U, 17U, 24U, 40U, 64U, 65U, 100U, 1000U}) {
+        CAPTURE(len);
+        std::vector<uint8_t> data(len, 'x');
+        auto const withInput = [&data](uint64_t x) {
+            std::memcpy(data.data() + data.size() - sizeof(x), &x, sizeof(x));
+            return data.data();
+        };
+        REQUIRE(avalancheBias([&](uint64_t x) {
+                    return robin_hood::hash_bytes(withInput(x), data.size());
+                }) < 0.006);
+        REQUIRE(avalancheBias([&](uint64_t x) {
+                    return robin_hood::hash_bytes_hw(withInput(x), data.size());
+                }) < 0.006);
+    }
+}
+
+TEST_CASE("hash_hw_bytes") {
+    // every byte of the data and its length count
+    std::string str;
+    std::vector<size_t> hashes;
+    for (size_t len = 0; len < 300; ++len) {
+        auto const h = robin_hood::hash_hw<std::string>{}(str);
+        REQUIRE(h == robin_hood::hash_bytes_hw(str.data(), str.size()));
+        for (size_t i = 0; i < len; ++i) {
+            CAPTURE(i);
+            str[i] = static_cast<char>(str[i] ^ 1);
+            REQUIRE(robin_hood::hash_hw<std::string>{}(str) != h);
+            str[i] = static_cast<char>(str[i] ^ 1);
+        }
+        hashes.push_back(h);
+        str.push_back('\0');
+    }
+    std::sort(hashes.begin(), hashes.end());
+    REQUIRE(std::unique(hashes.begin(), hashes.end()) == hashes.end());
+
+    if (!robin_hood::has_hw_hash()) {
+        REQUIRE(robin_hood::hash_bytes_hw(str.data(), str.size()) ==
+                robin_hood::hash_bytes(str.data(), str.size()));
+        REQUIRE(robin_hood::hash_int_hw(123) == robin_hood::hash_int(123));
+    }
+}
+
+TEST_CASE("hash_hw_injective") {
+    // two plain CRC32C rounds are linear with rank 63, so these pairs used to collide
+    static constexpr uint64_t Kernel = UINT64_C(0xfca42daffca42daf);
+    sfc64 rng(123);
+    std::vector<size_t> hashes;
+    for (uint64_t i = 0; i < 100000; ++i) {
+        auto const x = i < 50000 ? i : rng();
+        REQUIRE(robin_hood::hash_int_hw(x) != robin_hood::hash_int_hw(x ^ Kernel));
+        hashes.push_back(robin_hood::hash_int_hw(x));
+        hashes.push_back(robin_hood::hash_int_hw(x << 32U));
+    }
+    std::sort(hashes.begin(), hashes.end());
+    REQUIRE(std::unique(hashes.begin(), hashes.end()) - hashes.begin() == 199999);
+
+    // same for 8 bytes of data, with the first 4 bytes changed
+    std::string a = "abcdefgh";
+    std::string b = a;
+    auto const k = static_cast<uint32_t>(Kernel);
+    for (size_t i = 0; i < 4; ++i) {
+        b[i] = static_cast<char>(b[i] ^ static_cast<char>(k >> (8 * i)));
+    }
+    REQUIRE(robin_hood::hash_bytes_hw(a.data(), a.size()) !=
+            robin_hood::hash_bytes_hw(b.data(), b.size()));
+    // distinct data of the same length. Up to 8 bytes this is guaranteed to be collision free.
+    for (size_t len = 1; len <= 16; ++len) {
+        CAPTURE(len);
+        hashes.clear();
+        auto const n = len < 2 ? uint64_t(256) : uint64_t(10000);
+        for (uint64_t i = 0; i < n; ++i) {
+            std::string str(len, 'x');
+            std::memcpy(&str[0], &i, (std::min)(len, sizeof(i)));
+            hashes.push_back(robin_hood::hash_bytes_hw(str.data(), str.size()));
+            if (len > 8) {
+                std::string other(len, 'y');
+                std::memcpy(&other[len - sizeof(i)], &i, sizeof(i));
+                hashes.push_back(robin_hood::hash_bytes_hw(other.data(), other.size()));
+            }
+        }
+        std::sort(hashes.begin(), hashes.end());
+        REQUIRE(std::unique(hashes.begin(), hashes.end()) == hashes.end());
+    }
+}
+
+TEST_CASE("hash_hw_map") {
+    robin_hood::unordered_flat_map<std::string, size_t, robin_hood::hash_hw<std::string>> map;
+    robin_hood::unordered_flat_map<uint64_t, size_t, robin_hood::hash_hw<uint64_t>> intMap;
+    robin_hood::unordered_flat_map<int*, size_t, robin_hood::hash_hw<int*>> ptrMap;
+    std::unordered_map<std::string, size_t> ref;
+    sfc64 rng(123);
+    for (size_t i = 0; i < 20000; ++i) {
+        auto const x = rng();
+        auto key = std::to_string(x);
+        key.resize(rng.uniform<size_t>(100), '-');
+        map[key] = i;
+        ref[key] = i;
+        intMap[i * 1024] = i;
+        ptrMap[reinterpret_cast<int*>(static_cast<uintptr_t>(x & ~UINT64_C(7)))] = i;
+    }
+    REQUIRE(map.size() == ref.size());
+    for (auto const& kv : ref) {
+        REQUIRE(map.at(kv.first) == kv.second);
+    }
+    REQUIRE(intMap.size() == 20000U);
+    for (size_t i = 0; i < 20000; ++i) {
+        REQUIRE(intMap.at(i * 1024) == i);
+    }
+    REQUIRE(ptrMap.size() == 20000U);
+}
@@ -0,0 +1,43 @@
+#include <robin_hood_os.h>
+
+#include <app/doctest.h>
+
+#include <string>
+
+#if ROBIN_HOOD(HAS_MMAP)
+
+// small thresholds so that the tables are mapped, and the node pools use both paths
+using HugeMap =
+    robin_hood::unordered_node_map<uint64_t, std::string, robin_hood::hash<uint64_t>,
+                                   std::equal_to<uint64_t>, 80, 200,
+                                   robin_hood::huge_page_allocator<char, 4096>>;
+using HugePrefaultMap =
+    robin_hood::unordered_flat_map<uint64_t, uint64_t, robin_hood::hash<uint64_t>,
+                                   std::equal_to<uint64_t>, 80, 200,
+                                   robin_hood::huge_page_allocator<char, 4096, true>>;
+
+TYPE_TO_STRING(HugeMap);
+TYPE_TO_STRING(HugePrefaultMap);
+
+TEST_CASE_TEMPLATE("huge_page_allocator", Map, HugeMap, HugePrefaultMap) {
+    Map map;
+    map.reserve(50000);
+    for (uint64_t i = 0; i < 100000; ++i) {
+        map[i];
+    }
+    for (uint64_t i = 0; i < 100000; i += 3) {
+        REQUIRE(map.erase(i) == 1U);
+    }
+    Map copy = map;
+    REQUIRE(copy == map);
+    map.compact();
+    REQUIRE(map.size() == 66666U);
+    for (uint64_t i = 0; i < 100000; ++i) {
+        REQUIRE(map.contains(i) == (i % 3 != 0));
+    }
+    map.clear();
+    map.rehash(0);
+    REQUIRE(map.empty());
+}
+
+#endif
@@ -0,0 +1,259 @@
+#include <robin_hood.h>
+
+#include <app/CtorDtorVerifier.h>
+#include <app/checksum.h>
+#include <app/doctest.h>
+#include <app/sfc64.h>
+
+#include <iterator>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+
+TYPE_TO_STRING(robin_hood::unordered_flat_map_incremental<uint64_t, uint64_t>);
+TYPE_TO_STRING(robin_hood::unordered_node_map_incremental<uint64_t, uint64_t>);
+TYPE_TO_STRING(robin_hood::unordered_flat_map_incremental<CtorDtorVerifier, CtorDtorVerifier>);
+TYPE_TO_STRING(robin_hood::unordered_node_map_incremental<CtorDtorVerifier, CtorDtorVerifier>);
+
+namespace {
+
+// inserts 0, 1, 2, ... until the map has started an incremental rehash.
+template <typename Map>
+uint64_t fillUntilPending(Map& map) {
+    uint64_t i = 0;
+    while (!map.rehash_pending()) {
+        map[i] = i;
+        ++i;
+    }
+    return i;
+}
+
+} // namespace
+
+TEST_CASE_TEMPLATE("incremental_rehash_random" * doctest::test_suite("stochastic"), Map,
+                   robin_hood::unordered_flat_map_incremental<uint64_t, uint64_t>,
+                   robin_hood::unordered_node_map_incremental<uint64_t, uint64_t>) {
+    Map rh;
+    rh.set_incremental_rehash(1);
+    std::unordered_map<uint64_t, uint64_t> uo;
+    sfc64 rng(987);
+
+    size_t numPending = 0;
+    for (uint64_t i = 0; i < 50000; ++i) {
+        auto const k = rng.uniform<uint64_t>(20000);
+        if (rng.uniform<uint64_t>(4) == 0) {
+            REQUIRE(rh.erase(k) == uo.erase(k));
+        } else {
+            rh[k] = i;
+            uo[k] = i;
+        }
+        if (rh.rehash_pending()) {
+            ++numPending;
+        }
+
+        auto const q = rng.uniform<uint64_t>(20000);
+        auto it = rh.find(q);
+        auto uit = uo.find(q);
+        REQUIRE((it == rh.end()) == (uit == uo.end()));
+        if (uit != uo.end()) {
+            REQUIRE(it->second == uit->second);
+        }
+        REQUIRE(rh.count(q) == uo.count(q));
+        REQUIRE(rh.size() == uo.size());
+    }
+    REQUIRE(numPending > 0);
+
+    REQUIRE(checksum::map(rh) == checksum::map(uo));
+    rh.finish_rehash();
+    REQUIRE(!rh.rehash_pending());
+    REQUIRE(checksum::map(rh) == checksum::map(uo));
+}
+
+TEST_CASE_TEMPLATE("incremental_rehash_pending", Map,
+                   robin_hood::unordered_flat_map_incremental<uint64_t, uint64_t>,
+                   robin_hood::unordered_node_map_incremental<uint64_t, uint64_t>) {
+    Map map;
+    map.set_incremental_rehash(4);
+    auto const num = fillUntilPending(map);
+    REQUIRE(map.size() == num);
+
+    // lookups see everything, wherever it is
+    Map const& cmap = map;
+    for (uint64_t i = 0; i < num; ++i) {
+        REQUIRE(cmap.find(i) != cmap.end());
+        REQUIRE(cmap.find(i)->second == i);
+        REQUIRE(map.at(i) == i);
+    }
+    REQUIRE(map.find(num) == map.end());
+    REQUIRE(map.rehash_pending());
+
+    // find() can return an iterator into the old arrays, it can be erased and incremented
+    auto it = map.find(0);
+    REQUIRE(it != map.end());
+    it = map.erase(it);
+    REQUIRE(map.count(0) == 0);
+    REQUIRE(map.size() == num - 1);
+    while (it != map.end()) {
+        ++it;
+    }
+    REQUIRE(map.rehash_pending());
+
+    // iteration walks both arrays, without moving anything
+    size_t numIterated = 0;
+    for (auto const& kv : cmap) {
+        REQUIRE(kv.first == kv.second);
+        ++numIterated;
+    }
+    REQUIRE(numIterated == num - 1);
+    REQUIRE(static_cast<size_t>(std::distance(map.begin(), map.end())) == num - 1);
+    REQUIRE(map.rehash_pending());
+
+    // moves and copies take the pending rehash along
+    auto moved = std::move(map);
+    REQUIRE(moved.rehash_pending());
+    auto copy = moved;
+    REQUIRE(moved.rehash_pending());
+    REQUIRE(copy.rehash_pending());
+    REQUIRE(copy.size() == num - 1);
+    REQUIRE(moved == copy);
+    copy.finish_rehash();
+    REQUIRE(!copy.rehash_pending());
+    REQUIRE(moved == copy);
+
+    // switching it off finishes it
+    fillUntilPending(copy);
+    copy.set_incremental_rehash(0);
+    REQUIRE(!copy.rehash_pending());
+    copy[12345678] = 1;
+    REQUIRE(!copy.rehash_pending());
+}
+
+TEST_CASE_TEMPLATE("incremental_rehash_ctor_dtor", Map,
+                   robin_hood::unordered_flat_map_incremental<CtorDtorVerifier, CtorDtorVerifier>,
+                   robin_hood::unordered_node_map_incremental<CtorDtorVerifier, CtorDtorVerifier>) {
+    {
+        Map a;
+        a.set_incremental_rehash(2);
+        uint64_t i = 0;
+        while (!a.rehash_pending()) {
+            a[i] = i;
+            ++i;
+        }
+        a.erase(1);
+        a.erase(a.find(2));
+
+        Map d = std::move(a);
+        REQUIRE(d.rehash_pending());
+        Map b = d;
+        Map c;
+        c = d;
+        while (!d.rehash_pending()) {
+            d[i] = i;
+            ++i;
+        }
+        d.clear();
+        REQUIRE(!d.rehash_pending());
+        REQUIRE(d.empty());
+
+        while (!b.rehash_pending()) {
+            b[i] = i;
+            ++i;
+        }
+        c = b;
+        REQUIRE(c.size() == b.size());
+        c = std::move(b);
+        // c is destroyed with a pending rehash
+    }
+    REQUIRE(CtorDtorVerifier::mapSize() == static_cast<size_t>(0));
+}
+
+TEST_CASE_TEMPLATE("incremental_rehash_const", Map,
+                   robin_hood::unordered_flat_map_incremental<uint64_t, uint64_t>,
+                   robin_hood::unordered_node_map_incremental<uint64_t, uint64_t>) {
+    Map map;
+    map.set_incremental_rehash(4);
+    auto const num = fillUntilPending(map);
+
+    // const maps can have a pending rehash, nothing of it is moved by const member functions
+    Map const c(std::move(map));
+    REQUIRE(c.rehash_pending());
+    REQUIRE(c.size() == num);
+    REQUIRE(static_cast<size_t>(std::distance(c.begin(), c.end())) == num);
+    REQUIRE(c.cbegin() != c.cend());
+    REQUIRE(c.find(num) == c.end());
+    REQUIRE(c.count(0) == 1);
+    Map copy;
+    copy = c;
+    REQUIRE(copy == c);
+    REQUIRE(c.rehash_pending());
+}
+
+TEST_CASE_TEMPLATE("incremental_rehash_erase_iterator", Map,
+                   robin_hood::unordered_flat_map_incremental<uint64_t, uint64_t>,
+                   robin_hood::unordered_node_map_incremental<uint64_t, uint64_t>) {
+    Map map;
+    map.set_incremental_rehash(2);
+    auto const num = fillUntilPending(map);
+
+    // erase(iterator) keeps the iterator usable across both arrays
+    size_t numVisited = 0;
+    auto it = map.begin();
+    while (it != map.end()) {
+        ++numVisited;
+        if (it->first % 3 == 0) {
+            it = map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    REQUIRE(numVisited == num);
+    REQUIRE(map.size() == num - (num + 2) / 3);
+    for (uint64_t i = 0; i < num; ++i) {
+        REQUIRE(map.count(i) == (i % 3 == 0 ? 0U : 1U));
+    }
+
+    // erasing everything that is left through iterators, the old arrays included
+    it = map.begin();
+    while (it != map.end()) {
+        it = map.erase(it);
+    }
+    REQUIRE(map.empty());
+    map[num] = num;
+    REQUIRE(!map.rehash_pending());
+    REQUIRE(map.size() == 1);
+}
+
+TEST_CASE_TEMPLATE("incremental_rehash_deserialize", Map,
+                   robin_hood::unordered_flat_map_incremental<uint64_t, uint64_t>,
+                   robin_hood::unordered_node_map_incremental<uint64_t, uint64_t>) {
+    Map map;
+    for (uint64_t i = 0; i < 100; ++i) {
+        map[i] = i;
+    }
+    std::stringstream ss;
+    map.serialize(ss);
+
+    Map loaded;
+    loaded.set_incremental_rehash(4);
+    loaded.deserialize(ss);
+    REQUIRE(loaded == map);
+
+    // the setting survives deserialize(), so growing starts an incremental rehash
+    bool isPending = false;
+    for (uint64_t i = 100; i < 10000 && !isPending; ++i) {
+        loaded[i] = i;
+        isPending = loaded.rehash_pending();
+    }
+    REQUIRE(isPending);
+}
+
+TEST_CASE("incremental_rehash_size") {
+    // only the incremental maps pay for it
+    REQUIRE(sizeof(robin_hood::unordered_flat_map<int, int>) + sizeof(void*) ==
+            sizeof(robin_hood::unordered_flat_map_incremental<int, int>));
+    REQUIRE(sizeof(robin_hood::unordered_node_map<int, int>) + sizeof(void*) ==
+            sizeof(robin_hood::unordered_node_map_incremental<int, int>));
+    REQUIRE(sizeof(robin_hood::unordered_flat_map<int, int>::iterator) == 2 * sizeof(void*));
+    REQUIRE(sizeof(robin_hood::unordered_flat_map_incremental<int, int>::iterator) ==
+            4 * sizeof(void*));
+}
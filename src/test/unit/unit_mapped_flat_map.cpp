@@ -0,0 +1,247 @@
+#include <robin_hood_os.h>
+
+#include <app/doctest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#if ROBIN_HOOD(HAS_MMAP)
+
+namespace {
+
+// removes the file when the test is done
+struct TempFile {
+    char const* path;
+    ~TempFile() {
+        std::remove(path);
+    }
+};
+
+} // namespace
+
+TEST_CASE("mapped_flat_map") {
+    TempFile const file{"robin_hood_unit_mapped_flat_map.bin"};
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> map;
+    for (uint64_t i = 0; i < 10000; ++i) {
+        map[i * 7] = i;
+    }
+    map.save(file.path);
+
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> loaded;
+    loaded[123456] = 1;
+    loaded.load(file.path);
+    REQUIRE(loaded == map);
+    // a loaded map is a normal map
+    loaded[1] = 1;
+    REQUIRE(loaded.size() == 10001U);
+
+    robin_hood::mapped_flat_map<uint64_t, uint64_t> const view(file.path);
+    REQUIRE(view.size() == map.size());
+    REQUIRE(!view.empty());
+    REQUIRE(view.map() == map);
+    for (uint64_t i = 0; i < 10000; ++i) {
+        auto it = view.find(i * 7);
+        REQUIRE(it != view.end());
+        REQUIRE(it->second == i);
+        REQUIRE(view.count(i * 7 + 1) == 0U);
+    }
+    REQUIRE(view.contains(0));
+    REQUIRE(!view.contains(1));
+
+    size_t n = 0;
+    for (auto const& kv : view) {
+        REQUIRE(kv.first == kv.second * 7);
+        ++n;
+    }
+    REQUIRE(n == map.size());
+}
+
+TEST_CASE("mapped_flat_map_empty") {
+    TempFile const file{"robin_hood_unit_mapped_flat_map_empty.bin"};
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> map;
+    map.save(file.path);
+
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> loaded;
+    loaded[1] = 2;
+    loaded.load(file.path);
+    REQUIRE(loaded.empty());
+
+    robin_hood::mapped_flat_map<uint64_t, uint64_t> const view(file.path);
+    REQUIRE(view.empty());
+    REQUIRE(view.begin() == view.end());
+    REQUIRE(!view.contains(0));
+}
+
+TEST_CASE("mapped_flat_set") {
+    TempFile const file{"robin_hood_unit_mapped_flat_set.bin"};
+    // non power of two table size
+    robin_hood::unordered_flat_set<uint32_t, robin_hood::hash<uint32_t>, std::equal_to<uint32_t>,
+                                   80, 150>
+        set;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        set.insert(i * 3);
+    }
+    set.save(file.path);
+
+    robin_hood::mapped_flat_set<uint32_t, robin_hood::hash<uint32_t>, std::equal_to<uint32_t>, 80,
+                                150> const view(file.path);
+    REQUIRE(view.size() == 1000U);
+    for (uint32_t i = 0; i < 3000; ++i) {
+        REQUIRE(view.contains(i) == (i % 3 == 0));
+    }
+}
+
+#    if ROBIN_HOOD(HAS_EXCEPTIONS)
+
+TEST_CASE("mapped_flat_map_bad_file") {
+    TempFile const file{"robin_hood_unit_mapped_flat_map_bad.bin"};
+    using View = robin_hood::mapped_flat_map<uint64_t, uint64_t>;
+    REQUIRE_THROWS_AS(View("robin_hood_unit_file_does_not_exist.bin"), std::runtime_error);
+
+    auto* f = std::fopen(file.path, "wb");
+    REQUIRE(f != nullptr);
+    char garbage[256] = {'x'};
+    REQUIRE(std::fwrite(garbage, sizeof(garbage), 1, f) == 1U);
+    REQUIRE(std::fclose(f) == 0);
+    REQUIRE_THROWS_AS(View{file.path}, std::runtime_error);
+
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> map;
+    REQUIRE_THROWS_AS(map.load(file.path), std::runtime_error);
+
+    // written by a map with a different entry size
+    robin_hood::unordered_flat_map<uint32_t, uint32_t> other;
+    other[1] = 2;
+    other.save(file.path);
+    REQUIRE_THROWS_AS(View{file.path}, std::runtime_error);
+    REQUIRE_THROWS_AS(map.load(file.path), std::runtime_error);
+    REQUIRE(map.empty());
+}
+
+namespace {
+
+std::vector<char> readFile(char const* path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeFile(char const* path, std::vector<char> const& data) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+template <typename T>
+void patch(std::vector<char>& data, size_t offset, T value) {
+    std::memcpy(data.data() + offset, &value, sizeof(T));
+}
+
+} // namespace
+
+TEST_CASE("mapped_flat_map_corrupt") {
+    TempFile const file{"robin_hood_unit_mapped_flat_map_corrupt.bin"};
+    using Map = robin_hood::unordered_flat_map<uint64_t, uint64_t>;
+    using View = robin_hood::mapped_flat_map<uint64_t, uint64_t>;
+    Map map;
+    for (uint64_t i = 0; i < 10000; ++i) {
+        map[i] = i;
+    }
+    map.save(file.path);
+    auto const good = readFile(file.path);
+
+    // offsets in the header, and of the info bytes after the nodes
+    static constexpr size_t NumElements = 40;
+    static constexpr size_t Mask = 48;
+    static constexpr size_t MaxNumElementsAllowed = 56;
+    static constexpr size_t InfoInc = 64;
+    static constexpr size_t InfoHashShift = 68;
+    static constexpr size_t MaxLoadFactor100 = 72;
+    auto const numBuckets = map.bucket_count();
+    auto const numElementsWithBuffer = numBuckets + (std::min)(numBuckets * 80 / 100, size_t(255));
+    auto const info = 128 + numElementsWithBuffer * sizeof(Map::value_type);
+
+    std::vector<std::function<void(std::vector<char>&)>> const corruptions = {
+        [](std::vector<char>& d) { patch<uint64_t>(d, NumElements, 10001); },
+        [&](std::vector<char>& d) { patch<uint64_t>(d, Mask, numBuckets - 2); },
+        [&](std::vector<char>& d) { patch<uint64_t>(d, Mask, numBuckets * 2 - 1); },
+        [](std::vector<char>& d) { patch<uint64_t>(d, MaxNumElementsAllowed, 1U << 30U); },
+        [](std::vector<char>& d) { patch<uint32_t>(d, InfoInc, 3); },
+        // infoInc and infoHashShift only change together
+        [](std::vector<char>& d) { patch<uint32_t>(d, InfoInc, 2); },
+        [](std::vector<char>& d) { patch<uint32_t>(d, InfoHashShift, 5); },
+        [](std::vector<char>& d) { patch<uint32_t>(d, MaxLoadFactor100, 90); },
+        // a distance in the first slot, or missing sentinel
+        [&](std::vector<char>& d) { patch<uint8_t>(d, info, 0xFF); },
+        [&](std::vector<char>& d) { patch<uint8_t>(d, info + numElementsWithBuffer, 0); },
+        // an entry too many, and one that is too far away from the previous one
+        [&](std::vector<char>& d) { patch<uint8_t>(d, info + numElementsWithBuffer - 1, 32); },
+        [&](std::vector<char>& d) {
+            auto idx = info;
+            while (0 != d[idx]) {
+                ++idx;
+            }
+            patch<uint8_t>(d, idx, 64);
+        },
+        [&](std::vector<char>& d) { d.resize(d.size() - 1); },
+    };
+    for (size_t i = 0; i < corruptions.size(); ++i) {
+        CAPTURE(i);
+        auto data = good;
+        corruptions[i](data);
+        writeFile(file.path, data);
+        REQUIRE_THROWS_AS(View{file.path}, std::runtime_error);
+
+        // the map stays as it was
+        Map loaded;
+        loaded[123] = 456;
+        REQUIRE_THROWS_AS(loaded.load(file.path), std::runtime_error);
+        REQUIRE(loaded.size() == 1U);
+        REQUIRE(loaded[123] == 456U);
+    }
+
+    // the unchanged image is still fine
+    writeFile(file.path, good);
+    REQUIRE(View{file.path}.map() == map);
+}
+
+TEST_CASE("mapped_flat_map_hash_hw") {
+    TempFile const file{"robin_hood_unit_mapped_flat_map_hash_hw.bin"};
+    using Map = robin_hood::unordered_flat_map<uint64_t, uint64_t, robin_hood::hash_hw<uint64_t>>;
+    Map map;
+    map[1] = 2;
+    map.save(file.path);
+    Map loaded;
+    loaded.load(file.path);
+    REQUIRE(loaded == map);
+
+    // as if it was written on a machine that hashes the other way
+    static constexpr size_t HashVariant = 80;
+    auto data = readFile(file.path);
+    uint64_t variant = 0;
+    std::memcpy(&variant, data.data() + HashVariant, sizeof(variant));
+    REQUIRE(variant == (robin_hood::has_hw_hash() ? 2U : 1U));
+    patch<uint64_t>(data, HashVariant, 3 - variant);
+    writeFile(file.path, data);
+    REQUIRE_THROWS_AS(loaded.load(file.path), std::runtime_error);
+    REQUIRE(loaded == map);
+}
+
+TEST_CASE("mapped_flat_map_wide_info") {
+    TempFile const file{"robin_hood_unit_mapped_flat_map_wide_info.bin"};
+    robin_hood::unordered_flat_map_wide_info<uint64_t, uint64_t> wide;
+    wide[1] = 2;
+    wide.save(file.path);
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> map;
+    REQUIRE_THROWS_AS(map.load(file.path), std::runtime_error);
+    wide.clear();
+    wide.load(file.path);
+    REQUIRE(wide.size() == 1U);
+}
+
+#    endif
+
+#endif
@@ -0,0 +1,76 @@
+#include <robin_hood_os.h>
+
+#include <app/doctest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("numa_allocator") {
+    REQUIRE(robin_hood::numa_num_nodes() >= 1U);
+    REQUIRE(robin_hood::numa_current_node() < robin_hood::numa_num_nodes());
+
+    using Alloc = robin_hood::numa_allocator<char>;
+    REQUIRE(Alloc().node() == -1);
+    REQUIRE(Alloc::interleaved() == Alloc());
+    REQUIRE(Alloc::bound_to(1).node() == 1);
+    REQUIRE(Alloc::bound_to(1) != Alloc::bound_to(0));
+
+    // node 3 most likely doesn't exist, which falls back to the default policy
+    for (auto const& alloc : {Alloc::interleaved(), Alloc::bound_to(0), Alloc::bound_to(3)}) {
+        robin_hood::unordered_node_map<uint64_t, std::string, robin_hood::hash<uint64_t>,
+                                       std::equal_to<uint64_t>, 80, 200, Alloc>
+            map(alloc);
+        for (uint64_t i = 0; i < 50000; ++i) {
+            map[i] = std::to_string(i);
+        }
+        REQUIRE(map.get_allocator() == alloc);
+        REQUIRE(map.size() == 50000U);
+        REQUIRE(map[123] == "123");
+    }
+}
+
+TEST_CASE("replicated_flat_map") {
+    robin_hood::unordered_map<uint64_t, uint64_t> source;
+    for (uint64_t i = 0; i < 10000; ++i) {
+        source[i] = i * 2;
+    }
+
+    // emulates 4 nodes
+    robin_hood::replicated_flat_map<uint64_t, uint64_t> const map(source, 4);
+    REQUIRE(map.num_replicas() == 4U);
+    REQUIRE(map.size() == 10000U);
+    for (size_t node = 0; node < map.num_replicas(); ++node) {
+        auto const& replica = map.replica(node);
+        REQUIRE(replica.get_allocator().node() == static_cast<int>(node));
+        REQUIRE(replica.size() == source.size());
+        for (auto const& kv : source) {
+            auto it = replica.find(kv.first);
+            REQUIRE(it != replica.end());
+            REQUIRE(it->second == kv.second);
+        }
+    }
+    REQUIRE(&map.local() == &map.replica(robin_hood::numa_current_node() % 4));
+
+    // readers from several threads
+    std::vector<std::thread> threads;
+    std::vector<uint64_t> sums(4);
+    for (size_t t = 0; t < sums.size(); ++t) {
+        threads.emplace_back([&map, &sums, t] {
+            for (uint64_t i = 0; i < 10000; ++i) {
+                sums[t] += map.find(i)->second;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto sum : sums) {
+        REQUIRE(sum == UINT64_C(9999) * 10000);
+    }
+
+    robin_hood::replicated_flat_map<uint64_t, uint64_t> const perNode(source);
+    REQUIRE(perNode.num_replicas() == robin_hood::numa_num_nodes());
+    REQUIRE(perNode.contains(5));
+    REQUIRE(perNode.count(10000) == 0U);
+}
@@ -0,0 +1,104 @@
+#include <robin_hood_concurrent.h>
+
+#include <app/doctest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using RcuMap = robin_hood::rcu_flat_map<uint64_t, uint64_t>;
+
+TEST_CASE("rcu_flat_map") {
+    RcuMap map;
+    auto reader = map.make_reader();
+    REQUIRE(reader.read([](RcuMap::map_type const& m) { return m.size(); }) == 0U);
+
+    map.update([](RcuMap::map_type& m) {
+        for (uint64_t i = 0; i < 100; ++i) {
+            m[i] = i;
+        }
+    });
+    REQUIRE(reader.read([](RcuMap::map_type const& m) { return m.size(); }) == 100U);
+    REQUIRE(map.reclaim() == 0U);
+
+    // an active reader keeps its snapshot alive, later reads see the new one
+    reader.read([&](RcuMap::map_type const& snapshot) {
+        map.update([](RcuMap::map_type& m) { m.erase(UINT64_C(0)); });
+        REQUIRE(map.reclaim() == 1U);
+        REQUIRE(snapshot.size() == 100U);
+        REQUIRE(snapshot.count(0) == 1U);
+
+        auto other = map.make_reader();
+        REQUIRE(other.read([](RcuMap::map_type const& m) { return m.count(0); }) == 0U);
+    });
+    REQUIRE(map.reclaim() == 0U);
+    REQUIRE(reader.read([](RcuMap::map_type const& m) { return m.size(); }) == 99U);
+}
+
+#if ROBIN_HOOD(HAS_EXCEPTIONS)
+
+TEST_CASE("rcu_flat_map_max_readers") {
+    RcuMap map(2);
+    auto a = map.make_reader();
+    {
+        auto b = map.make_reader();
+        REQUIRE_THROWS_AS(map.make_reader(), std::overflow_error);
+        auto moved = std::move(b);
+        REQUIRE_THROWS_AS(map.make_reader(), std::overflow_error);
+    }
+    // b's slot is free again
+    auto c = map.make_reader();
+    REQUIRE(c.read([](RcuMap::map_type const& m) { return m.empty(); }));
+}
+
+#endif
+
+TEST_CASE("rcu_flat_map_threads") {
+    static constexpr size_t NumReaders = 4;
+    static constexpr uint64_t NumUpdates = 300;
+    RcuMap map;
+
+    // each snapshot has keys 0..n-1, all with the value n.
+    std::atomic<bool> done(false);
+    std::atomic<size_t> numBad(0);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < NumReaders; ++t) {
+        threads.emplace_back([&] {
+            auto reader = map.make_reader();
+            uint64_t lastSize = 0;
+            while (!done) {
+                auto const size = reader.read([&](RcuMap::map_type const& m) {
+                    for (auto const& kv : m) {
+                        if (kv.first >= m.size() || kv.second != m.size()) {
+                            ++numBad;
+                        }
+                    }
+                    return static_cast<uint64_t>(m.size());
+                });
+                // snapshots never go back in time
+                if (size < lastSize) {
+                    ++numBad;
+                }
+                lastSize = size;
+            }
+        });
+    }
+
+    for (uint64_t n = 1; n <= NumUpdates; ++n) {
+        map.update([n](RcuMap::map_type& m) {
+            for (auto& kv : m) {
+                kv.second = n;
+            }
+            m[n - 1] = n;
+        });
+    }
+    done = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE(numBad == 0U);
+    REQUIRE(map.reclaim() == 0U);
+    REQUIRE(map.make_reader().read([](RcuMap::map_type const& m) { return m.size(); }) ==
+            NumUpdates);
+}
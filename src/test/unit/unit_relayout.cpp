@@ -0,0 +1,37 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+
+#include <string>
+
+TEST_CASE("relayout") {
+    robin_hood::unordered_node_map<uint64_t, std::string> map;
+    sfc64 rng(321);
+    for (size_t i = 0; i < 20000; ++i) {
+        map[rng.uniform<uint64_t>(5000)] = "x";
+        map.erase(rng.uniform<uint64_t>(5000));
+    }
+    for (auto& kv : map) {
+        kv.second = std::to_string(kv.first);
+    }
+    auto const size = map.size();
+    map.relayout();
+    REQUIRE(map.size() == size);
+
+    // the nodes are in iteration order, one after the other
+    robin_hood::pair<const uint64_t, std::string> const* prev = nullptr;
+    for (auto const& kv : map) {
+        REQUIRE(kv.second == std::to_string(kv.first));
+        if (prev) {
+            REQUIRE(&kv > prev);
+        }
+        prev = &kv;
+    }
+    map[5001] = "5001";
+    REQUIRE(map.size() == size + 1);
+
+    map.clear();
+    map.relayout();
+    REQUIRE(map.trim() == 0U);
+}
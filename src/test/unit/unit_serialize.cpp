@@ -0,0 +1,163 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+TYPE_TO_STRING(robin_hood::unordered_flat_map<std::string, std::string>);
+TYPE_TO_STRING(robin_hood::unordered_node_map<std::string, std::string>);
+TYPE_TO_STRING(robin_hood::unordered_node_map_cached_hash<std::string, std::string>);
+
+TEST_CASE_TEMPLATE("serialize_stream", Map,
+                   robin_hood::unordered_flat_map<std::string, std::string>,
+                   robin_hood::unordered_node_map<std::string, std::string>,
+                   robin_hood::unordered_node_map_cached_hash<std::string, std::string>) {
+    Map map;
+    for (size_t i = 0; i < 5000; ++i) {
+        map[std::to_string(i)] = std::string(i % 50, 'x');
+    }
+    map.erase("17");
+    map[""] = "empty key";
+
+    std::stringstream ss;
+    map.serialize(ss);
+
+    Map loaded;
+    loaded["will be replaced"] = "";
+    loaded.deserialize(ss);
+    REQUIRE(loaded == map);
+    REQUIRE(loaded.size() == 5000U);
+    REQUIRE(loaded[""] == "empty key");
+    REQUIRE(loaded.count("17") == 0U);
+    REQUIRE(loaded.count("will be replaced") == 0U);
+
+    // the loaded map is a normal map
+    loaded["17"] = "x";
+    REQUIRE(loaded.size() == 5001U);
+    REQUIRE(loaded.erase("0") == 1U);
+}
+
+TEST_CASE("serialize_callback") {
+    robin_hood::unordered_flat_set<uint64_t> set;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        set.insert(i * i);
+    }
+
+    std::vector<char> buffer;
+    set.serialize([&](void const* data, size_t size) {
+        auto const* p = static_cast<char const*>(data);
+        buffer.insert(buffer.end(), p, p + size);
+    });
+    // count, hash seed, and all elements
+    REQUIRE(buffer.size() == (2 + set.size()) * sizeof(uint64_t));
+
+    robin_hood::unordered_flat_set<uint64_t> loaded;
+    size_t pos = 0;
+    loaded.deserialize([&](void* data, size_t size) {
+        if (buffer.size() - pos < size) {
+            return false;
+        }
+        std::memcpy(data, buffer.data() + pos, size);
+        pos += size;
+        return true;
+    });
+    REQUIRE(pos == buffer.size());
+    REQUIRE(loaded == set);
+}
+
+TEST_CASE("serialize_empty") {
+    robin_hood::unordered_map<std::string, int> map;
+    std::stringstream ss;
+    map.serialize(ss);
+
+    robin_hood::unordered_map<std::string, int> loaded{{"a", 1}};
+    loaded.deserialize(ss);
+    REQUIRE(loaded.empty());
+    loaded["b"] = 2;
+    REQUIRE(loaded.size() == 1U);
+}
+
+TEST_CASE("serialize_large") {
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> map;
+    for (uint64_t i = 0; i < 200000; ++i) {
+        map[i * 7] = i;
+    }
+    std::stringstream ss;
+    map.serialize(ss);
+
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> loaded;
+    loaded.deserialize(ss);
+    REQUIRE(loaded == map);
+    REQUIRE(loaded.bucket_count() == map.bucket_count());
+
+    // the count and the hash seed are unchanged
+    std::stringstream again;
+    loaded.serialize(again);
+    REQUIRE(again.str().substr(0, 16) == ss.str().substr(0, 16));
+
+    loaded[1] = 1;
+    REQUIRE(loaded.size() == map.size() + 1);
+}
+
+#if ROBIN_HOOD(HAS_EXCEPTIONS)
+
+TEST_CASE("serialize_corrupt_count") {
+    // a huge element count followed by much less data throws before allocating for it
+    std::string data;
+    for (uint64_t v : {uint64_t(1) << 50U, uint64_t(12345), uint64_t(1), uint64_t(2)}) {
+        data.append(reinterpret_cast<char const*>(&v), sizeof(v));
+    }
+    std::stringstream ss(data);
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> loaded;
+    REQUIRE_THROWS_AS(loaded.deserialize(ss), std::runtime_error);
+    REQUIRE(loaded.empty());
+}
+
+TEST_CASE("serialize_corrupt_count_callback") {
+    // the count is checked against the input size before anything is read or allocated
+    std::vector<uint64_t> data{1000, 12345, 1, 2, 3, 4};
+    size_t numReads = 0;
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> loaded{{UINT64_C(7), UINT64_C(7)}};
+    auto read = [&](void* out, size_t size) {
+        std::memcpy(out, reinterpret_cast<char const*>(data.data()) + numReads * size, size);
+        ++numReads;
+        return true;
+    };
+    REQUIRE_THROWS_AS(loaded.deserialize(read, data.size() * sizeof(uint64_t)), std::runtime_error);
+    REQUIRE(numReads == 1U);
+    REQUIRE(loaded.size() == 1U);
+
+    // 2 elements of 16 bytes fit
+    data[0] = 2;
+    numReads = 0;
+    loaded.deserialize(read, data.size() * sizeof(uint64_t));
+    REQUIRE(numReads == 6U);
+    REQUIRE(loaded.size() == 2U);
+    REQUIRE(loaded[1] == 2U);
+    REQUIRE(loaded[3] == 4U);
+}
+
+TEST_CASE("serialize_truncated") {
+    robin_hood::unordered_node_map<std::string, uint32_t> map;
+    for (uint32_t i = 0; i < 100; ++i) {
+        map[std::to_string(i)] = i;
+    }
+    std::stringstream ss;
+    map.serialize(ss);
+    auto data = ss.str();
+
+    // the map is unchanged when the input ends early
+    robin_hood::unordered_node_map<std::string, uint32_t> loaded{{"a", 1U}};
+    for (size_t size : {size_t(0), size_t(5), size_t(16), data.size() / 2, data.size() - 1}) {
+        std::stringstream truncated(data.substr(0, size));
+        REQUIRE_THROWS_AS(loaded.deserialize(truncated), std::runtime_error);
+        REQUIRE(loaded.size() == 1U);
+        REQUIRE(loaded["a"] == 1U);
+    }
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using Map = robin_hood::unordered_node_map<uint64_t, std::string, robin_hood::hash<uint64_t>,
+                                           std::equal_to<uint64_t>, 80, 200,
+                                           robin_hood::shared_node_allocator<char>>;
+using Pool = robin_hood::node_pool<Map::value_type>;
+
+TEST_CASE("shared_node_pool") {
+    Pool pool;
+    Map::value_type* node = nullptr;
+    {
+        Map a(robin_hood::shared_node_allocator<char>{pool});
+        Map b(robin_hood::shared_node_allocator<char>{pool});
+        REQUIRE(a.get_allocator() == b.get_allocator());
+        REQUIRE(a.get_allocator().pool() == &pool);
+        for (uint64_t i = 0; i < 100; ++i) {
+            a[i] = std::to_string(i);
+            b[i + 1000] = std::to_string(i);
+        }
+
+        // a node freed by one map is reused by the next insert into another map
+        node = &*a.find(42);
+        a.erase(42);
+        b[5000] = "x";
+        REQUIRE(&*b.find(5000) == node);
+
+        Map copy(a);
+        REQUIRE(copy == a);
+        REQUIRE(copy.get_allocator().pool() == &pool);
+        Map moved(std::move(copy));
+        REQUIRE(moved == a);
+        moved = std::move(b);
+        REQUIRE(moved.size() == 101U);
+        REQUIRE(moved[5000] == "x");
+    }
+
+    // a destroyed map gives its nodes back
+    {
+        Map a(robin_hood::shared_node_allocator<char>{pool});
+        a[1] = "1";
+        node = &*a.find(1);
+    }
+    Map b(robin_hood::shared_node_allocator<char>{pool});
+    b[2] = "2";
+    REQUIRE(&*b.find(2) == node);
+}
+
+TEST_CASE("shared_node_pool_move_between_pools") {
+    Pool poolA;
+    Pool poolB;
+    Map a(robin_hood::shared_node_allocator<char>{poolA});
+    Map b(robin_hood::shared_node_allocator<char>{poolB});
+    for (uint64_t i = 0; i < 100; ++i) {
+        a[i] = std::to_string(i);
+        b[i] = "b";
+    }
+
+    // the allocator propagates, so b takes over a's nodes and its pool
+    b = std::move(a);
+    REQUIRE(b.get_allocator().pool() == &poolA);
+    REQUIRE(b.size() == 100U);
+    REQUIRE(b[17] == "17");
+    b.swap(a);
+    REQUIRE(a.get_allocator().pool() == &poolA);
+    REQUIRE(a[17] == "17");
+}
+
+TEST_CASE("shared_node_pool_thread_local") {
+    auto run = [] {
+        std::vector<Map> maps(100);
+        for (size_t m = 0; m < maps.size(); ++m) {
+            REQUIRE(maps[m].get_allocator().pool() == nullptr);
+            for (uint64_t i = 0; i < 10; ++i) {
+                maps[m][i] = std::to_string(i + m);
+            }
+        }
+        size_t sum = 0;
+        for (auto const& map : maps) {
+            sum += map.size();
+        }
+        REQUIRE(sum == 1000U);
+        maps.clear();
+
+        // the next map gets the nodes the others have given back
+        Map map;
+        map[1] = "1";
+        auto* node = &*map.find(1);
+        map.erase(1);
+        Map other;
+        other[2] = "2";
+        REQUIRE(&*other.find(2) == node);
+    };
+
+    run();
+    std::thread t(run);
+    t.join();
+}
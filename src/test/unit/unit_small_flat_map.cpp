@@ -0,0 +1,311 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+TEST_CASE("small_flat_map") {
+    robin_hood::small_flat_map<std::string, int, 3> map;
+    REQUIRE(map.empty());
+    REQUIRE(map.is_inline());
+    REQUIRE(map.begin() == map.end());
+
+    map["a"] = 1;
+    REQUIRE(map.try_emplace("b", 2).second);
+    REQUIRE(!map.try_emplace("b", 3).second);
+    REQUIRE(map.insert({"c", 3}).second);
+    REQUIRE(map.is_inline());
+    REQUIRE(map.size() == 3U);
+    REQUIRE(map.at("b") == 2);
+    REQUIRE(map.count("c") == 1U);
+    REQUIRE(!map.contains("d"));
+    REQUIRE(map.find("d") == map.end());
+
+    // erase moves the last entry into the hole
+    REQUIRE(map.erase("a") == 1U);
+    REQUIRE(map.erase("a") == 0U);
+    REQUIRE(map.size() == 2U);
+    REQUIRE(map["b"] == 2);
+    REQUIRE(map["c"] == 3);
+    map["a"] = 1;
+
+    // the 4th entry switches to the hashed layout
+    map.insert_or_assign("d", 4);
+    REQUIRE(!map.is_inline());
+    REQUIRE(map.size() == 4U);
+    int sum = 0;
+    for (auto const& kv : map) {
+        sum += kv.second;
+    }
+    REQUIRE(sum == 10);
+    REQUIRE(map.at("a") == 1);
+
+    auto copy = map;
+    REQUIRE(copy == map);
+    map.clear();
+    REQUIRE(map.empty());
+    REQUIRE(!map.is_inline());
+    REQUIRE(copy != map);
+
+#if ROBIN_HOOD(HAS_EXCEPTIONS)
+    REQUIRE_THROWS_AS(map.at("x"), std::out_of_range);
+#endif
+}
+
+TEST_CASE("small_flat_map_copy_move") {
+    using Map = robin_hood::small_flat_map<uint64_t, std::string, 4>;
+    Map a{{1U, "1"}, {2U, "2"}};
+    Map b(a);
+    REQUIRE(b == a);
+    REQUIRE(b.is_inline());
+
+    Map c(std::move(b));
+    REQUIRE(c == a);
+    REQUIRE(b.empty());
+
+    Map big;
+    big.reserve(100);
+    REQUIRE(!big.is_inline());
+    big[7] = "7";
+    c = big;
+    REQUIRE(!c.is_inline());
+    REQUIRE(c[7] == "7");
+    c = std::move(a);
+    REQUIRE(c.is_inline());
+    REQUIRE(c.size() == 2U);
+    c.swap(big);
+    REQUIRE(big.size() == 2U);
+    REQUIRE(c.size() == 1U);
+}
+
+#if ROBIN_HOOD(HAS_EXCEPTIONS)
+
+namespace {
+
+// Counts live instances, and copying throws once numCopiesLeft reaches 0.
+struct ThrowingCopy {
+    static int numLive;
+    static int numCopiesLeft;
+
+    ThrowingCopy() noexcept {
+        ++numLive;
+    }
+    ThrowingCopy(ThrowingCopy const& /*unused*/) {
+        if (0 == numCopiesLeft--) {
+            throw std::runtime_error("copy");
+        }
+        ++numLive;
+    }
+    ThrowingCopy& operator=(ThrowingCopy const&) = default;
+    ~ThrowingCopy() {
+        --numLive;
+    }
+};
+
+int ThrowingCopy::numLive = 0;
+int ThrowingCopy::numCopiesLeft = 0;
+
+} // namespace
+
+TEST_CASE("small_flat_map_copy_throws") {
+    using Map = robin_hood::small_flat_map<int, ThrowingCopy, 4>;
+    // the copy constructor is used for moving, so that can throw too
+    static_assert(!std::is_nothrow_move_constructible<Map>::value, "move can throw");
+    static_assert(std::is_nothrow_move_constructible<
+                      robin_hood::small_flat_map<int, std::string, 4>>::value,
+                  "move can't throw");
+    {
+        Map a;
+        a[1];
+        a[2];
+        a[3];
+        REQUIRE(ThrowingCopy::numLive == 3);
+
+        ThrowingCopy::numCopiesLeft = 2;
+        REQUIRE_THROWS_AS(Map{a}, std::runtime_error);
+        REQUIRE(ThrowingCopy::numLive == 3);
+
+        ThrowingCopy::numCopiesLeft = 1;
+        REQUIRE_THROWS_AS(Map{std::move(a)}, std::runtime_error);
+        REQUIRE(ThrowingCopy::numLive == 3);
+        REQUIRE(a.size() == 3U);
+    }
+    REQUIRE(ThrowingCopy::numLive == 0);
+}
+
+#endif
+
+TEST_CASE("small_flat_map_erase_iterator") {
+    // inline and hashed
+    for (uint64_t n : {UINT64_C(4), UINT64_C(20)}) {
+        robin_hood::small_flat_map<uint64_t, uint64_t, 4> map;
+        for (uint64_t i = 0; i < n; ++i) {
+            map[i] = i;
+        }
+        REQUIRE(map.is_inline() == (n <= 4));
+
+        // an erase loop visits each entry once
+        size_t numVisited = 0;
+        for (auto it = map.begin(); it != map.end();) {
+            ++numVisited;
+            if (it->first % 2 == 1) {
+                it = map.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        REQUIRE(numVisited == n);
+        REQUIRE(map.size() == n / 2);
+        for (uint64_t i = 0; i < n; ++i) {
+            REQUIRE(map.count(i) == (i % 2 == 0 ? 1U : 0U));
+        }
+
+        auto const& cmap = map;
+        auto const it = map.erase(cmap.find(0));
+        REQUIRE(map.size() == n / 2 - 1);
+        REQUIRE(map.count(0) == 0U);
+        REQUIRE((it == map.end() || it->first % 2 == 0));
+
+        REQUIRE(robin_hood::erase_if(map, [](robin_hood::pair<uint64_t, uint64_t> const& kv) {
+                    return kv.first > 2;
+                }) == n / 2 - 2);
+        REQUIRE(map.size() == 1U);
+        REQUIRE(map.count(2) == 1U);
+    }
+}
+
+namespace {
+
+// Keys are equal when they are equal modulo mod. Neither is default constructible.
+struct ModHash {
+    explicit ModHash(uint64_t m)
+        : mod(m) {}
+    size_t operator()(uint64_t key) const noexcept {
+        return robin_hood::hash_int(key % mod);
+    }
+    uint64_t mod;
+};
+
+struct ModEqual {
+    explicit ModEqual(uint64_t m)
+        : mod(m) {}
+    bool operator()(uint64_t a, uint64_t b) const noexcept {
+        return a % mod == b % mod;
+    }
+    uint64_t mod;
+};
+
+// Counts the blocks that are currently allocated.
+template <typename T>
+class BlockCountingAllocator {
+public:
+    using value_type = T;
+
+    explicit BlockCountingAllocator(size_t* numBlocks) noexcept
+        : mNumBlocks(numBlocks) {}
+
+    template <typename U>
+    BlockCountingAllocator(BlockCountingAllocator<U> const& o) noexcept // NOLINT
+        : mNumBlocks(o.numBlocks()) {}
+
+    T* allocate(size_t n) {
+        ++*mNumBlocks;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+        --*mNumBlocks;
+        std::allocator<T>().deallocate(ptr, n);
+    }
+
+    size_t* numBlocks() const noexcept {
+        return mNumBlocks;
+    }
+
+private:
+    size_t* mNumBlocks;
+};
+
+template <typename T, typename U>
+bool operator==(BlockCountingAllocator<T> const& a, BlockCountingAllocator<U> const& b) noexcept {
+    return a.numBlocks() == b.numBlocks();
+}
+
+template <typename T, typename U>
+bool operator!=(BlockCountingAllocator<T> const& a, BlockCountingAllocator<U> const& b) noexcept {
+    return !(a == b);
+}
+
+} // namespace
+
+TEST_CASE("small_flat_map_stateful") {
+    using Alloc = BlockCountingAllocator<char>;
+    using Map = robin_hood::small_flat_map<uint64_t, int, 2, ModHash, ModEqual, 80, 200, Alloc>;
+    size_t numBlocks = 0;
+    {
+        Map map(0, ModHash(10), ModEqual(10), Alloc(&numBlocks));
+        REQUIRE(map.get_allocator() == Alloc(&numBlocks));
+
+        // the inline lookup uses the stored key_equal
+        map[1] = 1;
+        REQUIRE(!map.try_emplace(11, 2).second);
+        map[2] = 2;
+        REQUIRE(map.is_inline());
+        REQUIRE(numBlocks == 0U);
+
+        // the hashed map gets the stored hash, key_equal and allocator
+        map[3] = 3;
+        REQUIRE(!map.is_inline());
+        REQUIRE(numBlocks == 1U);
+        REQUIRE(map.size() == 3U);
+        REQUIRE(map.at(21) == 1);
+        REQUIRE(map.count(13) == 1U);
+
+        Map copy(map);
+        REQUIRE(numBlocks == 2U);
+        REQUIRE(copy.at(32) == 2);
+
+        Map inlineCopy(1, ModHash(5), ModEqual(5), Alloc(&numBlocks));
+        inlineCopy[4] = 4;
+        Map moved(std::move(inlineCopy));
+        REQUIRE(moved.count(9) == 1U);
+        REQUIRE(moved.count(4 + 10) == 1U);
+
+        // assignment and swap take the functors along
+        copy = moved;
+        REQUIRE(numBlocks == 1U);
+        REQUIRE(copy.is_inline());
+        REQUIRE(copy.at(9) == 4);
+        copy.swap(map);
+        REQUIRE(copy.at(23) == 3);
+        REQUIRE(map.at(9) == 4);
+        REQUIRE(map.count(19) == 1U);
+    }
+    REQUIRE(numBlocks == 0U);
+}
+
+TEST_CASE("small_flat_map_random") {
+    robin_hood::small_flat_map<uint64_t, uint64_t, 6> map;
+    std::unordered_map<uint64_t, uint64_t> ref;
+    sfc64 rng(123);
+    for (size_t i = 0; i < 10000; ++i) {
+        // few keys, so the map stays small for a while
+        auto const key = rng.uniform<uint64_t>(i < 5000 ? 8 : 100);
+        if (rng.uniform<uint64_t>(3) == 0) {
+            REQUIRE(map.erase(key) == ref.erase(key));
+        } else {
+            map[key] = i;
+            ref[key] = i;
+        }
+        REQUIRE(map.size() == ref.size());
+    }
+    for (auto const& kv : ref) {
+        REQUIRE(map.at(kv.first) == kv.second);
+    }
+}
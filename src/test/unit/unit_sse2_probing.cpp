@@ -0,0 +1,59 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+
+#include <unordered_map>
+
+namespace {
+
+struct ProbeKey {
+    uint64_t v;
+    bool operator==(ProbeKey const& o) const noexcept {
+        return v == o.v;
+    }
+};
+
+// Weak hash that creates long probe sequences, so groups of infos are matched across several loads
+// and with all values of mInfoInc.
+struct ProbeKeyHash {
+    size_t operator()(ProbeKey const& k) const noexcept {
+        return static_cast<size_t>(k.v & 0xFFU);
+    }
+};
+
+} // namespace
+
+using Map = robin_hood::unordered_flat_map<ProbeKey, uint64_t, ProbeKeyHash>;
+using WideInfoMap = robin_hood::unordered_flat_map_wide_info<ProbeKey, uint64_t, ProbeKeyHash>;
+
+TYPE_TO_STRING(Map);
+TYPE_TO_STRING(WideInfoMap);
+
+TEST_CASE_TEMPLATE("sse2_probing", M, Map, WideInfoMap) {
+    M map;
+    std::unordered_map<uint64_t, uint64_t> ref;
+
+    sfc64 rng(321);
+    for (uint64_t i = 0; i < 20000; ++i) {
+        auto const k = rng.uniform<uint64_t>(4000);
+        switch (rng.uniform<uint64_t>(3)) {
+        case 0:
+            map[ProbeKey{k}] = i;
+            ref[k] = i;
+            break;
+        case 1:
+            REQUIRE(map.erase(ProbeKey{k}) == ref.erase(k));
+            break;
+        default:
+            auto const it = map.find(ProbeKey{k});
+            auto const refIt = ref.find(k);
+            REQUIRE((it == map.end()) == (refIt == ref.end()));
+            if (refIt != ref.end()) {
+                REQUIRE(it->second == refIt->second);
+            }
+            break;
+        }
+        REQUIRE(map.size() == ref.size());
+    }
+}
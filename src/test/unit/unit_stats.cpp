@@ -0,0 +1,120 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+
+#include <functional>
+#include <numeric>
+#include <utility>
+
+namespace {
+
+// puts 16 consecutive keys into the same bucket
+struct BadHash {
+    size_t operator()(uint64_t x) const noexcept {
+        return robin_hood::hash_int(x / 16);
+    }
+};
+
+template <typename Map>
+size_t sumHistogram(Map const& map) {
+    auto const s = map.stats();
+    return std::accumulate(s.distance_histogram.begin(), s.distance_histogram.end(), size_t(0));
+}
+
+} // namespace
+
+TEST_CASE("stats_empty") {
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> map;
+    auto const s = map.stats();
+    REQUIRE(s.distance_histogram.empty());
+    REQUIRE(s.max_probe_length == 0);
+    REQUIRE(s.mean_probe_length == doctest::Approx(0.0));
+    REQUIRE(s.longest_cluster == 0);
+    REQUIRE(s.info_inc == 32);
+    REQUIRE(s.info_hash_shift == 0);
+    REQUIRE(s.table_bytes == 0);
+    REQUIRE(s.node_pool_bytes == 0);
+    REQUIRE(s.load_factor == doctest::Approx(0.0F));
+}
+
+TEST_CASE("stats_flat") {
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> map;
+    sfc64 rng(123);
+    for (size_t i = 0; i < 10000; ++i) {
+        map[rng()] = i;
+    }
+    auto const s = map.stats();
+    REQUIRE(sumHistogram(map) == map.size());
+    REQUIRE(s.distance_histogram[0] > map.size() / 2);
+    REQUIRE(s.distance_histogram.back() != 0);
+    REQUIRE(s.max_probe_length == s.distance_histogram.size());
+    REQUIRE(s.mean_probe_length >= 1.0);
+    REQUIRE(s.mean_probe_length < 2.0);
+    REQUIRE(s.longest_cluster >= s.max_probe_length);
+    REQUIRE(s.longest_cluster < map.bucket_count());
+    REQUIRE(s.table_bytes > map.bucket_count() * sizeof(std::pair<uint64_t, uint64_t>));
+    REQUIRE(s.node_pool_bytes == 0);
+    REQUIRE(s.load_factor == doctest::Approx(map.load_factor()));
+
+    map.clear();
+    auto const cleared = map.stats();
+    REQUIRE(cleared.distance_histogram.empty());
+    REQUIRE(cleared.longest_cluster == 0);
+    REQUIRE(cleared.table_bytes == s.table_bytes);
+}
+
+TEST_CASE("stats_bad_hash") {
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> good;
+    robin_hood::unordered_flat_map<uint64_t, uint64_t, BadHash> bad;
+    for (uint64_t i = 0; i < 10000; ++i) {
+        good[i] = i;
+        bad[i] = i;
+    }
+    REQUIRE(sumHistogram(bad) == bad.size());
+    auto const g = good.stats();
+    auto const b = bad.stats();
+    REQUIRE(b.max_probe_length >= 16);
+    REQUIRE(b.max_probe_length > g.max_probe_length);
+    REQUIRE(b.mean_probe_length > g.mean_probe_length);
+    REQUIRE(b.longest_cluster > g.longest_cluster);
+}
+
+TEST_CASE("stats_node") {
+    robin_hood::unordered_node_map<uint64_t, uint64_t> map;
+    robin_hood::unordered_node_map<uint64_t, uint64_t, robin_hood::hash<uint64_t>,
+                                   std::equal_to<uint64_t>, 80, 200,
+                                   robin_hood::shared_node_allocator<char>>
+        shared;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        map[i] = i;
+        shared[i] = i;
+    }
+    auto const s = map.stats();
+    REQUIRE(sumHistogram(map) == map.size());
+    REQUIRE(s.node_pool_bytes >= map.size() * sizeof(std::pair<uint64_t, uint64_t>));
+    REQUIRE(s.table_bytes < s.node_pool_bytes);
+    REQUIRE(shared.stats().node_pool_bytes == 0);
+}
+
+TEST_CASE("stats_rehash_pending") {
+    robin_hood::unordered_flat_map_incremental<uint64_t, uint64_t> map;
+    map.set_incremental_rehash(4);
+    uint64_t i = 0;
+    while (!map.rehash_pending()) {
+        map[i] = i;
+        ++i;
+    }
+    // the old arrays are walked too
+    auto const pending = map.stats();
+    REQUIRE(map.rehash_pending());
+    REQUIRE(sumHistogram(map) == map.size());
+    REQUIRE(pending.max_probe_length == pending.distance_histogram.size());
+    REQUIRE(pending.mean_probe_length >= 1.0);
+    REQUIRE(pending.longest_cluster >= pending.max_probe_length);
+
+    map.finish_rehash();
+    auto const done = map.stats();
+    REQUIRE(pending.table_bytes > done.table_bytes);
+    REQUIRE(sumHistogram(map) == map.size());
+}
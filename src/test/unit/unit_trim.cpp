@@ -0,0 +1,134 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+#include <app/sfc64.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+size_t numBytesAllocated = 0;
+
+template <typename T>
+struct TrackingAllocator {
+    using value_type = T;
+
+    TrackingAllocator() noexcept = default;
+
+    template <typename U>
+    TrackingAllocator(TrackingAllocator<U> const& /*unused*/) noexcept {}
+
+    T* allocate(size_t n) {
+        numBytesAllocated += n * sizeof(T);
+        return static_cast<T*>(std::malloc(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) noexcept {
+        numBytesAllocated -= n * sizeof(T);
+        std::free(ptr);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(TrackingAllocator<T> const& /*unused*/,
+                TrackingAllocator<U> const& /*unused*/) noexcept {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(TrackingAllocator<T> const& /*unused*/,
+                TrackingAllocator<U> const& /*unused*/) noexcept {
+    return false;
+}
+
+// can't be moved, so trim() has to leave it where it is
+struct Immovable {
+    explicit Immovable(uint64_t v) noexcept
+        : value(v) {}
+    Immovable(Immovable const&) = delete;
+    Immovable& operator=(Immovable const&) = delete;
+
+    uint64_t value;
+};
+
+} // namespace
+
+TEST_CASE("trim") {
+    using Map = robin_hood::unordered_node_map<uint64_t, std::string, robin_hood::hash<uint64_t>,
+                                               std::equal_to<uint64_t>, 80, 200,
+                                               TrackingAllocator<char>>;
+    static constexpr uint64_t NumElements = 100000;
+
+    Map map;
+    REQUIRE(map.trim() == 0U);
+    for (uint64_t i = 0; i < NumElements; ++i) {
+        map[i] = std::to_string(i);
+    }
+    // the old tables that were given to the pool while growing are not needed
+    REQUIRE(map.trim() > 0U);
+    REQUIRE(map.trim() == 0U);
+
+    // keep only a few random entries, spread over all blocks
+    sfc64 rng(123);
+    for (uint64_t i = 0; i < NumElements; ++i) {
+        if (rng.uniform<uint64_t>(20) != 0) {
+            map.erase(i);
+        }
+    }
+    auto const remaining = map.size();
+    auto const bytesBefore = numBytesAllocated;
+    auto const freed = map.trim();
+    REQUIRE(freed > 0U);
+    // the allocator sees the sizes rounded up to alignof(std::max_align_t)
+    REQUIRE(numBytesAllocated + freed <= bytesBefore);
+    REQUIRE(numBytesAllocated + freed + 16 * 100 > bytesBefore);
+    REQUIRE(map.trim() == 0U);
+
+    // all entries were moved correctly
+    REQUIRE(map.size() == remaining);
+    for (auto const& kv : map) {
+        REQUIRE(kv.second == std::to_string(kv.first));
+    }
+    for (uint64_t i = 0; i < NumElements; ++i) {
+        map[i] = std::to_string(i);
+    }
+    REQUIRE(map.size() == NumElements);
+    REQUIRE(map[4711] == "4711");
+
+    // compact() shrinks the table, and trims
+    map.clear();
+    map[1] = "1";
+    auto const bytesAfterClear = numBytesAllocated;
+    map.compact();
+    REQUIRE(numBytesAllocated < bytesAfterClear / 4);
+    REQUIRE(map[1] == "1");
+    map.clear();
+    REQUIRE(map.trim() > 0U);
+}
+
+TEST_CASE("trim_immovable") {
+    robin_hood::unordered_node_map<uint64_t, Immovable> map;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        map.emplace(std::piecewise_construct, std::forward_as_tuple(i), std::forward_as_tuple(i));
+    }
+    auto const* node = &*map.find(999);
+
+    // only blocks without any entries can be freed
+    for (uint64_t i = 0; i < 999; ++i) {
+        map.erase(i);
+    }
+    REQUIRE(map.trim() > 0U);
+    REQUIRE(&*map.find(999) == node);
+    REQUIRE(map.find(999)->second.value == 999U);
+}
+
+TEST_CASE("trim_flat") {
+    robin_hood::unordered_flat_map<uint64_t, uint64_t> map;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        map[i] = i;
+    }
+    map.clear();
+    REQUIRE(map.trim() == 0U);
+}
@@ -0,0 +1,96 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+#include <app/hash/Bad.h>
+#include <app/sfc64.h>
+
+#include <string>
+#include <unordered_set>
+
+TEST_CASE_TEMPLATE("wide_info_high_load", Set,
+                   robin_hood::unordered_flat_set_wide_info<uint64_t, robin_hood::hash<uint64_t>,
+                                                            std::equal_to<uint64_t>, 95>,
+                   robin_hood::detail::Table<false, 95, uint64_t, void, robin_hood::hash<uint64_t>,
+                                             std::equal_to<uint64_t>, false, 200,
+                                             robin_hood::malloc_allocator<char>, true>) {
+    Set set;
+    std::unordered_set<uint64_t> ref;
+    sfc64 rng(987);
+
+    // grow through a few sizes, and check each time right before it has to grow again
+    size_t lastNumBuckets = 0;
+    for (size_t i = 0; i < 300000; ++i) {
+        auto const key = rng();
+        REQUIRE(set.insert(key).second);
+        ref.insert(key);
+        if (set.bucket_count() != lastNumBuckets) {
+            // the map only grew because it was full, not because an info overflowed
+            if (lastNumBuckets >= 1024) {
+                REQUIRE(static_cast<double>(set.size() - 1) /
+                            static_cast<double>(lastNumBuckets) >=
+                        0.94);
+            }
+            lastNumBuckets = set.bucket_count();
+        }
+    }
+    REQUIRE(set.size() == ref.size());
+    for (auto key : ref) {
+        REQUIRE(set.count(key) == 1U);
+    }
+    for (size_t i = 0; i < 1000; ++i) {
+        REQUIRE(set.count(rng()) == 0U);
+    }
+
+    size_t n = 0;
+    for (auto key : set) {
+        REQUIRE(ref.count(key) == 1U);
+        ++n;
+    }
+    REQUIRE(n == ref.size());
+
+    // erase every other, then insert new ones again
+    for (auto it = ref.begin(); it != ref.end();) {
+        REQUIRE(set.erase(*it) == 1U);
+        it = ref.erase(it);
+        if (it != ref.end()) {
+            ++it;
+        }
+    }
+    REQUIRE(set.size() == ref.size());
+    for (size_t i = 0; i < 100000; ++i) {
+        auto const key = rng();
+        set.insert(key);
+        ref.insert(key);
+    }
+    REQUIRE(set.size() == ref.size());
+    for (auto key : ref) {
+        REQUIRE(set.count(key) == 1U);
+    }
+
+    Set copy(set);
+    REQUIRE(copy == set);
+    auto const erased = robin_hood::erase_if(copy, [](uint64_t key) { return key % 2 == 0; });
+    REQUIRE(copy.size() + erased == set.size());
+    for (auto key : copy) {
+        REQUIRE(key % 2 == 1U);
+    }
+}
+
+TEST_CASE("wide_info_collisions") {
+    // all keys collide. Halving the info increment gives more and more room for the distance,
+    // until it would leave too few hash bits.
+    robin_hood::unordered_flat_map_wide_info<uint64_t, std::string, hash::Bad<uint64_t>> map;
+    uint64_t i = 0;
+    try {
+        for (; i < 2000; ++i) {
+            map[i] = std::to_string(i);
+        }
+    } catch (std::overflow_error const&) {
+    }
+    REQUIRE(i > 127U);
+    REQUIRE(i <= 1023U);
+    REQUIRE(map.size() == i);
+    for (uint64_t k = 0; k < i; ++k) {
+        REQUIRE(map[k] == std::to_string(k));
+    }
+}
@@ -0,0 +1,95 @@
+#include <robin_hood.h>
+
+#include <app/doctest.h>
+
+#include <string>
+
+TYPE_TO_STRING(robin_hood::unordered_flat_map<std::string, size_t>);
+TYPE_TO_STRING(robin_hood::unordered_node_map<std::string, size_t>);
+
+TEST_CASE_TEMPLATE("with_hash", Map, robin_hood::unordered_flat_map<std::string, size_t>,
+                   robin_hood::unordered_node_map<std::string, size_t>) {
+    Map a;
+    Map b;
+    Map const& ca = a;
+
+    std::string const key = "a key that is long enough to not fit into small string optimization";
+    auto const h = a.hash_for(key);
+    REQUIRE(h == b.hash_for(key));
+    REQUIRE(h == robin_hood::hash<std::string>{}(key));
+
+    REQUIRE(a.find_with_hash(key, h) == a.end());
+    REQUIRE(ca.find_with_hash(key, h) == ca.end());
+    REQUIRE(a.erase_with_hash(key, h) == 0);
+
+    auto it = a.try_emplace_with_hash(key, h, 123U);
+    REQUIRE(it.second);
+    REQUIRE(it.first->second == 123U);
+    it = a.try_emplace_with_hash(key, h, 321U);
+    REQUIRE(!it.second);
+    REQUIRE(it.first->second == 123U);
+    REQUIRE(b.try_emplace_with_hash(std::string(key), h, 7U).second);
+
+    // both maps find it, with or without hash
+    REQUIRE(a.find_with_hash(key, h) == a.find(key));
+    REQUIRE(ca.find_with_hash(key, h)->second == 123U);
+    REQUIRE(b.find_with_hash(key, h)->second == 7U);
+
+    // lots of other elements, so the map has to grow
+    for (size_t i = 0; i < 1000; ++i) {
+        auto const k = std::to_string(i);
+        REQUIRE(a.try_emplace_with_hash(k, a.hash_for(k), i).second);
+    }
+    for (size_t i = 0; i < 1000; ++i) {
+        auto const k = std::to_string(i);
+        REQUIRE(a.find_with_hash(k, a.hash_for(k))->second == i);
+    }
+    REQUIRE(a.size() == 1001);
+
+    REQUIRE(a.erase_with_hash(key, h) == 1);
+    REQUIRE(a.erase_with_hash(key, h) == 0);
+    REQUIRE(a.find(key) == a.end());
+    REQUIRE(a.size() == 1000);
+}
+
+TYPE_TO_STRING(robin_hood::unordered_flat_set<std::string>);
+TYPE_TO_STRING(robin_hood::unordered_node_set<std::string>);
+
+TEST_CASE_TEMPLATE("insert_with_hash_set", Set, robin_hood::unordered_flat_set<std::string>,
+                   robin_hood::unordered_node_set<std::string>) {
+    Set s;
+
+    std::string const key = "a key that is long enough to not fit into small string optimization";
+    auto const h = s.hash_for(key);
+
+    auto it = s.insert_with_hash(key, h);
+    REQUIRE(it.second);
+    REQUIRE(*it.first == key);
+    it = s.insert_with_hash(std::string(key), h);
+    REQUIRE(!it.second);
+    REQUIRE(it.first == s.find(key));
+    REQUIRE(s.size() == 1);
+
+    for (size_t i = 0; i < 1000; ++i) {
+        auto k = std::to_string(i);
+        auto const kh = s.hash_for(k);
+        REQUIRE(s.insert_with_hash(std::move(k), kh).second);
+    }
+    for (size_t i = 0; i < 1000; ++i) {
+        auto const k = std::to_string(i);
+        REQUIRE(s.find_with_hash(k, s.hash_for(k)) != s.end());
+    }
+    REQUIRE(s.count(key) == 1);
+    REQUIRE(s.size() == 1001);
+}
+
+TEST_CASE("insert_with_hash_map") {
+    robin_hood::unordered_node_map<std::string, size_t> map;
+    std::string const key = "a key that is long enough to not fit into small string optimization";
+    auto const h = map.hash_for(key);
+
+    REQUIRE(map.insert_with_hash({key, 1U}, h).second);
+    auto const it = map.insert_with_hash({key, 2U}, h);
+    REQUIRE(!it.second);
+    REQUIRE(it.first->second == 1U);
+}